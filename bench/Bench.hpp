@@ -0,0 +1,35 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+// A minimal benchmark harness. Each benchmark times its own loop with elapsedTime() and
+// reports its throughput with reportBench, so what is measured is explicit in the benchmark.
+
+typedef void (*BenchFunc)();
+
+struct BenchRegistration
+{
+	BenchRegistration(const char* inName, BenchFunc inFunc);
+};
+
+#define BENCH(name) \
+	static void name(); \
+	static BenchRegistration name##_registration(#name, name); \
+	static void name()
+
+// prints the time taken and the rate at which items were processed.
+void reportBench(const char* name, double seconds, double items, const char* itemName);
@@ -0,0 +1,57 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Bench.hpp"
+#include "elapsedTime.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+struct BenchEntry
+{
+	const char* name;
+	BenchFunc func;
+};
+
+static std::vector<BenchEntry>& benchmarks()
+{
+	static std::vector<BenchEntry> sBenchmarks;
+	return sBenchmarks;
+}
+
+BenchRegistration::BenchRegistration(const char* inName, BenchFunc inFunc)
+{
+	benchmarks().push_back({inName, inFunc});
+}
+
+void reportBench(const char* name, double seconds, double items, const char* itemName)
+{
+	printf("%-32s %10.4f s  %12.2f M%s/s\n", name, seconds, 1e-6 * items / seconds, itemName);
+}
+
+// runs every benchmark, or only those whose names contain one of the arguments.
+int main(int argc, const char* argv[])
+{
+	initElapsedTime();
+	for (const BenchEntry& bench : benchmarks()) {
+		bool run = argc < 2;
+		for (int i = 1; i < argc && !run; ++i) {
+			run = strstr(bench.name, argv[i]) != nullptr;
+		}
+		if (run) bench.func();
+	}
+	return 0;
+}
@@ -0,0 +1,83 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Bench.hpp"
+#include "Object.hpp"
+#include "VM.hpp"
+#include "symbol.hpp"
+#include "elapsedTime.hpp"
+#include <algorithm>
+
+// about the size of a large prelude plus libraries.
+const int kNumDefs = 20000;
+const int kLookupPasses = 50;
+
+// definition names, sorted by hash. inserting in hash order is the worst case for an
+// unbalanced tree keyed on the hash.
+static std::vector<V> defNames()
+{
+	std::vector<V> names;
+	char name[32];
+	for (int i = 0; i < kNumDefs; ++i) {
+		snprintf(name, sizeof(name), "def%d", i);
+		names.push_back(getsym(name));
+	}
+	std::sort(names.begin(), names.end(), [](Arg a, Arg b) { return a.Hash() < b.Hash(); });
+	return names;
+}
+
+BENCH(gtable_insert_impure)
+{
+	std::vector<V> names = defNames();
+	P<GTable> table = new GTable();
+	double t0 = elapsedTime();
+	for (int i = 0; i < kNumDefs; ++i) {
+		table->putImpure(names[i], (double)i);
+	}
+	reportBench("gtable_insert_impure", elapsedTime() - t0, kNumDefs, "defs");
+}
+
+BENCH(gtable_insert_pure)
+{
+	std::vector<V> names = defNames();
+	P<GTable> table = new GTable();
+	double t0 = elapsedTime();
+	for (int i = 0; i < kNumDefs; ++i) {
+		table = table->putPure(names[i], names[i].Hash(), (double)i);
+	}
+	reportBench("gtable_insert_pure", elapsedTime() - t0, kNumDefs, "defs");
+}
+
+BENCH(gtable_lookup)
+{
+	std::vector<V> names = defNames();
+	P<GTable> table = new GTable();
+	for (int i = 0; i < kNumDefs; ++i) {
+		table->putImpure(names[i], (double)i);
+	}
+	Z sum = 0.;
+	double t0 = elapsedTime();
+	for (int pass = 0; pass < kLookupPasses; ++pass) {
+		for (int i = 0; i < kNumDefs; ++i) {
+			V value;
+			table->getInner(names[i], value);
+			sum += value.f;
+		}
+	}
+	double seconds = elapsedTime() - t0;
+	if (sum < 0.) post("%g\n", sum); // keep the lookups from being optimized away.
+	reportBench("gtable_lookup", seconds, (double)kNumDefs * kLookupPasses, "lookups");
+}
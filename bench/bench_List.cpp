@@ -0,0 +1,89 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Bench.hpp"
+#include "Object.hpp"
+#include "VM.hpp"
+#include "elapsedTime.hpp"
+
+// a finite Z stream of consecutive numbers, one block per pull.
+struct CountGen : public Gen
+{
+	Z mValue;
+	int64_t mRemaining;
+
+	CountGen(Thread& th, int64_t inLength) : Gen(th, itemTypeZ, true), mValue(0.), mRemaining(inLength) {}
+
+	virtual const char* TypeName() const override { return "CountGen"; }
+
+	virtual void pull(Thread& th) override
+	{
+		if (mRemaining <= 0) {
+			end();
+			return;
+		}
+		int n = (int)std::min((int64_t)mBlockSize, mRemaining);
+		Z* out = mOut->fulfillz(n);
+		for (int i = 0; i < n; ++i) {
+			out[i] = mValue;
+			mValue += 1.;
+		}
+		mRemaining -= n;
+		mOut = mOut->nextp();
+	}
+};
+
+const int64_t kStreamFrames = 1 << 23;
+const int kFillFrames = 256;
+
+static double fillAll(Thread& th, Arg list)
+{
+	ZIn in(list);
+	Z buf[kFillFrames];
+	Z sum = 0.;
+	double t0 = elapsedTime();
+	for (;;) {
+		int n = kFillFrames;
+		bool done = in.fill(th, n, buf, 1);
+		sum += buf[0];
+		if (done) break;
+	}
+	double seconds = elapsedTime() - t0;
+	if (sum < 0.) post("%g\n", sum); // keep the reads from being optimized away.
+	return seconds;
+}
+
+// every block read forces a new list node.
+BENCH(zin_fill_lazy)
+{
+	Thread th;
+	V list = new List(new CountGen(th, kStreamFrames));
+	reportBench("zin_fill_lazy", fillAll(th, list), kStreamFrames, "frames");
+}
+
+// the list is forced before it is read, so the reads only check that each node is forced.
+BENCH(zin_fill_forced)
+{
+	Thread th;
+	P<List> list = new List(new CountGen(th, kStreamFrames));
+	list->forceAll(th);
+	reportBench("zin_fill_forced", fillAll(th, list()), kStreamFrames, "frames");
+}
+
+BENCH(list_size)
+{
+	printf("%-32s %10zu bytes\n", "sizeof(List)", sizeof(List));
+}
@@ -0,0 +1,142 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Bench.hpp"
+#include "Object.hpp"
+#include "MathOps.hpp"
+#include "VM.hpp"
+#include "elapsedTime.hpp"
+#include <cmath>
+#include <string>
+
+extern BinaryOp* gBinaryOpPtr_plus;
+extern BinaryOp* gBinaryOpPtr_mul;
+
+const int kMathFrames = 1 << 22;
+
+static V signal(Z inFreq)
+{
+	P<List> list = new List(itemTypeZ, kMathFrames);
+	list->mArray->setSize(kMathFrames);
+	Z* z = list->mArray->z();
+	for (int i = 0; i < kMathFrames; ++i) z[i] = sin(i * inFreq);
+	return V(list());
+}
+
+// (a + b) * c + .5. if keepIntermediates is set, each intermediate list is still referenced
+// while the result is computed, so it cannot be fused and gets its own generator and blocks.
+static double mathChain(Thread& th, bool keepIntermediates)
+{
+	V a = signal(.01), b = signal(.02), c = signal(.03);
+	double t0 = elapsedTime();
+	V result;
+	if (keepIntermediates) {
+		V sum = a.binaryOp(th, gBinaryOpPtr_plus, b);
+		V product = sum.binaryOp(th, gBinaryOpPtr_mul, c);
+		result = product.binaryOp(th, gBinaryOpPtr_plus, .5);
+		((List*)result.o())->forceAll(th);
+	} else {
+		result = a.binaryOp(th, gBinaryOpPtr_plus, b)
+			.binaryOp(th, gBinaryOpPtr_mul, c)
+			.binaryOp(th, gBinaryOpPtr_plus, .5);
+		((List*)result.o())->forceAll(th);
+	}
+	return elapsedTime() - t0;
+}
+
+BENCH(math_chain_fused)
+{
+	Thread th;
+	reportBench("math_chain_fused", mathChain(th, false), kMathFrames, "frames");
+}
+
+BENCH(math_chain_unfused)
+{
+	Thread th;
+	reportBench("math_chain_unfused", mathChain(th, true), kMathFrames, "frames");
+}
+
+// every unary and binary op over one block, from buffers that start on a pool alignment
+// boundary as the blocks of pooled arrays do, and from ones a sample past it, which take the
+// unaligned paths.
+const int kOpFrames = 1024;
+const int kOpReps = 1000;
+
+// values in (0, 1) so that ops like log, acos and div stay in their domains.
+static P<Array> opInput(Z inFreq)
+{
+	P<Array> array = new Array(itemTypeZ, kOpFrames + 1);
+	array->setSize(kOpFrames + 1);
+	Z* z = array->z();
+	for (int i = 0; i <= kOpFrames; ++i) z[i] = .5 + .4 * sin(i * inFreq);
+	return array;
+}
+
+static void reportOp(const char* kind, const char* name, int offset, double seconds)
+{
+	std::string benchName = std::string(kind) + "_" + name + (offset ? "_unaligned" : "_aligned");
+	reportBench(benchName.c_str(), seconds, double(kOpFrames) * kOpReps, "frames");
+}
+
+BENCH(math_unops)
+{
+	P<Array> a = opInput(.01);
+	P<Array> out = new Array(itemTypeZ, kOpFrames + 1);
+	for (UnaryOp* op : mathUnaryOps()) {
+		for (int offset = 0; offset < 2; ++offset) {
+			double t0 = elapsedTime();
+			for (int rep = 0; rep < kOpReps; ++rep) {
+				op->loopz(kOpFrames, a->z() + offset, 1, out->z() + offset);
+			}
+			reportOp("unop", op->Name(), offset, elapsedTime() - t0);
+		}
+	}
+}
+
+BENCH(math_binops)
+{
+	P<Array> a = opInput(.01);
+	P<Array> b = opInput(.03);
+	P<Array> out = new Array(itemTypeZ, kOpFrames + 1);
+	for (BinaryOp* op : mathBinaryOps()) {
+		for (int offset = 0; offset < 2; ++offset) {
+			double t0 = elapsedTime();
+			for (int rep = 0; rep < kOpReps; ++rep) {
+				op->loopz(kOpFrames, a->z() + offset, 1, b->z() + offset, 1, out->z() + offset);
+			}
+			reportOp("binop", op->Name(), offset, elapsedTime() - t0);
+		}
+	}
+}
+
+// a signal and a number on either side, as in gains and offsets.
+BENCH(math_binops_constant)
+{
+	P<Array> a = opInput(.01);
+	P<Array> out = new Array(itemTypeZ, kOpFrames + 1);
+	for (BinaryOp* op : mathBinaryOps()) {
+		double t0 = elapsedTime();
+		for (int rep = 0; rep < kOpReps; ++rep) {
+			op->loopzs(kOpFrames, a->z(), 1, .7, out->z());
+		}
+		reportOp("binop_zs", op->Name(), 0, elapsedTime() - t0);
+		t0 = elapsedTime();
+		for (int rep = 0; rep < kOpReps; ++rep) {
+			op->loopsz(kOpFrames, .7, a->z(), 1, out->z());
+		}
+		reportOp("binop_sz", op->Name(), 0, elapsedTime() - t0);
+	}
+}
@@ -0,0 +1,96 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Bench.hpp"
+#include "Object.hpp"
+#include "Opcode.hpp"
+#include "VM.hpp"
+#include "elapsedTime.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+
+extern void AddCoreOps();
+extern void AddMathOps();
+
+static void addOps()
+{
+	static bool added = false;
+	if (added) return;
+	AddCoreOps();
+	AddMathOps();
+	added = true;
+}
+
+static void eval(Thread& th, const char* source)
+{
+	P<Fun> fun;
+	if (!th.compile(source, fun, true)) {
+		post("could not compile %s\n", source);
+		throw errFailed;
+	}
+	fun->run(th);
+}
+
+// each call of fib looks up fibRef twice and r once in the workspace and does a dot lookup on a
+// form, so the time is mostly spent finding names. a lambda cannot see a name bound after it was
+// compiled, so fib reaches itself through a ref that is set once it exists.
+static void fib(const char* name, bool inCaching)
+{
+	addOps();
+	Thread th;
+	eval(th, "{:k 1} = r  0 R = fibRef");
+	eval(th, "\\n [n 2 < \\[n] \\[n r.k - fibRef get ! n 2 - fibRef get ! +] if] fibRef set");
+
+	bool wasCaching = inlineCaching();
+	setInlineCaching(inCaching);
+	const int n = 24;
+	char source[32];
+	snprintf(source, sizeof(source), "%d fibRef get !", n);
+	double t0 = elapsedTime();
+	eval(th, source);
+	double seconds = elapsedTime() - t0;
+	setInlineCaching(wasCaching);
+
+	// fib n makes calls(n) = calls(n-1) + calls(n-2) + 1 calls, and calls(0) = calls(1) = 1.
+	double callsBefore = 1., calls = 1.;
+	for (int i = 2; i <= n; ++i) {
+		double next = calls + callsBefore + 1.;
+		callsBefore = calls;
+		calls = next;
+	}
+	V result = th.pop();
+	if (!result.isReal() || result.f != 46368.) {
+		fprintf(stderr, "%s got the wrong answer\n", name);
+		exit(1);
+	}
+	reportBench(name, seconds, calls, "calls");
+}
+
+BENCH(opcode_fib_cached)
+{
+	fib("opcode_fib_cached", true);
+}
+
+BENCH(opcode_fib_uncached)
+{
+	fib("opcode_fib_uncached", false);
+}
+
+BENCH(opcode_size)
+{
+	printf("%-32s %10zu bytes\n", "sizeof(Opcode)", sizeof(Opcode));
+	printf("%-32s %10zu bytes\n", "sizeof(Instr)", sizeof(Instr));
+}
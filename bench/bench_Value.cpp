@@ -0,0 +1,109 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Bench.hpp"
+#include "Object.hpp"
+#include "VM.hpp"
+#include "symbol.hpp"
+#include "elapsedTime.hpp"
+
+// build with -Dnanbox=true to compare against the NaN boxed layout.
+#if SAPF_NANBOX
+static const char* kLayout = "nanbox";
+#else
+static const char* kLayout = "unboxed";
+#endif
+
+const int64_t kValueOps = 1 << 24;
+
+BENCH(value_size)
+{
+	printf("%-32s %10zu bytes (%s)\n", "sizeof(V)", sizeof(V), kLayout);
+	printf("%-32s %10zu bytes\n", "sizeof(Opcode)", sizeof(Opcode));
+	printf("%-32s %10zu bytes\n", "VList of 1M items", (size_t)1000000 * sizeof(V));
+}
+
+// pushes and pops a mix of numbers and objects, like the interpreter does.
+BENCH(value_stack)
+{
+	Thread th;
+	V object = getsym("value_stack");
+	Z sum = 0.;
+	double t0 = elapsedTime();
+	for (int64_t i = 0; i < kValueOps; i += 4) {
+		th.push((double)i);
+		th.push(object);
+		th.push(1.);
+		th.push(object);
+		th.pop();
+		sum += th.pop().f;
+		th.pop();
+		sum += th.pop().f;
+	}
+	double seconds = elapsedTime() - t0;
+	if (sum < 0.) post("%g\n", sum); // keep the work from being optimized away.
+	reportBench("value_stack", seconds, kValueOps, "ops");
+}
+
+// fills a VList with numbers and reads it back.
+BENCH(value_vlist)
+{
+	const int64_t n = 1 << 20;
+	const int passes = 16;
+	Z sum = 0.;
+	double t0 = elapsedTime();
+	for (int pass = 0; pass < passes; ++pass) {
+		P<List> list = new List(itemTypeV, n);
+		for (int64_t i = 0; i < n; ++i) {
+			list->add(V((double)i));
+		}
+		V* items = list->mArray->v();
+		for (int64_t i = 0; i < n; ++i) {
+			sum += items[i].f;
+		}
+	}
+	double seconds = elapsedTime() - t0;
+	if (sum < 0.) post("%g\n", sum);
+	reportBench("value_vlist", seconds, (double)n * passes, "items");
+}
+
+// reads the values of a form by key.
+BENCH(value_table)
+{
+	const int numKeys = 8;
+	P<TableMap> map = new TableMap(numKeys);
+	P<Table> table = new Table(map);
+	std::vector<V> keys;
+	char name[32];
+	for (int i = 0; i < numKeys; ++i) {
+		snprintf(name, sizeof(name), "value_key%d", i);
+		keys.push_back(getsym(name));
+		map->put(i, keys.back(), keys.back().Hash());
+		table->put(i, (double)i);
+	}
+	P<Form> form = new Form(table);
+	Thread th;
+	Z sum = 0.;
+	double t0 = elapsedTime();
+	for (int64_t i = 0; i < kValueOps; ++i) {
+		V value;
+		form->get(th, keys[i & (numKeys - 1)], value);
+		sum += value.f;
+	}
+	double seconds = elapsedTime() - t0;
+	if (sum < 0.) post("%g\n", sum);
+	reportBench("value_table", seconds, kValueOps, "lookups");
+}
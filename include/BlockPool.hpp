@@ -0,0 +1,44 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef __BlockPool_h__
+#define __BlockPool_h__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-thread, size-classed free lists for the objects and sample buffers that generators
+// allocate for every block they produce (List, Array and their payloads).
+// Blocks are rounded up to a power of two. Each thread keeps a bounded cache of free blocks
+// per size class, so a block freed on one thread is simply reused by that thread.
+// Requests larger than kMaxPooledBlockSize go straight to malloc.
+// Blocks of kPoolAlignment bytes or more start on a kPoolAlignment boundary, so sample buffers
+// can be read with aligned SIMD loads of any width up to AVX-512.
+
+const size_t kPoolAlignment = 64;
+const int kMinPooledBlockLog2 = 4;
+const int kMaxPooledBlockLog2 = 18;
+const size_t kMaxPooledBlockSize = size_t(1) << kMaxPooledBlockLog2;
+
+void* poolAlloc(size_t inSize);
+void poolFree(void* inBlock, size_t inSize);
+
+// size actually reserved for a request of inSize bytes.
+size_t poolBlockSize(size_t inSize);
+
+inline bool isPoolAligned(const void* inPtr) { return ((uintptr_t)inPtr & (kPoolAlignment - 1)) == 0; }
+
+#endif
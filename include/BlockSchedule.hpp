@@ -0,0 +1,57 @@
+#pragma once
+
+#include "VM.hpp"
+#include <unordered_map>
+#include <vector>
+
+/*!
+ * A flat schedule for the generators feeding a fixed set of signal inputs, e.g. the channels of
+ * a player or of a file being written.
+ * Pulling a block of a signal normally recurses: each generator forces the lists of its inputs,
+ * which pull their own generators and so on. A schedule finds the generators reachable from the
+ * inputs once, through Gen::blockInputs, and orders them so that every generator comes after the
+ * generators it reads from. prepare() then forces the next block of each generator that the
+ * coming reads need, in that order, so every pull finds its inputs already computed and the
+ * generators run one after another over data that is still in cache.
+ * Anything the schedule doesn't know about, like generators created while playing (ola sources,
+ * concatenated signals), generators that don't report their inputs or streams read through a
+ * Plug, is simply left to be pulled lazily as before.
+ * Not thread safe. The inputs must outlive the schedule.
+ */
+class BlockSchedule {
+public:
+    BlockSchedule(ZIn* inputs, int numInputs);
+
+    // forces, producers first, the blocks needed to read inNumFrames frames from every input.
+    void prepare(Thread& th, int inNumFrames);
+
+    // number of generators in the schedule.
+    int numNodes() const { return static_cast<int>(mNodes.size()); }
+    // number of those whose inputs are not known.
+    int numOpaqueNodes() const;
+
+private:
+    struct Node {
+        P<Gen> gen;
+        std::vector<ZIn*> inputs;
+        bool opaque{false};
+        // the unforced list of gen needed during the current pass, if any.
+        List* needed{nullptr};
+    };
+
+    void visit(Gen* gen);
+    // the unforced list that reading inNumFrames from in would force first, if any.
+    static List* neededList(const ZIn& in, int inNumFrames);
+    // marks the node that generates neededList(in, inNumFrames). false if there is none.
+    bool markNeeded(const ZIn& in, int inNumFrames);
+
+    ZIn* mInputs;
+    int mNumInputs;
+    // producers before consumers.
+    std::vector<Node> mNodes;
+    std::unordered_map<Gen*, int> mNodeIndex;
+};
+
+// whether players and single threaded file writes build a BlockSchedule for their inputs.
+void setBlockScheduling(bool inEnabled);
+bool blockScheduling();
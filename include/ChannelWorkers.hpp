@@ -0,0 +1,60 @@
+#pragma once
+
+#include "VM.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * A small pool of worker threads for rendering independent channels in parallel, e.g. the
+ * channels of a file being written offline.
+ * Each worker owns its own Thread (a copy of the parent's), so channels can pull their lazy
+ * lists concurrently. run() hands out channels one at a time to the workers and the calling
+ * thread, and returns only when every channel is finished, so it is a per-block join: callers
+ * can fill one block of every channel, then write it, in order.
+ * Only one thread may call run() at a time.
+ */
+class ChannelWorkers {
+public:
+    // fills channel inChannel for the current block, using th for all evaluation.
+    using ChannelFunc = std::function<void(Thread& th, int inChannel)>;
+
+    // numWorkers extra threads are started; the calling thread also works during run().
+    ChannelWorkers(const Thread& parent, int numWorkers);
+    ~ChannelWorkers();
+
+    // calls func once for every channel in [0, numChannels) and waits for all of them.
+    // if any call throws, the first exception is rethrown here after all channels have run.
+    void run(Thread& th, int numChannels, const ChannelFunc& func);
+
+    int numWorkers() const { return static_cast<int>(mWorkers.size()); }
+
+    // number of threads worth using to render numChannels channels, counting the caller.
+    static int threadsFor(int numChannels);
+
+private:
+    void workLoop(Thread& th);
+    void doChannels(Thread& th, const ChannelFunc& func, int numChannels);
+
+    std::vector<std::unique_ptr<Thread>> mThreads;
+    std::vector<std::thread> mWorkers;
+
+    std::mutex mMutex;
+    std::condition_variable mWorkAvailableCondition;
+    std::condition_variable mWorkDoneCondition;
+
+    // the current job. guarded by mMutex, except for mNextChannel.
+    const ChannelFunc* mFunc{nullptr};
+    int mNumChannels{0};
+    uint64_t mGeneration{0};
+    int mBusyWorkers{0};
+    bool mRunning{true};
+    std::exception_ptr mError;
+
+    std::atomic<int> mNextChannel{0};
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#ifndef SAPF_AUDIOTOOLBOX
+#include "PortableBuffers.hpp"
+#include "Sample.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*!
+ * Reads the samples of a WAV file straight out of a read-only memory mapping of the file.
+ * Each pull converts and de-interleaves the requested frames from the mapping directly into
+ * the caller's channel buffers, with no intermediate interleaved copy. The kernel is told the
+ * access is sequential, pages ahead of the read position are requested ahead of time, and
+ * pages behind it are released so very large files don't stay resident.
+ * Supports PCM 8/16/24/32 bit and IEEE float 32/64 bit samples, including WAVE_FORMAT_EXTENSIBLE.
+ * Not available on Windows.
+ */
+class MappedWavFile {
+public:
+	enum class Encoding { Unsigned8, Int16, Int24, Int32, Float32, Float64 };
+
+	~MappedWavFile();
+
+	// returns nullptr if the file isn't a WAV file in a supported format, or can't be mapped.
+	static std::unique_ptr<MappedWavFile> open(const char *path);
+
+	uint32_t numChannels() const { return mNumChannels; }
+	double sampleRate() const { return mSampleRate; }
+	int64_t numFrames() const { return mNumFrames; }
+
+	// same contract as SndfileSoundFile::pull: fills the first framesRead frames of each of
+	// numChannels Z buffers and updates framesRead to the number actually read.
+	void pull(uint32_t *framesRead, PortableBuffers &buffers);
+	// the same into double buffers, which is what the resamplers take whatever Z is.
+	void pullDouble(uint32_t *framesRead, PortableBuffers &buffers);
+
+private:
+	MappedWavFile(void *mapping, size_t mappingSize, const uint8_t *data, Encoding encoding,
+		uint32_t numChannels, double sampleRate, int64_t numFrames);
+
+	void adviseReadAhead(int64_t frame);
+	template <typename Out>
+	void pullAs(uint32_t *framesRead, PortableBuffers &buffers);
+
+	void *const mMapping;
+	const size_t mMappingSize;
+	const uint8_t *const mData;
+	const Encoding mEncoding;
+	const uint32_t mNumChannels;
+	const double mSampleRate;
+	const int64_t mNumFrames;
+	const size_t mBytesPerFrame;
+	int64_t mPosition{0};
+	// byte offsets in the mapping of the read-ahead window already requested and of the pages
+	// already released.
+	size_t mAdvisedUntil{0};
+	size_t mReleasedUntil{0};
+};
+#endif // SAPF_AUDIOTOOLBOX
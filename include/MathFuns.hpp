@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <algorithm>
 #include "MathFuns.hpp"
+#include "Sample.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -50,25 +51,25 @@ const double truncDouble = 3. * pow(2.0,51);
 const int kSineTableSize = 16384; // this size gives more than 144 dB SNR (24 bit accuracy) when linear interpolated.
 const int kSineTableSize4 = kSineTableSize >> 2;
 const int kSineTableMask = kSineTableSize - 1;
-extern double gSineTable[kSineTableSize+1];
+extern Z gSineTable[kSineTableSize+1];
 const double gInvSineTableSize = 1. / kSineTableSize;
 const double gSineTableOmega = kTwoPi * gInvSineTableSize;
 const double gInvSineTableOmega = 1. / gSineTableOmega;
 
 const int kDBAmpTableSize = 1500;
-extern double gDBAmpTable[kDBAmpTableSize+2];
+extern Z gDBAmpTable[kDBAmpTableSize+2];
 const double kDBAmpScale = 5.;
 const double kInvDBAmpScale = .2;
 const double kDBAmpOffset = 150.;
 
 const int kDecayTableSize = 2000;
 const double kDecayScale = 1000.;
-extern double gDecayTable[kDecayTableSize+1];
+extern Z gDecayTable[kDecayTableSize+1];
 
 const int kFirstOrderCoeffTableSize = 1000;
 const double kInvFirstOrderCoeffTableSize = 1. / kFirstOrderCoeffTableSize;
 const double kFirstOrderCoeffScale = 1000.;
-extern double gFirstOrderCoeffTable[kFirstOrderCoeffTableSize+1];
+extern Z gFirstOrderCoeffTable[kFirstOrderCoeffTableSize+1];
 
 void fillSineTable();
 void fillDBAmpTable();
@@ -76,14 +77,14 @@ void fillDecayTable();
 void fillFirstOrderCoeffTable();
 void fillOddHilbert(int n, double* h);
 
-inline double lut(double* table, int index, double frac)
+inline double lut(const Z* table, int index, double frac)
 {
 	double a = table[index];
 	double b = table[index + 1];
 	return a + frac * (b - a);
 }
 
-inline double oscilLUT(double* table, int index, int mask, double x)
+inline double oscilLUT(const Z* table, int index, int mask, double x)
 {
 	double y0 = table[(index - 1) & mask];
 	double y1 = table[(index    ) & mask];
@@ -98,7 +99,7 @@ inline double oscilLUT(double* table, int index, int mask, double x)
     return ((c3 * x + c2) * x + c1) * x + c0;
 }
 
-inline double oscilLUT2(double* tableA, double* tableB, int index, int mask, double x, double frac)
+inline double oscilLUT2(const Z* tableA, const Z* tableB, int index, int mask, double x, double frac)
 {
 	double x2 = x*x;
 	double x3 = x*x2;
@@ -198,7 +199,7 @@ inline double tcos1(double x)
 }
 
 
-inline void tsincos(double x, double& sn, double& cs)
+inline void tsincos(double x, Z& sn, Z& cs)
 {
 	double findex = gInvSineTableOmega * x;
 	double iindex = floor(findex);
@@ -214,7 +215,7 @@ inline void tsincos(double x, double& sn, double& cs)
 }
 
 
-inline void tsincosx(double x, double& sn, double& cs)
+inline void tsincosx(double x, Z& sn, Z& cs)
 {
 	double iindex = floor(x);
 	//double iindex = (x + truncDouble) - truncDouble;
@@ -587,7 +588,7 @@ inline double sc_fmod(double in, double hi)
 	return out;
 }
 
-inline void sc_fdivmod(double in, double hi, double& outDiv, double& outMod)
+inline void sc_fdivmod(double in, double hi, Z& outDiv, Z& outMod)
 {
 	outMod = sc_fmod(in, hi);
 	outDiv = (in - outMod) / hi;
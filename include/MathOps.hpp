@@ -124,32 +124,49 @@ struct BinaryOpLinkGen : public Gen
 	}
 };
 
-struct UnaryOpZGen : public Gen
+// evaluates a tree of unary and binary operators on signals as a single generator.
+// it starts out as a single unary or binary operator on its inputs. before computing its first block
+// it absorbs any input that is the untouched output of another FusedZGen and is not used by anything
+// else, so that a chain of operators like  a b + c * 0.5 +  computes each block in one pass through
+// a few scratch blocks, instead of each operator allocating and filling its own list of blocks.
+struct FusedZGen : public Gen
 {
-	ZIn _a;
-	UnaryOp* op;
-	
-	UnaryOpZGen(Thread& th, UnaryOp* inOp, Arg a) : Gen(th, itemTypeZ, a.isFinite()), _a(a), op(inOp) {}
-
-	virtual const char* TypeName() const override { return "UnaryOpZGen"; }
-
-	virtual int numInputs() const { return 1; }
-		
+	// an operand is an input index if >= 0, or ~k for the result of step k.
+	// out is the scratch block holding the step's result. the last step writes to the output.
+	struct Step
+	{
+		UnaryOp* unaryOp;
+		BinaryOp* binaryOp;
+		int a;
+		int b;
+		int out;
+	};
+
+	std::vector<ZIn> mInputs;
+	std::vector<Step> mSteps;
+	std::vector<Z> mScratch;
+	std::vector<Z*> mInputBuffers;
+	std::vector<int> mInputStrides;
+	bool mFused = false;
+
+	FusedZGen(Thread& th, UnaryOp* op, Arg a);
+	FusedZGen(Thread& th, BinaryOp* op, Arg a, Arg b);
+
+	virtual const char* TypeName() const override { return "FusedZGen"; }
+
+	virtual bool blockInputs(std::vector<ZIn*>& outInputs) override;
 	virtual void pull(Thread& th) override;
-};
 
-struct BinaryOpZGen : public Gen
-{
-	ZIn _a;
-	ZIn _b;
-	BinaryOp* op;
-	
-	BinaryOpZGen(Thread& th, BinaryOp* _op, Arg a, Arg b)
-					: Gen(th, itemTypeZ, mostFinite(a,b)), _a(a), _b(b), op(_op) {}
-	
-	virtual const char* TypeName() const override { return "BinaryOpZGen"; }
-	
-	virtual void pull(Thread& th) override;
+	int numSteps() const { return (int)mSteps.size(); }
+	int numInputs() const { return (int)mInputs.size(); }
+
+private:
+	void fuse();
+	int fuseOperand(FusedZGen* gen, int operand, std::vector<int>& stepMap, std::vector<ZIn>& inputs, std::vector<Step>& steps);
+	int fuseSteps(FusedZGen* gen, std::vector<ZIn>& inputs, std::vector<Step>& steps);
+	void allocateScratch();
+	FusedZGen* absorbable(const ZIn& in, size_t numSteps) const;
+	const Z* operand(int inOperand, int& outStride) const;
 };
 
 struct BinaryOpLinkZGen : public Gen
@@ -488,4 +505,15 @@ struct IPairsOpGen : public Gen
 };
 
 
+// if a is a packed signal that nothing but the caller refers to, replaces its values with the
+// result of op and returns true. otherwise returns false and does nothing.
+bool unaryOpInPlace(Thread& th, UnaryOp* op, Arg a);
+// likewise computes a op b in the array of a or b, when one is an unshared packed signal and the
+// other is a real or a packed signal of the same length. sets out to the result.
+bool binaryOpInPlace(Thread& th, BinaryOp* op, Arg a, Arg b, V& out);
+
+// every unary and binary op defined by MathOps, in the order they are defined.
+std::vector<UnaryOp*> const& mathUnaryOps();
+std::vector<BinaryOp*> const& mathBinaryOps();
+
 #endif
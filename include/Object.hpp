@@ -24,13 +24,17 @@
 #include <string.h>
 #include <string>
 #include <vector>
+#include <atomic>
+#include <memory>
 #include "Hash.hpp"
 #include "ErrorCodes.hpp"
 #include "MathFuns.hpp"
+#include "Sample.hpp"
 
 #include <pthread.h>
 #include "RCObj.hpp"
 #include "lock.hpp"
+#include "BlockPool.hpp"
 
 void post(const char* fmt, ...);
 
@@ -60,12 +64,6 @@ typedef V const& Arg;
 #define LOOP(I,N) for (int I = 0;  i < (N); ++I)
 #define LOOP2(I,S,N) for (int I = S;  i < (N); ++I)
 
-#define SAMPLE_IS_DOUBLE 1
-#if SAMPLE_IS_DOUBLE 
-typedef double Z;
-#else
-typedef float Z;
-#endif
 
 const double NaN = NAN;
 
@@ -90,6 +88,10 @@ struct BinaryOp
 	virtual void reduce(Thread& th, int n, V& z, V *a, int astride);
 
 	virtual void loopz(int n, const Z *a, int astride, const Z *b, int bstride, Z *out) = 0;
+	// loopz with a constant b, or a constant a, as when one side is a number.
+	// by default they run loopz with a stride of 0.
+	virtual void loopzs(int n, const Z *a, int astride, Z b, Z *out) { loopz(n, a, astride, &b, 0, out); }
+	virtual void loopsz(int n, Z a, const Z *b, int bstride, Z *out) { loopz(n, &a, 0, b, bstride, out); }
 	virtual void scanz(int n, Z& z, Z *a, int astride, Z *out) { throw errUndefinedOperation; }
 	virtual void pairsz(int n, Z& z, Z *a, int astride, Z *out) { throw errUndefinedOperation; }
 	virtual void reducez(int n, Z& z, Z *a, int astride) { throw errUndefinedOperation; }
@@ -115,10 +117,134 @@ struct BinaryOpLink : public BinaryOp
 [[noreturn]] void indefiniteOp(const char* msg1, const char* msg2);
 [[noreturn]] void notFound(Arg key);
 
+#if SAPF_NANBOX
+// the fields of a NaN boxed V. each is the whole 8 byte word of the V, read and written the way
+// the separate fields of the unboxed V are. a V holds either a number or an object, so writing f
+// or i lets go of an object, and reading them from an object gives zero.
+namespace vbox {
+	// doubles are stored as they are, except that every NaN is stored as kCanonicalNaN. an object
+	// pointer is stored in the low 48 bits of a NaN with the sign bit set, which no double has.
+	const uint64_t kTagMask = 0xFFFF000000000000ULL;
+	const uint64_t kObjectTag = 0xFFFC000000000000ULL;
+	const uint64_t kPointerMask = 0x0000FFFFFFFFFFFFULL;
+	const uint64_t kCanonicalNaN = 0x7FF8000000000000ULL;
+	
+	inline bool isObject(uint64_t bits) { return (bits & kTagMask) == kObjectTag; }
+	inline Object* object(uint64_t bits) { return isObject(bits) ? (Object*)(uintptr_t)(bits & kPointerMask) : nullptr; }
+	inline uint64_t fromObject(Object* o) { return o ? kObjectTag | (uint64_t)(uintptr_t)o : 0; }
+	inline uint64_t fromDouble(double d)
+	{
+		if (d != d) return kCanonicalNaN;
+		uint64_t bits;
+		memcpy(&bits, &d, sizeof(bits));
+		return bits;
+	}
+	inline double toDouble(uint64_t bits)
+	{
+		if (isObject(bits)) return 0.;
+		double d;
+		memcpy(&d, &bits, sizeof(d));
+		return d;
+	}
+	// defined once Object is complete.
+	inline void retain(uint64_t bits);
+	inline void release(uint64_t bits);
+	inline void assign(uint64_t& ioBits, uint64_t inBits)
+	{
+		retain(inBits);
+		uint64_t old = ioBits;
+		ioBits = inBits;
+		release(old);
+	}
+}
+
+struct VFloatField
+{
+	uint64_t bits;
+	operator double() const { return vbox::toDouble(bits); }
+	VFloatField& operator=(double d) { vbox::assign(bits, vbox::fromDouble(d)); return *this; }
+	VFloatField& operator=(VFloatField const& that) { return *this = (double)that; }
+	VFloatField& operator+=(double d) { return *this = (double)*this + d; }
+	VFloatField& operator-=(double d) { return *this = (double)*this - d; }
+	VFloatField& operator*=(double d) { return *this = (double)*this * d; }
+	VFloatField& operator/=(double d) { return *this = (double)*this / d; }
+};
+
+// integers share the bits of f. ones in the object tag's range can't be stored.
+struct VIntField
+{
+	uint64_t bits;
+	operator int64_t() const { return vbox::isObject(bits) ? 0 : (int64_t)bits; }
+	VIntField& operator=(int64_t n) { vbox::assign(bits, (uint64_t)n); return *this; }
+	VIntField& operator=(VIntField const& that) { return *this = (int64_t)that; }
+};
+
+// reads and writes like the P<Object> of the unboxed V.
+struct VObjectField
+{
+	uint64_t bits;
+	Object* operator()() const { return vbox::object(bits); }
+	Object* get() const { return vbox::object(bits); }
+	Object* operator->() const { return vbox::object(bits); }
+	Object& operator*() const { return *vbox::object(bits); }
+	operator bool() const { return vbox::isObject(bits); }
+	operator P<Object>() const { return P<Object>(vbox::object(bits)); }
+	bool operator==(Object* p) const { return vbox::object(bits) == p; }
+	bool operator!=(Object* p) const { return vbox::object(bits) != p; }
+	
+	// clearing the object of a number leaves the number.
+	void set(Object* p) { if (p || vbox::isObject(bits)) vbox::assign(bits, vbox::fromObject(p)); }
+	VObjectField& operator=(Object* p) { set(p); return *this; }
+	VObjectField& operator=(std::nullptr_t) { set(nullptr); return *this; }
+	template <typename U> VObjectField& operator=(P<U> const& p) { set(p()); return *this; }
+	VObjectField& operator=(VObjectField const& that) { set(that()); return *this; }
+};
+#endif
+
 // V - a tagged value. either a number or a pointer to an object
 class V
 {
 public:	
+#if SAPF_NANBOX
+	union {
+		uint64_t mBits;
+		double mDouble;
+		VFloatField f;
+		VIntField i;
+		VObjectField o;
+	};
+	
+	V() : mBits(0) {}
+	V(O _o) : mBits(vbox::fromObject(_o)) { vbox::retain(mBits); }
+	V(double _f) : mBits(vbox::fromDouble(_f)) {}
+	template <typename U> V(P<U> const& p) : mBits(vbox::fromObject(p())) { vbox::retain(mBits); }
+	V(V const& that) : mBits(that.mBits) { vbox::retain(mBits); }
+	V(V&& that) : mBits(that.mBits) { that.mBits = 0; }
+	~V() { vbox::release(mBits); }
+	
+	V& operator=(V const& that) { vbox::assign(mBits, that.mBits); return *this; }
+	V& operator=(V&& that)
+	{
+		if (this != &that) {
+			uint64_t old = mBits;
+			mBits = that.mBits;
+			that.mBits = 0;
+			vbox::release(old);
+		}
+		return *this;
+	}
+	
+	O asObj() const { if (!o) wrongType("asObj : v", "Object", *this); return o(); }
+
+	template <typename T>
+	void set(P<T> const& p) { o = p(); }
+	void set(O _o) { o = _o; }
+	void set(double _f) { f = _f; }
+	void set(Arg v) { *this = v; }
+	
+	// the number in place, for code that reads it through a pointer. only while this is a number.
+	double* fptr() { return &mDouble; }
+#else
     P<Object> o;
 	union {
 		double f;
@@ -138,6 +264,9 @@ public:
 	void set(double _f) { o = nullptr; f = _f; }
 	void set(Arg v) { o = v.o; f = v.f; }
 	
+	double* fptr() { return &f; }
+#endif
+	
 	double asFloat() const;
 	int64_t asInt() const;
 	
@@ -357,6 +486,11 @@ public:
 	virtual V binaryOpWithZList(Thread& th, BinaryOp* op, List* _a) { wrongType("binaryOpWithZList", "Real, or List", this); return V(); }
 };
 
+#if SAPF_NANBOX
+inline void vbox::retain(uint64_t bits) { if (Object* o = object(bits)) o->retain(); }
+inline void vbox::release(uint64_t bits) { if (Object* o = object(bits)) o->release(); }
+#endif
+
 inline double V::asFloat() const { return o ? o->asFloat()  : f; }
 inline int64_t V::asInt() const { return o ? (int64_t)o->asFloat() : (int64_t)floor(f + .5); }
 
@@ -413,7 +547,7 @@ inline bool V::isEachOp() const { return o && o->isEachOp(); }
 
 inline bool V::isZIn() const { return !o || o->isZIn(); }
 
-inline V V::chase(Thread& th, int64_t n) { return !o ? f : o->chase(th, n); }
+inline V V::chase(Thread& th, int64_t n) { return !o ? V(f) : o->chase(th, n); }
 
 
 inline bool V::Identical(Arg v) const
@@ -652,14 +786,22 @@ public:
 	
 };
 
+// closures capturing up to this many vars keep them in the Fun rather than in a separate block.
+const int kInlineFunVars = 4;
+
 class Fun : public Object
 {
 public:
 	P<FunDef> mDef;
-	std::vector<V> mVars;
+	// the captured vars. points to mInlineVars when they fit.
+	V* mVars;
+	V mInlineVars[kInlineFunVars];
 	P<GForm> mWorkspace;
 
+	// takes the captured vars from the top of the stack.
 	Fun(Thread& th, FunDef* def);
+	Fun(const Fun&) = delete;
+	Fun& operator=(const Fun&) = delete;
 	virtual ~Fun();
 	
 	virtual const char* TypeName() const override { return "Fun"; }
@@ -740,45 +882,93 @@ public:
 
 
 
+// GTable is a hash array mapped trie. Each branch splits on the next kTreeBits bits of the key
+// hash, so lookups take at most 32 / kTreeBits + 1 steps however the keys were inserted.
+const int kTreeBits = 5;
+const int kTreeWidth = 1 << kTreeBits;
+const int kTreeMask = kTreeWidth - 1;
+
 class TreeNode : public Object
 {
+public:
+	const bool mIsBranch;
+	
+	TreeNode(bool inIsBranch) : mIsBranch(inIsBranch) {}
+	
+	virtual const char* TypeName() const override { return "TreeNode"; }
+};
+
+// a binding. entries whose keys have the same hash are chained through mNext.
+class TreeEntry : public TreeNode
+{
 public:
 	V mKey;
 	V mValue;
-    int64_t mHash;
-    int64_t mSerialNumber;
-	volatile std::atomic<TreeNode*> mLeft;
-	volatile std::atomic<TreeNode*> mRight;
-	
-	TreeNode(Arg inKey, int64_t inKeyHash, Arg inValue, int64_t inSerialNumber,
-        TreeNode* inLeft, TreeNode* inRight) 
-        : mKey(inKey), mValue(inValue), mHash(inKeyHash), mSerialNumber(inSerialNumber)
-    {
-		if (inLeft) inLeft->retain();
-		if (inRight) inRight->retain();
-        mLeft.store(inLeft);
-        mRight.store(inRight);
-    }
-    
-    ~TreeNode() 
-    {
-        auto left = mLeft.load();
-        auto right = mRight.load();
-        if (left) left->release();
-        if (right) right->release();
-    }
+	int32_t mHash;
+	int64_t mSerialNumber;
+	std::atomic<TreeEntry*> mNext;
+	
+	TreeEntry(Arg inKey, int32_t inKeyHash, Arg inValue, int64_t inSerialNumber, TreeEntry* inNext)
+		: TreeNode(false), mKey(inKey), mValue(inValue), mHash(inKeyHash), mSerialNumber(inSerialNumber)
+	{
+		if (inNext) inNext->retain();
+		mNext.store(inNext);
+	}
+	
+	~TreeEntry()
+	{
+		auto next = mNext.load();
+		if (next) next->release();
+	}
+	
+	virtual const char* TypeName() const override { return "TreeEntry"; }
+};
 
-	virtual const char* TypeName() const override { return "TreeNode"; }
-    
-    TreeNode* putPure(Arg inKey, int64_t inKeyHash, Arg inValue);
+class TreeBranch : public TreeNode
+{
+public:
+	// null, a TreeEntry or a TreeBranch. each holds a reference.
+	std::atomic<TreeNode*> mSlots[kTreeWidth];
+	
+	TreeBranch() : TreeNode(true)
+	{
+		for (auto& slot : mSlots) slot.store(nullptr);
+	}
 	
-	void getAll(std::vector<P<TreeNode> >& vec);
+	// a copy sharing the children of that.
+	TreeBranch(const TreeBranch& that) : TreeNode(true)
+	{
+		for (int i = 0; i < kTreeWidth; ++i) {
+			TreeNode* node = that.mSlots[i].load(std::memory_order_acquire);
+			if (node) node->retain();
+			mSlots[i].store(node);
+		}
+	}
+	
+	~TreeBranch()
+	{
+		for (auto& slot : mSlots) {
+			auto node = slot.load();
+			if (node) node->release();
+		}
+	}
+	
+	virtual const char* TypeName() const override { return "TreeBranch"; }
+	
+	// only for branches that no other thread can see yet.
+	void setSlot(int inIndex, TreeNode* inNode)
+	{
+		if (inNode) inNode->retain();
+		TreeNode* old = mSlots[inIndex].exchange(inNode);
+		if (old) old->release();
+	}
 };
 
 
 class GTable : public Object
 {
-    volatile std::atomic<TreeNode*> mTree;  
+	// null, a TreeEntry or a TreeBranch.
+	std::atomic<TreeNode*> mTree;
 	GTable(const GTable& that) {}
 public:
 	
@@ -799,20 +989,26 @@ public:
 		
 	virtual bool get(Thread& th, Arg key, V& value) const override;
     bool getInner(Arg inKey, V& outValue) const;
+	TreeEntry* getEntry(Arg inKey) const;
 	virtual V mustGet(Thread& th, Arg key) const override;
     
+	// adds a binding to this table and every table sharing its tree. fails if key is already bound.
 	bool putImpure(Arg key, Arg value);
+	// a new table with key bound to value. this table is unchanged.
 	GTable* putPure(Arg key, int64_t keyHash, Arg value);
 		
 	using Object::print;
 	virtual void print(Thread& th, std::string& out, int depth) override;
 	virtual void printSomethingIWant(Thread& th, std::string& out, int depth);
-    
-    const TreeNode* tree() { return mTree.load(); }
 	
-	std::vector<P<TreeNode> > sorted() const;
+	// the bindings in the order they were first made.
+	std::vector<P<TreeEntry> > sorted() const;
 };
 
+// changes whenever a GForm is made or a binding is added to a GTable in place, so a lookup made
+// through a GForm is still good while the version is unchanged.
+extern std::atomic<uint64_t> gWorkspaceVersion;
+
 class GForm : public Object
 {
 public:
@@ -841,6 +1037,8 @@ public:
 	}
 	
 	virtual bool get(Thread& th, Arg key, V& value) const override;
+	// the binding of key in the nearest table that has one. it lives as long as this form.
+	TreeEntry* getEntry(Arg key) const;
 	
 	GForm* putImpure(Arg inKey, Arg inValue);
     GForm* putPure(Arg inKey, Arg inValue);
@@ -855,6 +1053,8 @@ public:
 class TableMap : public Object
 {
 public:
+	// unique for the life of the program, so caches can refer to a map without holding it.
+	const uint64_t mId;
 	size_t mSize;
 	size_t mMask;
 	size_t* mIndices;
@@ -977,6 +1177,10 @@ struct VIn : In
 struct ZIn : In
 {
 	bool mOnce = true;
+#if !SAMPLE_IS_DOUBLE
+	// mConstant as a sample, for the buffer operator() hands out. mConstant holds a double.
+	Z mZConstant = 0.f;
+#endif
 
 	ZIn();
 	ZIn(Arg inValue);
@@ -986,13 +1190,19 @@ struct ZIn : In
     bool onez(Thread& th, Z& z);
     bool peek(Thread& th, Z& z);
 	bool fill(Thread& th, int& ioNum, Z* outBuffer, int outStride);
+#if SAMPLE_IS_DOUBLE
 	bool fill(Thread& th, int& ioNum, float* outBuffer, int outStride);
+#endif
 	bool mix(Thread& th, int& ioNum, Z* outBuffer);
 	bool bench(Thread& th, int& ioNum);
 	bool link(Thread& th, List* inList);
 
 	bool fillSegment(Thread& th, int inNum, Z* outBuffer);
+	// a view of the next inNum frames if they lie within one array, otherwise null.
+	P<Array> segmentView(Thread& th, int inNum);
 	void hop(Thread& th, int framesToAdvance);
+	// where operator() points the caller for a constant.
+	Z* constantBuffer();
 };
 
 
@@ -1025,6 +1235,10 @@ public:
 	void setOut(List* inOut) { if (!mOut) mOut = inOut; }
 
 	virtual void pull(Thread& th) = 0;
+
+	// appends the inputs that producing one block reads at most one block from, for BlockSchedule.
+	// returns false if the inputs are not known. they are then only ever pulled lazily.
+	virtual bool blockInputs(std::vector<ZIn*>& outInputs) { return false; }
 	
 	void setDone();
 	void end();
@@ -1094,6 +1308,9 @@ class Array : public Object
 		V* vv;
 		Z* zz;
 	};
+	// set if this array is a view of part of another array's storage. a view that grows
+	// gets storage of its own.
+	P<Array> mParent;
 
 public:
 
@@ -1103,8 +1320,15 @@ public:
 		alloc(std::max(int64_t(1), inCap));
 	}
 	
+	// a view of inSize items of inParent starting at inOffset, which shares its storage
+	// rather than copying it.
+	Array(P<Array> const& inParent, int64_t inOffset, int64_t inSize);
+	
 	virtual ~Array();
 
+	static void* operator new(size_t inSize) { return poolAlloc(inSize); }
+	static void operator delete(void* p, size_t inSize) { poolFree(p, inSize); }
+
 	virtual const char* TypeName() const override { return "Array"; }
 	virtual bool isArray() const override { return true; }
 
@@ -1118,6 +1342,8 @@ public:
 	void alloc(int64_t inCap);
 
 	int64_t size() const { return mSize; }
+	int64_t capacity() const { return mCap; }
+	bool isView() const { return mParent() != nullptr; }
     void setSize(size_t inSize) { mSize = inSize; }
     void addSize(size_t inDelta) { mSize += inDelta; }
 	
@@ -1174,8 +1400,13 @@ public:
 class List : public Object
 {
 	P<List> mNext;
+	// a list is forced at most once: kUnforced -> kForcing -> kForced. once forced it never changes,
+	// so readers that see kForced need no lock. a failed force goes back to kUnforced.
+	enum : uint8_t { kUnforced, kForcing, kForced };
+	std::atomic<uint8_t> mForceState;
+
+	void forceSlow(Thread& th);
 public:
-    LOCK_DECLARE(mSpinLock);
 	P<Gen> mGen;
 	P<Array> mArray;
 
@@ -1190,6 +1421,9 @@ public:
 
 	virtual ~List();
 
+	static void* operator new(size_t inSize) { return poolAlloc(inSize); }
+	static void operator delete(void* p, size_t inSize) { poolFree(p, inSize); }
+
 	P<List>& next() { return mNext; }
 	List* nextp() const { return mNext(); }
 
@@ -1208,6 +1442,9 @@ public:
 	bool isV() const { return elemType == itemTypeV; }
 	bool isZ() const { return elemType == itemTypeZ; }
 	bool isPacked() const { return !mNext && !mGen; }
+	// true if the caller holds the only reference to this packed list and nothing else refers to its
+	// array or the storage under it, so the array can be changed in place instead of copied.
+	bool isUnshared() const { return getRefcount() == 1 && isPacked() && mArray->getRefcount() == 1 && !mArray->isView(); }
 	
 	virtual int64_t length(Thread& th) override;
 		
@@ -1225,7 +1462,11 @@ public:
 	List* pack(Thread& th, int limit);
 	List* packSome(Thread& th, int64_t& limit);
 	void forceAll(Thread& th);
-	void force(Thread& th);
+	void force(Thread& th)
+	{
+		if (mForceState.load(std::memory_order_acquire) != kForced)
+			forceSlow(th);
+	}
 	
 	int64_t fillz(Thread& th, int64_t n, Z* z);
 
@@ -1312,6 +1553,42 @@ public:
 
 void dumpList(List const* list);
 
+// a memo of the last name lookup made by an opcode. the stamp and owner say what the lookup
+// depended on and the target is what it found. code can run on several threads at once, so the
+// fields are guarded by a sequence lock. readers never wait: a read that overlaps a store just
+// misses, and a store that finds another store in progress is dropped.
+struct InlineCache
+{
+	std::atomic<uint64_t> mSeq{0};
+	std::atomic<uint64_t> mStamp{0};
+	std::atomic<uint64_t> mOwner{0};
+	std::atomic<uint64_t> mTarget{0};
+	
+	// stamps are never zero, so an empty cache always misses.
+	bool lookup(uint64_t inStamp, uint64_t inOwner, uint64_t& outTarget) const
+	{
+		uint64_t seq = mSeq.load(std::memory_order_acquire);
+		if (seq & 1) return false;
+		bool hit = mStamp.load(std::memory_order_relaxed) == inStamp && mOwner.load(std::memory_order_relaxed) == inOwner;
+		uint64_t target = mTarget.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (!hit || mSeq.load(std::memory_order_relaxed) != seq) return false;
+		outTarget = target;
+		return true;
+	}
+	
+	void store(uint64_t inStamp, uint64_t inOwner, uint64_t inTarget)
+	{
+		uint64_t seq = mSeq.load(std::memory_order_relaxed);
+		if ((seq & 1) || !mSeq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) return;
+		std::atomic_thread_fence(std::memory_order_release);
+		mStamp.store(inStamp, std::memory_order_relaxed);
+		mOwner.store(inOwner, std::memory_order_relaxed);
+		mTarget.store(inTarget, std::memory_order_relaxed);
+		mSeq.store(seq + 2, std::memory_order_release);
+	}
+};
+
 struct Opcode
 {
 	Opcode() : op(0) {}
@@ -1321,11 +1598,26 @@ struct Opcode
 	V v;
 };
 
+// the compact form of an Opcode that the interpreter runs. a is an index into Code::consts for
+// ops whose operand is a value, otherwise the integer operand. b is the second operand of a
+// superinstruction.
+struct Instr
+{
+	uint16_t op;
+	uint16_t b;
+	uint32_t a;
+};
+
 class Code : public Object
 {
 public:
 	std::vector<Opcode> ops;
 	std::vector<V> keys;
+	
+	// made from ops by compact().
+	std::vector<Instr> instrs;
+	std::vector<V> consts;
+	std::unique_ptr<InlineCache[]> caches;
 
 	Code(int64_t capacity) : Object() { ops.reserve(capacity); }
 	virtual ~Code();
@@ -1334,11 +1626,14 @@ public:
 
 	virtual bool isCode() const { return true; }
 
+	// called once the code is complete. also makes the compact form.
 	void shrinkToFit();
+	void compact();
 	
 	int64_t size() { return ops.size(); }
 	
 	Opcode* getOps() { return &ops[0]; }
+	Instr* getInstrs() { return &instrs[0]; }
 	
 	void addAll(P<Code> const& that);
 
@@ -51,10 +51,20 @@ enum {
 	
 	opReturn,
 	
+	// superinstructions. only in the compact code made by Code::compact.
+	opPushImmCallImm,
+	opPushLocalCallImm,
+	opPushLocalPushLocal,
+	opBindLocalBindLocal,
+	
 	kNumOpcodes
 };
 
 extern const char* opcode_name[kNumOpcodes];
+
+// whether workspace variable and dot lookups are memoized in each opcode's InlineCache.
+void setInlineCaching(bool inEnabled);
+bool inlineCaching();
 	
 #endif
 
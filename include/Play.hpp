@@ -15,6 +15,7 @@
 //    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "VM.hpp"
+#include <string>
 
 void playWithPlayer(Thread& th, V& v);
 void recordWithPlayer(Thread& th, V& v, Arg filename);
@@ -22,3 +23,25 @@ void recordWithPlayer(Thread& th, V& v, Arg filename);
 void stopPlaying();
 void stopPlayingIfDone();
 
+// number of blocks rendered ahead of the audio callback by a worker thread. 0 renders in the callback.
+void setPlayAhead(int numBlocks);
+int playAhead();
+void postPlayStats();
+
+// audio output settings for players started afterwards. only used by the RtAudio backend.
+struct PlayConfig {
+	// output device, as a device id or a name or part of one. empty uses the default output device.
+	std::string device;
+	// frames per audio callback requested from the device. the device may choose another size.
+	int bufferFrames{256};
+	// realtime scheduling priority of the audio callback thread. 0 leaves scheduling to the driver.
+	int priority{0};
+	// cpu to pin the audio callback thread to, where the platform allows it. -1 doesn't pin it.
+	int cpu{-1};
+};
+
+PlayConfig playConfig();
+void setPlayConfig(const PlayConfig& config);
+// prints the output devices that PlayConfig::device can select.
+void postAudioDevices();
+
@@ -0,0 +1,82 @@
+#pragma once
+
+#ifndef SAPF_AUDIOTOOLBOX
+#include "ringbuffer.hpp"
+#include "Buffers.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// upper bound on the configurable lookahead, in blocks. Must be a power of 2 (ring size).
+constexpr int kMaxRenderAheadBlocks{64};
+
+/*!
+ * Renders audio ahead of the realtime audio callback on a dedicated worker thread.
+ * The worker renders whole blocks (all channels, non-interleaved) into preallocated slots
+ * and hands them to the callback through a lock-free SPSC ring of slot indices. Consumed
+ * slots travel back through a second ring. The callback only copies samples out of slots,
+ * so it never allocates, forces lazy lists, takes a lock or posts.
+ * If the callback finds no rendered block it outputs silence and counts an underrun.
+ * Only one thread may call read().
+ */
+class RenderAhead {
+public:
+    // renders inNumFrames frames of every channel into the buffers. Returns true once all
+    // channels have ended. Called on the worker thread only.
+    using RenderFunc = std::function<bool(RtBuffers& buffers, int inNumFrames)>;
+
+    RenderAhead(int numChannels, int blockFrames, int numBlocks, RenderFunc render);
+    ~RenderAhead();
+
+    // starts the worker and blocks until the lookahead is full or the render has ended.
+    void start();
+    // stops and joins the worker.
+    void stop();
+
+    // realtime safe. copies the next nBufferFrames frames into buffers. Returns true once
+    // everything rendered has been played.
+    bool read(const RtBuffers& buffers, unsigned int nBufferFrames);
+
+    int numBlocks() const { return mNumBlocks; }
+    int blockFrames() const { return mBlockFrames; }
+    int64_t underruns() const { return mUnderruns.load(std::memory_order_relaxed); }
+    int64_t underrunFrames() const { return mUnderrunFrames.load(std::memory_order_relaxed); }
+    int64_t blocksRendered() const { return mBlocksRendered.load(std::memory_order_relaxed); }
+
+private:
+    void renderLoop();
+    float* slotData(uint32_t slot) { return mSlotData.data() + static_cast<size_t>(slot) * mNumChannels * mBlockFrames; }
+
+    const int mNumChannels;
+    const int mBlockFrames;
+    const int mNumBlocks;
+    RenderFunc mRender;
+
+    std::vector<float> mSlotData;
+    // number of valid frames in each slot. written before the slot is queued.
+    std::vector<int> mSlotFrames;
+
+    // slots rendered and waiting to be played.
+    jnk0le::Ringbuffer<uint32_t, kMaxRenderAheadBlocks> mReady;
+    // slots played and waiting to be rendered into.
+    jnk0le::Ringbuffer<uint32_t, kMaxRenderAheadBlocks> mFree;
+
+    std::thread mWorkerThread;
+    std::mutex mWorkerMutex;
+    std::condition_variable mSlotFreedCondition;
+    std::atomic<bool> mRunning{false};
+    std::atomic<bool> mRenderDone{false};
+
+    // consumer state. only touched by read().
+    int64_t mCurrentSlot{-1};
+    int mCurrentOffset{0};
+
+    std::atomic<int64_t> mUnderruns{0};
+    std::atomic<int64_t> mUnderrunFrames{0};
+    std::atomic<int64_t> mBlocksRendered{0};
+};
+
+#endif // SAPF_AUDIOTOOLBOX
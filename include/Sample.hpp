@@ -0,0 +1,16 @@
+#pragma once
+
+// the type of a signal sample. Kept apart from Object.hpp so that code compiled for a specific
+// instruction set (src/simd) can use it without pulling in the rest of the interpreter.
+// float_samples in meson.options builds with 32 bit samples.
+#if SAPF_FLOAT_SAMPLES
+#define SAMPLE_IS_DOUBLE 0
+#else
+#define SAMPLE_IS_DOUBLE 1
+#endif
+
+#if SAMPLE_IS_DOUBLE
+typedef double Z;
+#else
+typedef float Z;
+#endif
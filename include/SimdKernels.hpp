@@ -0,0 +1,62 @@
+#pragma once
+
+#ifndef SAPF_ACCELERATE
+#include "Sample.hpp"
+#include <vector>
+
+// the math ops of MathOps.cpp that have a kernel, by op name. Every entry gets a field in
+// SimdKernels and must have a function of the same name in SimdMath (SimdKernelsImpl.hpp).
+#define SAPF_SIMD_UNARY_KERNELS(X) \
+    X(logb) X(sgn) X(erf) X(erfc) X(rint) X(sqrt) X(rsqrt) X(cbrt) \
+    X(cb) X(pow4) X(pow5) X(pow6) X(pow7) X(pow8) X(pow9) \
+    X(exp) X(exp2) X(expm1) X(log) X(log2) X(log10) X(log1p) X(exp10) \
+    X(sinc) X(sin) X(cos) X(sin1) X(cos1) X(tan) X(asin) X(acos) X(atan) \
+    X(sinh) X(cosh) X(tanh) X(asinh) X(acosh) X(atanh) X(tgamma) X(lgamma) \
+    X(cmpl) X(ampdb) X(dbamp) X(hzo) X(ohz) X(hzst) X(sthz) X(hznn) X(nnhz) \
+    X(centsratio) X(ratiocents) X(semiratio) X(ratiosemi) X(distort) X(softclip) \
+    X(rectWin) X(triWin) X(bitriWin) X(hanWin) X(sinWin) X(ramp) X(scurve) X(sigm) \
+    X(zapgremlins)
+
+#define SAPF_SIMD_BINARY_KERNELS(X) \
+    X(mul) X(copysign) X(nextafter) X(atan2) X(pow) X(hypot) X(dim) X(avg2) X(absdif) \
+    X(sumsq) X(difsq) X(sqsum) X(sqdif) X(thresh) X(absthresh) X(amclip) X(scaleneg) \
+    X(ring1) X(ring2) X(ring3) X(ring4) X(clip2) X(wrap2) X(fold2) X(excess) \
+    X(clip0) X(wrap0) X(fold0) X(round) X(roundUp) X(trunc)
+
+// inputs are read every stride frames: 1 for a contiguous array, 0 for a constant repeated n
+// times, anything else is gathered. out is always contiguous and may be the same array as a
+// contiguous input.
+using SimdUnaryKernel = void (*)(int n, const Z* a, int astride, Z* out);
+using SimdBinaryKernel = void (*)(int n, const Z* a, int astride, const Z* b, int bstride, Z* out);
+
+/*!
+ * The SIMD kernels behind the hottest signal loops: the math ops, oscillator sines, windowing
+ * and the conversion of samples for output.
+ * Each set of kernels is compiled once per instruction set (src/simd, one translation unit per
+ * xsimd architecture, each built with its own -m flags) and the best one the CPU supports is
+ * picked the first time simdKernels() is called, so a binary built for a baseline -march still
+ * runs these loops with AVX2 or AVX-512 where the CPU has them.
+ */
+struct SimdKernels {
+    // the xsimd architecture the kernels were compiled for, e.g. "avx2".
+    const char* name;
+
+#define SAPF_SIMD_UNARY_FIELD(NAME) SimdUnaryKernel NAME;
+#define SAPF_SIMD_BINARY_FIELD(NAME) SimdBinaryKernel NAME;
+    SAPF_SIMD_UNARY_KERNELS(SAPF_SIMD_UNARY_FIELD)
+    SAPF_SIMD_BINARY_KERNELS(SAPF_SIMD_BINARY_FIELD)
+#undef SAPF_SIMD_UNARY_FIELD
+#undef SAPF_SIMD_BINARY_FIELD
+
+    // contiguous arrays only.
+    void (*toFloat)(int n, const Z* a, float* out);
+};
+
+// the kernels for the best instruction set this CPU supports. Chosen once, on the first call.
+// the SAPF_SIMD environment variable may name a lower one, e.g. SAPF_SIMD=sse2.
+const SimdKernels& simdKernels();
+
+// every set of kernels built in that this CPU can run, best first.
+std::vector<const SimdKernels*> availableSimdKernels();
+
+#endif // SAPF_ACCELERATE
@@ -0,0 +1,370 @@
+#pragma once
+
+// The kernels of SimdKernels.hpp, written once against xsimd and instantiated for each
+// architecture by the files in src/simd. Only include this from a translation unit that is
+// compiled for a single instruction set, and keep it free of the interpreter headers: anything
+// inline it pulls in gets compiled with that unit's -m flags.
+
+#include "SimdKernels.hpp"
+#include <xsimd/xsimd.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+// the math ops, one batch at a time. Each one computes what the scalar code of the op of the
+// same name in MathOps.cpp does, with the branches turned into selects. The transcendental
+// functions are xsimd's, which stay within a few ulp of libm.
+template <class Arch>
+struct SimdMath {
+    using ZBatch = xsimd::batch<Z, Arch>;
+#if SAMPLE_IS_DOUBLE
+    using ZBits = int64_t;
+    static constexpr int kMantissaBits{52};
+    static constexpr ZBits kExponentMask{0x7FF};
+    static constexpr Z kExponentBias{1023.};
+#else
+    using ZBits = int32_t;
+    static constexpr int kMantissaBits{23};
+    static constexpr ZBits kExponentMask{0xFF};
+    static constexpr Z kExponentBias{127.f};
+#endif
+    using ZBitsBatch = xsimd::batch<ZBits, Arch>;
+    using ZBool = xsimd::batch_bool<Z, Arch>;
+
+    static constexpr Z kPi{Z(3.14159265358979323846)};
+    static constexpr Z kTwoPi{Z(2. * 3.14159265358979323846)};
+    static constexpr Z kOneOver440{Z(0.002272727272727272727272727)};
+    static constexpr Z kOneTwelfth{Z(0.08333333333333333333333333)};
+
+    static ZBatch k(Z x) { return ZBatch(x); }
+
+    static ZBatch clamp(ZBatch a, ZBatch lo, ZBatch hi) {
+        return xsimd::select(a < lo, lo, xsimd::select(hi < a, hi, a));
+    }
+    // x outside of [0, 1], where the windows are 0.
+    static ZBool outsideWindow(ZBatch x) { return (x < k(0)) | (x > k(1)); }
+
+    // extracts the IEEE 754 exponent bits and removes the bias.
+    static ZBatch logb(ZBatch a) {
+        const ZBitsBatch bits = xsimd::bitwise_cast<ZBits>(a);
+        return xsimd::to_float((bits >> kMantissaBits) & kExponentMask) - k(kExponentBias);
+    }
+    static ZBatch sgn(ZBatch a) { return xsimd::select(a < k(0), k(-1), xsimd::select(a > k(0), k(1), k(0))); }
+    static ZBatch erf(ZBatch a) { return xsimd::erf(a); }
+    static ZBatch erfc(ZBatch a) { return xsimd::erfc(a); }
+    static ZBatch rint(ZBatch a) { return xsimd::nearbyint(a); }
+    static ZBatch sqrt(ZBatch a) {
+        const ZBatch s = xsimd::sqrt(xsimd::abs(a));
+        return xsimd::select(a < k(0), -s, s);
+    }
+    static ZBatch rsqrt(ZBatch a) { return k(1) / sqrt(a); }
+    static ZBatch cbrt(ZBatch a) { return xsimd::cbrt(a); }
+
+    static ZBatch cb(ZBatch a) { return a * a * a; }
+    static ZBatch pow4(ZBatch a) { const ZBatch a2 = a * a; return a2 * a2; }
+    static ZBatch pow5(ZBatch a) { const ZBatch a2 = a * a; return a2 * a2 * a; }
+    static ZBatch pow6(ZBatch a) { const ZBatch a3 = a * a * a; return a3 * a3; }
+    static ZBatch pow7(ZBatch a) { const ZBatch a3 = a * a * a; return a3 * a3 * a; }
+    static ZBatch pow8(ZBatch a) { const ZBatch a2 = a * a; const ZBatch a4 = a2 * a2; return a4 * a4; }
+    static ZBatch pow9(ZBatch a) { const ZBatch a3 = a * a * a; return a3 * a3 * a3; }
+
+    static ZBatch exp(ZBatch a) { return xsimd::exp(a); }
+    static ZBatch exp2(ZBatch a) { return xsimd::exp2(a); }
+    static ZBatch expm1(ZBatch a) { return xsimd::expm1(a); }
+    static ZBatch log(ZBatch a) { return xsimd::log(xsimd::abs(a)); }
+    static ZBatch log2(ZBatch a) { return xsimd::log2(xsimd::abs(a)); }
+    static ZBatch log10(ZBatch a) { return xsimd::log10(xsimd::abs(a)); }
+    static ZBatch log1p(ZBatch a) { return xsimd::log1p(a); }
+    static ZBatch exp10(ZBatch a) { return xsimd::exp10(a); }
+
+    static ZBatch sinc(ZBatch a) { return xsimd::select(a == k(0), k(1), xsimd::sin(a) / a); }
+    static ZBatch sin(ZBatch a) { return xsimd::sin(a); }
+    static ZBatch cos(ZBatch a) { return xsimd::cos(a); }
+    static ZBatch sin1(ZBatch a) { return xsimd::sin(a * kTwoPi); }
+    static ZBatch cos1(ZBatch a) { return xsimd::cos(a * kTwoPi); }
+    static ZBatch tan(ZBatch a) { return xsimd::tan(a); }
+    static ZBatch asin(ZBatch a) { return xsimd::asin(a); }
+    static ZBatch acos(ZBatch a) { return xsimd::acos(a); }
+    static ZBatch atan(ZBatch a) { return xsimd::atan(a); }
+    static ZBatch sinh(ZBatch a) { return xsimd::sinh(a); }
+    static ZBatch cosh(ZBatch a) { return xsimd::cosh(a); }
+    static ZBatch tanh(ZBatch a) { return xsimd::tanh(a); }
+    static ZBatch asinh(ZBatch a) { return xsimd::asinh(a); }
+    static ZBatch acosh(ZBatch a) { return xsimd::acosh(a); }
+    static ZBatch atanh(ZBatch a) { return xsimd::atanh(a); }
+    static ZBatch tgamma(ZBatch a) { return xsimd::tgamma(a); }
+    static ZBatch lgamma(ZBatch a) { return xsimd::lgamma(a); }
+
+    static ZBatch cmpl(ZBatch a) { return k(1) - a; }
+    static ZBatch ampdb(ZBatch a) { return log10(a) * Z(20); }
+    static ZBatch dbamp(ZBatch a) { return xsimd::exp10(a * Z(.05)); }
+    static ZBatch hzo(ZBatch a) { return log2(a * kOneOver440) + Z(.75); }
+    static ZBatch ohz(ZBatch a) { return xsimd::exp2(a - Z(.75)) * Z(440); }
+    static ZBatch hzst(ZBatch a) { return log2(a * kOneOver440) * Z(12) + Z(9); }
+    static ZBatch sthz(ZBatch a) { return xsimd::exp2((a - Z(9)) * kOneTwelfth) * Z(440); }
+    static ZBatch hznn(ZBatch a) { return log2(a * kOneOver440) * Z(12) + Z(69); }
+    static ZBatch nnhz(ZBatch a) { return xsimd::exp2((a - Z(69)) * kOneTwelfth) * Z(440); }
+    static ZBatch centsratio(ZBatch a) { return xsimd::exp2(a * Z(0.00083333333333)); }
+    static ZBatch ratiocents(ZBatch a) { return log2(a) * Z(1200); }
+    static ZBatch semiratio(ZBatch a) { return xsimd::exp2(a * kOneTwelfth); }
+    static ZBatch ratiosemi(ZBatch a) { return log2(a) * kOneTwelfth; }
+
+    static ZBatch distort(ZBatch a) { return a / (k(1) + xsimd::abs(a)); }
+    static ZBatch softclip(ZBatch a) {
+        const ZBatch absa = xsimd::abs(a);
+        return xsimd::select(absa <= k(.5), a, (absa - Z(.25)) / a);
+    }
+    static ZBatch rectWin(ZBatch a) { return xsimd::select(outsideWindow(a), k(0), k(1)); }
+    static ZBatch triWin(ZBatch a) {
+        return xsimd::select(outsideWindow(a), k(0), xsimd::select(a < k(.5), a * Z(2), k(2) - a * Z(2)));
+    }
+    static ZBatch bitriWin(ZBatch a) {
+        const ZBatch absa = xsimd::abs(a);
+        return xsimd::select(absa > k(1), k(0), k(1) - absa);
+    }
+    static ZBatch hanWin(ZBatch a) {
+        return xsimd::select(outsideWindow(a), k(0), k(.5) - xsimd::cos(a * kTwoPi) * Z(.5));
+    }
+    static ZBatch sinWin(ZBatch a) { return xsimd::select(outsideWindow(a), k(0), xsimd::sin(a * kPi)); }
+    static ZBatch ramp(ZBatch a) { return xsimd::select(a <= k(0), k(0), xsimd::select(a >= k(1), k(1), a)); }
+    static ZBatch scurve(ZBatch a) {
+        return xsimd::select(a <= k(0), k(0), xsimd::select(a >= k(1), k(1), (a * a) * (k(3) - a * Z(2))));
+    }
+    static ZBatch sigm(ZBatch a) { return a / xsimd::sqrt(k(1) + a * a); }
+    // denormals, infinities and NaNs become 0.
+    static ZBatch zapgremlins(ZBatch a) {
+        const ZBatch absa = xsimd::abs(a);
+        return xsimd::select((absa > k(Z(1e-15))) & (absa < k(Z(1e15))), a, k(0));
+    }
+
+    static ZBatch mul(ZBatch a, ZBatch b) { return a * b; }
+    static ZBatch copysign(ZBatch a, ZBatch b) { return xsimd::copysign(a, b); }
+    // one step of the bits toward b, away from zero when b is on the far side of a.
+    static ZBatch nextafter(ZBatch a, ZBatch b) {
+        const ZBitsBatch bits = xsimd::bitwise_cast<ZBits>(a);
+        const ZBatch up = xsimd::bitwise_cast<Z>(bits + ZBits(1));
+        const ZBatch down = xsimd::bitwise_cast<Z>(bits - ZBits(1));
+        const ZBatch smallest = xsimd::bitwise_cast<Z>(ZBitsBatch(ZBits(1)));
+        ZBatch result = xsimd::select(~((a < b) ^ (a > k(0))), up, down);
+        result = xsimd::select(a == k(0), xsimd::select(b > k(0), smallest, -smallest), result);
+        result = xsimd::select(a == b, b, result);
+        return xsimd::select(xsimd::isnan(a) | xsimd::isnan(b), a + b, result);
+    }
+    static ZBatch atan2(ZBatch a, ZBatch b) { return xsimd::atan2(a, b); }
+    // negative bases keep their sign unless the exponent is an even integer.
+    static ZBatch pow(ZBatch a, ZBatch b) {
+        const ZBool negative = a < k(0);
+        const ZBatch p = xsimd::pow(xsimd::select(negative, -a, a), b);
+        const ZBatch half = b * Z(.5);
+        const ZBool even = (b == xsimd::floor(b)) & (half == xsimd::floor(half));
+        return xsimd::select(negative & ~even, -p, p);
+    }
+    static ZBatch hypot(ZBatch a, ZBatch b) { return xsimd::hypot(a, b); }
+    static ZBatch dim(ZBatch a, ZBatch b) { return xsimd::fdim(a, b); }
+    static ZBatch avg2(ZBatch a, ZBatch b) { return (a + b) * Z(.5); }
+    static ZBatch absdif(ZBatch a, ZBatch b) { return xsimd::abs(a - b); }
+    static ZBatch sumsq(ZBatch a, ZBatch b) { return a * a + b * b; }
+    static ZBatch difsq(ZBatch a, ZBatch b) { return a * a - b * b; }
+    static ZBatch sqsum(ZBatch a, ZBatch b) { const ZBatch s = a + b; return s * s; }
+    static ZBatch sqdif(ZBatch a, ZBatch b) { const ZBatch d = a - b; return d * d; }
+    static ZBatch thresh(ZBatch a, ZBatch b) { return xsimd::select(a < b, k(0), a); }
+    static ZBatch absthresh(ZBatch a, ZBatch b) { return xsimd::select(xsimd::abs(a) < b, k(0), a); }
+    static ZBatch amclip(ZBatch a, ZBatch b) { return xsimd::select(b <= k(0), k(0), a * b); }
+    static ZBatch scaleneg(ZBatch a, ZBatch b) { return xsimd::select(a < k(0), a * b, a); }
+    static ZBatch ring1(ZBatch a, ZBatch b) { return a * b + a; }
+    static ZBatch ring2(ZBatch a, ZBatch b) { return a * b + a + b; }
+    static ZBatch ring3(ZBatch a, ZBatch b) { return a * a * b; }
+    static ZBatch ring4(ZBatch a, ZBatch b) { return a * b * (a - b); }
+
+    // sc_wrap. the fast paths are kept, not folded into the general case, so that values within
+    // one range of [lo, hi) come out exactly as the scalar code gives them.
+    static ZBatch wrap(ZBatch in, ZBatch lo, ZBatch hi) {
+        const ZBatch range = hi - lo;
+        const ZBool above = in >= hi;
+        const ZBool below = in < lo;
+        const ZBatch shifted = xsimd::select(above, in - range, in + range);
+        const ZBool shiftedIn = (above & (shifted < hi)) | (below & (shifted >= lo));
+        const ZBatch general = shifted - range * xsimd::floor((shifted - lo) / range);
+        const ZBatch outside = xsimd::select(shiftedIn, shifted, xsimd::select(hi == lo, lo, general));
+        return xsimd::select(above | below, outside, in);
+    }
+    // sc_fold, likewise.
+    static ZBatch fold(ZBatch in, ZBatch lo, ZBatch hi) {
+        const ZBool above = in >= hi;
+        const ZBool below = in < lo;
+        const ZBatch reflected = xsimd::select(above, hi + hi - in, lo + lo - in);
+        const ZBool reflectedIn = (above & (reflected >= lo)) | (below & (reflected < hi));
+        const ZBatch x = in - lo;
+        const ZBatch range = hi - lo;
+        const ZBatch range2 = range + range;
+        ZBatch c = x - range2 * xsimd::floor(x / range2);
+        c = xsimd::select(c >= range, range2 - c, c);
+        const ZBatch outside = xsimd::select(reflectedIn, reflected, xsimd::select(hi == lo, lo, c + lo));
+        return xsimd::select(above | below, outside, in);
+    }
+    static ZBatch clip2(ZBatch a, ZBatch b) { return clamp(a, -b, b); }
+    static ZBatch wrap2(ZBatch a, ZBatch b) { return wrap(a, -b, b); }
+    static ZBatch fold2(ZBatch a, ZBatch b) { return fold(a, -b, b); }
+    static ZBatch excess(ZBatch a, ZBatch b) { return a - clamp(a, -b, b); }
+    static ZBatch clip0(ZBatch a, ZBatch b) { return clamp(a, k(0), b); }
+    static ZBatch wrap0(ZBatch a, ZBatch b) { return wrap(a, k(0), b); }
+    static ZBatch fold0(ZBatch a, ZBatch b) { return fold(a, k(0), b); }
+    static ZBatch round(ZBatch a, ZBatch b) {
+        return xsimd::select(b == k(0), a, xsimd::floor(a / b + Z(.5)) * b);
+    }
+    static ZBatch roundUp(ZBatch a, ZBatch b) { return xsimd::select(b == k(0), a, xsimd::ceil(a / b) * b); }
+    static ZBatch trunc(ZBatch a, ZBatch b) { return xsimd::select(b == k(0), a, xsimd::floor(a / b) * b); }
+};
+
+template <class Arch>
+struct SimdKernelsFor {
+    using ZBatch = typename SimdMath<Arch>::ZBatch;
+    using ZBits = typename SimdMath<Arch>::ZBits;
+    using ZBitsBatch = typename SimdMath<Arch>::ZBitsBatch;
+    static constexpr int kSize{static_cast<int>(ZBatch::size)};
+
+    static constexpr std::size_t kAlignment{Arch::alignment()};
+
+    static bool isAligned(const void* p) {
+        return (reinterpret_cast<std::uintptr_t>(p) & (kAlignment - 1)) == 0;
+    }
+
+    // an input read every stride frames: contiguous loads, a broadcast constant or a gather.
+    struct Input {
+        Input(const Z* inP, int inStride)
+            : p{inP}, stride{inStride}, constant{inStride == 0 ? *inP : Z(0)}, index{strideIndex(inStride)} {}
+
+        ZBatch load(int i) const {
+            if (stride == 1) return ZBatch::load_unaligned(p + i);
+            if (stride == 0) return constant;
+            return ZBatch::gather(p + static_cast<std::ptrdiff_t>(i) * stride, index);
+        }
+        // the count frames from i on, padded to a whole batch.
+        ZBatch loadTail(int i, int count) const {
+            alignas(kAlignment) Z tail[kSize] = {};
+            for (int j = 0; j < count; ++j) tail[j] = p[static_cast<std::ptrdiff_t>(i + j) * stride];
+            return ZBatch::load_aligned(tail);
+        }
+
+        static ZBitsBatch strideIndex(int stride) {
+            alignas(kAlignment) ZBits index[kSize];
+            for (int j = 0; j < kSize; ++j) index[j] = static_cast<ZBits>(j) * stride;
+            return ZBitsBatch::load_aligned(index);
+        }
+
+        const Z* p;
+        int stride;
+        ZBatch constant;
+        ZBitsBatch index;
+    };
+
+    static void storeTail(ZBatch r, int count, Z* out) {
+        alignas(kAlignment) Z tail[kSize];
+        r.store_aligned(tail);
+        std::memcpy(out, tail, count * sizeof(Z));
+    }
+
+    // runs Op over whole batches of a, with aligned loads and stores when every buffer allows
+    // them, as they do for blocks of pooled arrays. The frames left at the end go through one
+    // more batch on a padded copy, so they get the same vector code as the rest.
+    template <ZBatch (*Op)(ZBatch)>
+    static void unary(int n, const Z* a, int astride, Z* out) {
+        if (n <= 0) return;
+        if (astride == 0) {
+            alignas(kAlignment) Z r[kSize];
+            Op(ZBatch(*a)).store_aligned(r);
+            std::fill(out, out + n, r[0]);
+            return;
+        }
+        const int whole = n - n % kSize;
+        const Input A(a, astride);
+        if (astride == 1 && isAligned(a) && isAligned(out)) {
+            for (int i = 0; i < whole; i += kSize) {
+                Op(ZBatch::load_aligned(a + i)).store_aligned(out + i);
+            }
+        } else if (astride == 1) {
+            for (int i = 0; i < whole; i += kSize) {
+                Op(ZBatch::load_unaligned(a + i)).store_unaligned(out + i);
+            }
+        } else {
+            for (int i = 0; i < whole; i += kSize) {
+                Op(A.load(i)).store_unaligned(out + i);
+            }
+        }
+        if (whole < n) storeTail(Op(A.loadTail(whole, n - whole)), n - whole, out + whole);
+    }
+
+    template <ZBatch (*Op)(ZBatch, ZBatch)>
+    static void binary(int n, const Z* a, int astride, const Z* b, int bstride, Z* out) {
+        if (n <= 0) return;
+        if (astride == 0 && bstride == 0) {
+            alignas(kAlignment) Z r[kSize];
+            Op(ZBatch(*a), ZBatch(*b)).store_aligned(r);
+            std::fill(out, out + n, r[0]);
+            return;
+        }
+        const int whole = n - n % kSize;
+        const Input A(a, astride);
+        const Input B(b, bstride);
+        if (astride == 1 && bstride == 1 && isAligned(a) && isAligned(b) && isAligned(out)) {
+            for (int i = 0; i < whole; i += kSize) {
+                Op(ZBatch::load_aligned(a + i), ZBatch::load_aligned(b + i)).store_aligned(out + i);
+            }
+        } else if (astride == 1 && bstride == 1) {
+            for (int i = 0; i < whole; i += kSize) {
+                Op(ZBatch::load_unaligned(a + i), ZBatch::load_unaligned(b + i)).store_unaligned(out + i);
+            }
+        } else if (astride == 1 && bstride == 0) {
+            // a signal and a number, as in most gains and offsets.
+            for (int i = 0; i < whole; i += kSize) {
+                Op(ZBatch::load_unaligned(a + i), B.constant).store_unaligned(out + i);
+            }
+        } else if (astride == 0 && bstride == 1) {
+            for (int i = 0; i < whole; i += kSize) {
+                Op(A.constant, ZBatch::load_unaligned(b + i)).store_unaligned(out + i);
+            }
+        } else {
+            for (int i = 0; i < whole; i += kSize) {
+                Op(A.load(i), B.load(i)).store_unaligned(out + i);
+            }
+        }
+        if (whole < n) storeTail(Op(A.loadTail(whole, n - whole), B.loadTail(whole, n - whole)), n - whole, out + whole);
+    }
+
+    // a plain loop: compiled in each architecture's unit, the compiler vectorizes the narrowing
+    // with that architecture's instructions.
+    static void toFloat(int n, const Z* a, float* out) {
+        for (int i = 0; i < n; ++i) out[i] = static_cast<float>(a[i]);
+    }
+};
+
+template <class Arch>
+SimdKernels makeSimdKernels(const char* name) {
+    using K = SimdKernelsFor<Arch>;
+    using M = SimdMath<Arch>;
+    SimdKernels kernels{};
+    kernels.name = name;
+#define SAPF_SIMD_SET_UNARY(NAME) kernels.NAME = &K::template unary<&M::NAME>;
+#define SAPF_SIMD_SET_BINARY(NAME) kernels.NAME = &K::template binary<&M::NAME>;
+    SAPF_SIMD_UNARY_KERNELS(SAPF_SIMD_SET_UNARY)
+    SAPF_SIMD_BINARY_KERNELS(SAPF_SIMD_SET_BINARY)
+#undef SAPF_SIMD_SET_UNARY
+#undef SAPF_SIMD_SET_BINARY
+    kernels.toFloat = &K::toFloat;
+    return kernels;
+}
+
+} // namespace
+
+// the kernels of each architecture built as its own unit. Only declared for the architectures
+// the build compiles (see meson.build).
+#if SAPF_SIMD_DISPATCH_X86
+const SimdKernels* simdKernelsSse2();
+const SimdKernels* simdKernelsSse4_2();
+const SimdKernels* simdKernelsAvx2();
+const SimdKernels* simdKernelsAvx512();
+#endif
@@ -8,6 +8,7 @@
 #include <sndfile.h>
 #include <CDSPResampler.h>
 #include "AsyncAudioFileWriter.hpp"
+#include "MappedWavFile.hpp"
 
 class SndfileSoundFile {
 public:
@@ -35,25 +36,38 @@ public:
 	// will be flushed when this object is destructed.
 	void writeAsync(const RtBuffers& buffers, unsigned int nBufferFrames) const;
 
-	static std::unique_ptr<SndfileSoundFile> open(const char *path, double threadSampleRate, int maxBufLen);
+	// if the file is a WAV file, its samples are read straight out of a memory mapping of the file
+	// (see MappedWavFile) unless allowMapping is false.
+	// if the file must be resampled and SAPF_RESAMPLE_CACHE names a directory, the resampled audio
+	// is cached there, keyed by the file's path, size, modification time and the thread sample rate,
+	// and later opens of the same file at the same rate read the cached audio instead.
+	static std::unique_ptr<SndfileSoundFile> open(const char *path, double threadSampleRate, int maxBufLen,
+		bool allowMapping = true);
+	// whether pull reads from a memory mapping rather than through libsndfile.
+	bool isMapped() const { return mMapped != nullptr; }
 	// async parameter determines whether async writing should be supported (writeAsync) or not (write).
 	// they are mutually exclusive.
 	static std::unique_ptr<SndfileSoundFile> create(const char *path, int numChannels, double threadSampleRate,
 		double fileSampleRate, bool interleaved, int maxBufLen, bool async);
 private:
-	void readUntilResamplerOutput(double *interleaved);
 	void endOfInputFile();
 
 	void pullWithoutResampling(uint32_t *framesRead, PortableBuffers &buffers, int requestedOutputFrames) const;
 	void pullWithResampling(uint32_t *framesRead, PortableBuffers &buffers, int requestedOutputFrames);
 
-	uint32_t readAndResample(PortableBuffers &buffers, int requestedOutputFrames,
-	                         double *interleaved);
-	uint32_t resampleTail(uint32_t framesAlreadyOutput, PortableBuffers &buffers, int requestedOutputFrames);
+	// reads the next chunk of the file into mResamplerInputs and returns the number of frames read.
+	int readInputChunk();
+	// resamples the next chunk of input (or silence, to flush the resamplers once the file has
+	// ended) and appends the output to mResampled.
+	void resampleNextChunk();
+	void resampleChannels(int inputFrames, std::vector<int> &outputFrames);
+	void deInterleaveChunk(int numFrames);
+
+	void writeToCache(int start, int numFrames);
+	void finishCache();
 
-	static void deInterleaveAudio(const double *interleavedData, double *channelBuffer, int numFrames, int numChannels,
-	                              int channelIndex);
 	static int readFramesFromFile(SNDFILE *sndfile, double *interleavedBuffer, int framesToRead);
+	static int readFramesFromFile(SNDFILE *sndfile, float *interleavedBuffer, int framesToRead);
 	static std::vector<std::unique_ptr<r8b::CDSPResampler>> initResamplers(int numChannels, double fileSampleRate,
 	                                                                double threadSampleRate, int resamplerInputBufLen);
 
@@ -79,13 +93,25 @@ private:
 
 	// we need one per channel because the resampler is stateful
 	const std::vector<std::unique_ptr<r8b::CDSPResampler>> mResamplers;
-	// holds the de-interleaved channel input for feeding into the resampler.
-	// Since we need to read more (or less) frames of input in order to produce
-	// a specific number of output frames, this isn't always going to be the same size as
-	// the PortableBuffers
+	// holds the de-interleaved channel input for feeding into the resampler. the resamplers
+	// work in double whatever Z is, so everything up to mResampled stays double.
+	// the file is read in chunks of mResamplerInputBufLen frames, which is much larger than the
+	// PortableBuffers, so that the resamplers run on long runs of input.
 	std::vector<std::vector<double>> mResamplerInputs;
-
-	// can only calculate this AFTER setting up mResamplers
-	int mResampleSamplesBeforeOutput;
+	// interleaved frames read from the file by libsndfile, before de-interleaving.
+	std::vector<double> mInterleaved;
+	// resampled output not yet pulled, per channel. frames [mResampledStart, mResampledEnd) are valid.
+	std::vector<std::vector<double>> mResampled;
+	int mResampledStart{0};
+	int mResampledEnd{0};
+
+	// if caching is enabled, the resampled output is also written to mCacheFile, which is renamed
+	// to mCachePath once the whole file has been resampled.
+	SNDFILE *mCacheFile{nullptr};
+	std::string mCachePath;
+	sf_count_t mCacheFramesWritten{0};
+
+	// set by open when the file can be read without resampling straight from a mapping.
+	std::unique_ptr<MappedWavFile> mMapped;
 };
 #endif // SAPF_AUDIOTOOLBOX
@@ -46,7 +46,13 @@ std::unique_ptr<SoundFile> sfcreate(Thread& th, const char* path, int numChannel
 // async indicates whether async writing should be supported, or only synchronous writing. They are mutually exclusive.
 std::unique_ptr<SoundFile> sfcreate(Thread& th, const char* path, int numChannels, double fileSampleRate, bool interleaved, bool async);
 #endif
-void sfwrite(Thread& th, V& v, Arg filename, bool openIt);
+// numThreads > 1 renders the channels of each block in parallel on that many threads.
+// numThreads <= 0 uses one thread per channel, up to the number of hardware threads.
+void sfwrite(Thread& th, V& v, Arg filename, bool openIt, int numThreads = 1);
 void sfread(Thread& th, Arg filename, int64_t offset, int64_t frames);
+#ifndef SAPF_AUDIOTOOLBOX
+// reads the file through libsndfile and then through the memory mapped reader and posts the throughput of each.
+void sfreadbench(Thread& th, Arg filename);
+#endif
 
 #endif /* defined(__taggeddoubles__SoundFiles__) */
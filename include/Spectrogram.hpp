@@ -17,7 +17,9 @@
 #ifndef taggeddoubles_Spectrogram_h
 #define taggeddoubles_Spectrogram_h
 
-void spectrogram(int size, double* data, int width, int log2bins, const char* path, double dBfloor);
+#include "Sample.hpp"
+
+void spectrogram(int size, Z* data, int width, int log2bins, const char* path, double dBfloor);
 
 
 #endif
@@ -48,16 +48,20 @@ struct SinOscPM : TwoInputUGen<SinOscPM>
 
 void fillWaveTable(int n, Z* amps, int ampStride, Z* phases, int phaseStride, Z smooth, Z* table);
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+// FilterUGens
+void conv_(Thread& th, Prim* prim);
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 // StreamOps
+void reverse_(Thread& th, Prim* prim);
+void drop_(Thread& th, Prim* prim);
 void hanning_(Thread& th, Prim* prim);
 void hamming_(Thread& th, Prim* prim);
 void blackman_(Thread& th, Prim* prim);
-#ifdef SAPF_ACCELERATE
-    inline void wseg_apply_window(Z* segbuf, Z* window, int n);
-#else
-    inline void wseg_apply_window(Z* segbuf, ZArr window, int n);
-#endif
+void stft_(Thread& th, Prim* prim);
+void istft_(Thread& th, Prim* prim);
+inline void wseg_apply_window(Z* segbuf, Z* window, int n);
 
 #endif
 #endif
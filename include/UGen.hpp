@@ -212,6 +212,12 @@ struct OneInputUGen : public Gen
 	{
 	}
     
+	virtual bool blockInputs(std::vector<ZIn*>& outInputs) override
+	{
+		outInputs.push_back(&_a);
+		return true;
+	}
+
 	virtual void pull(Thread& th) override 
 	{
 		int framesToFill = mBlockSize;
@@ -246,6 +252,13 @@ struct TwoInputUGen : public Gen
 	{
 	}
     
+	virtual bool blockInputs(std::vector<ZIn*>& outInputs) override
+	{
+		outInputs.push_back(&_a);
+		outInputs.push_back(&_b);
+		return true;
+	}
+
 	virtual void pull(Thread& th) override 
 	{
 		int framesToFill = mBlockSize;
@@ -282,6 +295,14 @@ struct ThreeInputUGen : public Gen
 	{
 	}
     
+	virtual bool blockInputs(std::vector<ZIn*>& outInputs) override
+	{
+		outInputs.push_back(&_a);
+		outInputs.push_back(&_b);
+		outInputs.push_back(&_c);
+		return true;
+	}
+
 	virtual void pull(Thread& th) override 
 	{
 		int framesToFill = mBlockSize;
@@ -320,6 +341,15 @@ struct FourInputUGen : public Gen
 	{
 	}
     
+	virtual bool blockInputs(std::vector<ZIn*>& outInputs) override
+	{
+		outInputs.push_back(&_a);
+		outInputs.push_back(&_b);
+		outInputs.push_back(&_c);
+		outInputs.push_back(&_d);
+		return true;
+	}
+
 	virtual void pull(Thread& th) override 
 	{
 		int framesToFill = mBlockSize;
@@ -361,6 +391,16 @@ struct FiveInputUGen : public Gen
 	{
 	}
     
+	virtual bool blockInputs(std::vector<ZIn*>& outInputs) override
+	{
+		outInputs.push_back(&_a);
+		outInputs.push_back(&_b);
+		outInputs.push_back(&_c);
+		outInputs.push_back(&_d);
+		outInputs.push_back(&_e);
+		return true;
+	}
+
 	virtual void pull(Thread& th) override 
 	{
 		int framesToFill = mBlockSize;
@@ -405,6 +445,19 @@ struct EightInputUGen : public Gen
 	{
 	}
     
+	virtual bool blockInputs(std::vector<ZIn*>& outInputs) override
+	{
+		outInputs.push_back(&_a);
+		outInputs.push_back(&_b);
+		outInputs.push_back(&_c);
+		outInputs.push_back(&_d);
+		outInputs.push_back(&_e);
+		outInputs.push_back(&_f);
+		outInputs.push_back(&_g);
+		outInputs.push_back(&_h);
+		return true;
+	}
+
 	virtual void pull(Thread& th) override 
 	{
 		int framesToFill = mBlockSize;
@@ -670,6 +723,12 @@ struct NOneInputUGen : public Gen
 	{
 	}
     
+	virtual bool blockInputs(std::vector<ZIn*>& outInputs) override
+	{
+		outInputs.push_back(&_a);
+		return true;
+	}
+
 	virtual void pull(Thread& th) override 
 	{
 		if (_n <= 0) {
@@ -710,6 +769,13 @@ struct NTwoInputUGen : public Gen
 	{
 	}
     
+	virtual bool blockInputs(std::vector<ZIn*>& outInputs) override
+	{
+		outInputs.push_back(&_a);
+		outInputs.push_back(&_b);
+		return true;
+	}
+
 	virtual void pull(Thread& th) override 
 	{
 		if (_n <= 0) {
@@ -752,6 +818,14 @@ struct NThreeInputUGen : public Gen
 	{
 	}
     
+	virtual bool blockInputs(std::vector<ZIn*>& outInputs) override
+	{
+		outInputs.push_back(&_a);
+		outInputs.push_back(&_b);
+		outInputs.push_back(&_c);
+		return true;
+	}
+
 	virtual void pull(Thread& th) override 
 	{
 		if (_n <= 0) {
@@ -796,6 +870,15 @@ struct NFourInputUGen : public Gen
 	{
 	}
     
+	virtual bool blockInputs(std::vector<ZIn*>& outInputs) override
+	{
+		outInputs.push_back(&_a);
+		outInputs.push_back(&_b);
+		outInputs.push_back(&_c);
+		outInputs.push_back(&_d);
+		return true;
+	}
+
 	virtual void pull(Thread& th) override 
 	{
 		if (_n <= 0) {
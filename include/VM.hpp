@@ -304,7 +304,9 @@ public:
 	void printStack();
 	void printLocals();
 
-	void run(Opcode* c);
+	// runs code until its opReturn. when tracing, runs the readable opcodes in runTraced instead.
+	void run(Code* code);
+	void runTraced(Opcode* c);
 		
 	void repl(FILE* infile, const char* logfilename);
 };
@@ -356,6 +358,8 @@ public:
 	std::atomic<int64_t> totalObjectsFreed;
 	std::atomic<int64_t> totalSignalGenerators;
 	std::atomic<int64_t> totalStreamGenerators;
+	std::atomic<int64_t> totalPoolHits;
+	std::atomic<int64_t> totalPoolMisses;
 #endif
 
 	std::vector<std::string> bifHelp;
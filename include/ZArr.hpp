@@ -20,19 +20,21 @@
 #define _USE_MATH_DEFINES
 #include <Eigen/Dense>
 #include "Object.hpp"
-#include <xsimd/xsimd.hpp>
 
 #if SAMPLE_IS_DOUBLE
-	typedef Eigen::Map<Eigen::ArrayXd, 0, Eigen::InnerStride<>> ZArr;
-	typedef xsimd::batch<double> ZBatch;
-	typedef int64_t Z_INT_EQUIV;
+	typedef Eigen::ArrayXd ZArrType;
 #else
-	typedef Eigen::Map<Eigen::ArrayXf, 0, Eigen::InnerStride<>> ZArr;
-	typedef xsimd::batch<float> ZBatch;
-	typedef int32_t Z_INT_EQUIV;
+	typedef Eigen::ArrayXf ZArrType;
 #endif
+typedef Eigen::Map<ZArrType, 0, Eigen::InnerStride<>> ZArr;
 
-constexpr size_t zbatch_size = ZBatch::size;
+// maps over contiguous samples. Eigen only vectorizes maps whose stride is known to be 1 at
+// compile time, so use these rather than a ZArr with a stride of 1 in loops that matter.
+// The aligned ones may only map arrays starting on a kPoolAlignment boundary.
+typedef Eigen::Map<ZArrType> ZArrDense;
+typedef Eigen::Map<const ZArrType> ZArrDenseIn;
+typedef Eigen::Map<ZArrType, Eigen::Aligned64> ZArrAligned;
+typedef Eigen::Map<const ZArrType, Eigen::Aligned64> ZArrAlignedIn;
 
 // create an Eigen Map over an existing array, without copying
 ZArr zarr(const Z *vec, int n, int stride);
@@ -23,48 +23,85 @@
 #include <fftw3.h>
 #endif // SAPF_ACCELERATE
 
+#include "Sample.hpp"
+
+#ifndef SAPF_ACCELERATE
+// the fftw interface for the sample type: fftw for double samples, fftwf for float.
+#if SAMPLE_IS_DOUBLE
+#define SAPF_FFTW(NAME) fftw_##NAME
+#else
+#define SAPF_FFTW(NAME) fftwf_##NAME
+#endif
+#endif // SAPF_ACCELERATE
+
+#include <atomic>
+
 const int kMinFFTLogSize = 2;
-const int kMaxFFTLogSize = 16;
+const int kMaxFFTLogSize = 24;
 
+// Transforms of each size are planned the first time they are used and then shared by all threads.
+// fftw plans execute directly on the caller's split real/imaginary buffers. Only the real
+// transforms, whose fftw layout has n/2+1 bins, go through a per-thread workspace.
+// Setting SAPF_FFTW_WISDOM to a file path plans with FFTW_MEASURE (or FFTW_PATIENT if
+// SAPF_FFTW_PLANNING is "patient") and keeps the accumulated wisdom in that file.
 class FFT {
 public:
     ~FFT();
     void init(size_t log2n);
-    void forward(double *inReal, double *inImag, double *outReal, double *outImag);
-    void backward(double *inReal, double *inImag, double *outReal, double *outImag);
-    void forward_in_place(double *ioReal, double *ioImag);
-    void backward_in_place(double *ioReal, double *ioImag);
-    void forward_real(double *inReal, double *outReal, double *outImag);
-    void backward_real(double *inReal, double *inImag, double *outReal);
+    void forward(Z *inReal, Z *inImag, Z *outReal, Z *outImag);
+    void backward(Z *inReal, Z *inImag, Z *outReal, Z *outImag);
+    void forward_in_place(Z *ioReal, Z *ioImag);
+    void backward_in_place(Z *ioReal, Z *ioImag);
+    void forward_real(Z *inReal, Z *outReal, Z *outImag);
+    void backward_real(Z *inReal, Z *inImag, Z *outReal);
+    void forward_real_packed(Z *io);
+    void backward_real_packed(Z *io);
 
     size_t n;
     size_t log2n;
 private:
 #ifdef SAPF_ACCELERATE
+    void makeSetup();
+
     FFTSetupD setup;
+    std::atomic<bool> ready{false};
 #else
-    fftw_complex *in;
-    fftw_complex *out;
-    double *in_out_real;
-    fftw_plan forward_out_of_place_plan;
-    fftw_plan backward_out_of_place_plan;
-    fftw_plan forward_in_place_plan;
-    fftw_plan backward_in_place_plan;
-    fftw_plan forward_real_plan;
-    fftw_plan backward_real_plan;
+    // fftw's split transforms only go forward. backward transforms swap real and imaginary.
+    struct Plans {
+        SAPF_FFTW(plan) out_of_place;
+        SAPF_FFTW(plan) in_place;
+        SAPF_FFTW(plan) forward_real;
+        SAPF_FFTW(plan) backward_real;
+        SAPF_FFTW(plan) forward_halfcomplex;
+        SAPF_FFTW(plan) backward_halfcomplex;
+        std::atomic<bool> ready{false};
+    };
+    // plans for buffers with fftw's SIMD alignment, and FFTW_UNALIGNED plans for any others.
+    const Plans& plans(bool aligned);
+    void makePlans(Plans& plans, bool aligned);
+    void destroyPlans(Plans& plans);
+
+    Plans aligned_plans;
+    Plans unaligned_plans;
 #endif // SAPF_ACCELERATE    
 };
 
 extern FFT ffts[kMaxFFTLogSize+1];
 
 void initFFT();
-void fft (int n, double* ioReal, double* ioImag);
-void ifft(int n, double* ioReal, double* ioImag);
+void fft (int n, Z* ioReal, Z* ioImag);
+void ifft(int n, Z* ioReal, Z* ioImag);
+
+void fft (int n, Z* inReal, Z* inImag, Z* outReal, Z* outImag);
+void ifft(int n, Z* inReal, Z* inImag, Z* outReal, Z* outImag);
 
-void fft (int n, double* inReal, double* inImag, double* outReal, double* outImag);
-void ifft(int n, double* inReal, double* inImag, double* outReal, double* outImag);
+void rfft(int n, Z* inReal, Z* outReal, Z* outImag);
+void rifft(int n, Z* inReal, Z* inImag, Z* outReal);
 
-void rfft(int n, double* inReal, double* outReal, double* outImag);
-void rifft(int n, double* inReal, double* inImag, double* outReal);
+// in place real transforms on a packed spectrum of n values: the real parts of bins 0 to n/2-1,
+// then the imaginary parts of the same bins, except that the imaginary part of bin 0, always zero,
+// is replaced by the real part of the nyquist bin. Scaled like rfft and rifft.
+void rfft_packed(int n, Z* io);
+void rifft_packed(int n, Z* io);
 
 #endif /* defined(__taggeddoubles__dsp__) */
@@ -55,11 +55,11 @@ std::unique_ptr<AudioToolboxSoundFile> AudioToolboxSoundFile::open(const char* p
 		theadSampleRate,
 		kAudioFormatLinearPCM,
 		kAudioFormatFlagsNativeFloatPacked | kAudioFormatFlagIsNonInterleaved,
-		static_cast<UInt32>(sizeof(double)),
+		static_cast<UInt32>(sizeof(Z)),
 		1,
-		static_cast<UInt32>(sizeof(double)),
+		static_cast<UInt32>(sizeof(Z)),
 		static_cast<UInt32>(numChannels),
-		64,
+		static_cast<UInt32>(8 * sizeof(Z)),
 		0
 	};
 	
@@ -0,0 +1,185 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "BlockPool.hpp"
+#include "VM.hpp"
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+const int kNumSizeClasses = kMaxPooledBlockLog2 - kMinPooledBlockLog2 + 1;
+
+// bound on the memory a thread may keep idle in any one size class.
+const size_t kMaxCachedBytesPerClass = size_t(1) << 20;
+const uint32_t kMinCachedBlocksPerClass = 16;
+
+// blocks smaller than kPoolAlignment only get malloc's alignment. Windows has no aligned malloc
+// that free() accepts, hence the size needed to release a block.
+static void* blockAlloc(size_t inSize)
+{
+	if (inSize < kPoolAlignment) return malloc(inSize);
+#ifdef _WIN32
+	return _aligned_malloc(inSize, kPoolAlignment);
+#else
+	void* p = nullptr;
+	if (posix_memalign(&p, kPoolAlignment, inSize)) return nullptr;
+	return p;
+#endif
+}
+
+static void blockFree(void* inBlock, size_t inSize)
+{
+#ifdef _WIN32
+	if (inSize >= kPoolAlignment) {
+		_aligned_free(inBlock);
+		return;
+	}
+#endif
+	free(inBlock);
+}
+
+struct FreeBlock
+{
+	FreeBlock* next;
+};
+
+static int sizeClass(size_t inSize)
+{
+	if (inSize <= (size_t(1) << kMinPooledBlockLog2)) return 0;
+	return (int)(64 - __builtin_clzll(inSize - 1)) - kMinPooledBlockLog2;
+}
+
+class ThreadBlockCache
+{
+	FreeBlock* mFree[kNumSizeClasses];
+	uint32_t mCount[kNumSizeClasses];
+public:
+	ThreadBlockCache()
+	{
+		for (int i = 0; i < kNumSizeClasses; ++i) {
+			mFree[i] = nullptr;
+			mCount[i] = 0;
+		}
+	}
+
+	~ThreadBlockCache()
+	{
+		for (int i = 0; i < kNumSizeClasses; ++i) {
+			size_t blockSize = size_t(1) << (i + kMinPooledBlockLog2);
+			FreeBlock* block = mFree[i];
+			while (block) {
+				FreeBlock* next = block->next;
+				blockFree(block, blockSize);
+				block = next;
+			}
+		}
+	}
+
+	void* get(int inClass)
+	{
+		FreeBlock* block = mFree[inClass];
+		if (!block) return nullptr;
+		mFree[inClass] = block->next;
+		--mCount[inClass];
+		return block;
+	}
+
+	bool put(int inClass, void* inBlock)
+	{
+		size_t blockSize = size_t(1) << (inClass + kMinPooledBlockLog2);
+		uint32_t maxBlocks = std::max(kMinCachedBlocksPerClass, (uint32_t)(kMaxCachedBytesPerClass / blockSize));
+		if (mCount[inClass] >= maxBlocks) return false;
+		FreeBlock* block = (FreeBlock*)inBlock;
+		block->next = mFree[inClass];
+		mFree[inClass] = block;
+		++mCount[inClass];
+		return true;
+	}
+};
+
+// the cache pointer and flag are trivially destructible so that they remain valid to test
+// while other thread_local and static objects are being torn down after the owner is gone.
+static thread_local ThreadBlockCache* tBlockCache = nullptr;
+static thread_local bool tBlockCacheGone = false;
+
+struct ThreadBlockCacheOwner
+{
+	~ThreadBlockCacheOwner()
+	{
+		ThreadBlockCache* cache = tBlockCache;
+		tBlockCache = nullptr;
+		tBlockCacheGone = true;
+		delete cache;
+	}
+};
+
+static thread_local ThreadBlockCacheOwner tBlockCacheOwner;
+
+static ThreadBlockCache* threadBlockCache()
+{
+	if (tBlockCache) return tBlockCache;
+	if (tBlockCacheGone) return nullptr;
+	(void)&tBlockCacheOwner; // register the owner's destructor for this thread.
+	tBlockCache = new ThreadBlockCache();
+	return tBlockCache;
+}
+
+size_t poolBlockSize(size_t inSize)
+{
+	if (inSize > kMaxPooledBlockSize) return inSize;
+	return size_t(1) << (sizeClass(inSize) + kMinPooledBlockLog2);
+}
+
+void* poolAlloc(size_t inSize)
+{
+	if (inSize > kMaxPooledBlockSize) {
+		void* p = blockAlloc(inSize);
+		if (!p) throw std::bad_alloc();
+		return p;
+	}
+
+	int sc = sizeClass(inSize);
+	ThreadBlockCache* cache = threadBlockCache();
+	if (cache) {
+		void* p = cache->get(sc);
+		if (p) {
+#if COLLECT_MINFO
+			++vm.totalPoolHits;
+#endif
+			return p;
+		}
+	}
+#if COLLECT_MINFO
+	++vm.totalPoolMisses;
+#endif
+	void* p = blockAlloc(size_t(1) << (sc + kMinPooledBlockLog2));
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void poolFree(void* inBlock, size_t inSize)
+{
+	if (!inBlock) return;
+	if (inSize <= kMaxPooledBlockSize) {
+		ThreadBlockCache* cache = threadBlockCache();
+		if (cache && cache->put(sizeClass(inSize), inBlock))
+			return;
+	}
+	blockFree(inBlock, poolBlockSize(inSize));
+}
@@ -0,0 +1,110 @@
+#include "BlockSchedule.hpp"
+#include <atomic>
+
+static std::atomic<bool> gBlockScheduling{false};
+
+void setBlockScheduling(const bool inEnabled) {
+    gBlockScheduling = inEnabled;
+}
+
+bool blockScheduling() {
+    return gBlockScheduling.load();
+}
+
+static List* firstUnforced(const ZIn& in) {
+    if (in.isConstant()) return nullptr;
+    List* list = in.mList();
+    while (list && !list->isThunk()) {
+        list = list->nextp();
+    }
+    return list;
+}
+
+BlockSchedule::BlockSchedule(ZIn* inputs, const int numInputs) : mInputs{inputs}, mNumInputs{numInputs} {
+    for (int i = 0; i < numInputs; ++i) {
+        if (List* list = firstUnforced(inputs[i])) {
+            visit(list->mGen());
+        }
+    }
+}
+
+int BlockSchedule::numOpaqueNodes() const {
+    int count = 0;
+    for (const Node& node : mNodes) {
+        if (node.opaque) ++count;
+    }
+    return count;
+}
+
+void BlockSchedule::visit(Gen* gen) {
+    if (mNodeIndex.count(gen)) return;
+    // -1 while the inputs are visited, so a cycle through a Plug or a link ends here.
+    mNodeIndex[gen] = -1;
+
+    Node node;
+    node.gen = gen;
+    node.opaque = !gen->blockInputs(node.inputs);
+    for (ZIn* in : node.inputs) {
+        if (List* list = firstUnforced(*in)) {
+            visit(list->mGen());
+        }
+    }
+
+    mNodeIndex[gen] = static_cast<int>(mNodes.size());
+    mNodes.push_back(std::move(node));
+}
+
+List* BlockSchedule::neededList(const ZIn& in, const int inNumFrames) {
+    if (in.isConstant()) return nullptr;
+    int64_t available = -in.mOffset;
+    for (List* list = in.mList(); list; list = list->nextp()) {
+        if (list->isThunk()) return list;
+        available += list->mArray->size();
+        if (available >= inNumFrames) return nullptr;
+    }
+    return nullptr;
+}
+
+bool BlockSchedule::markNeeded(const ZIn& in, const int inNumFrames) {
+    List* list = neededList(in, inNumFrames);
+    if (!list) return false;
+    const auto found = mNodeIndex.find(list->mGen());
+    if (found == mNodeIndex.end() || found->second < 0) return false;
+    mNodes[found->second].needed = list;
+    return true;
+}
+
+void BlockSchedule::prepare(Thread& th, const int inNumFrames) {
+    // each pass forces at most one block of every generator, so reading more than a block from
+    // the inputs takes several passes.
+    for (;;) {
+        for (Node& node : mNodes) {
+            node.needed = nullptr;
+        }
+
+        bool anyNeeded = false;
+        for (int i = 0; i < mNumInputs; ++i) {
+            if (markNeeded(mInputs[i], inNumFrames)) anyNeeded = true;
+        }
+        if (!anyNeeded) return;
+
+        // consumers come after their producers, so walking backwards finds everything the
+        // needed blocks will read before it is forced.
+        for (auto node = mNodes.rbegin(); node != mNodes.rend(); ++node) {
+            if (!node->needed) continue;
+            for (ZIn* in : node->inputs) {
+                markNeeded(*in, node->gen->blockSize());
+            }
+        }
+
+        bool progress = false;
+        for (Node& node : mNodes) {
+            List* list = node.needed;
+            if (!list) continue;
+            node.needed = nullptr;
+            list->force(th);
+            if (!list->isThunk()) progress = true;
+        }
+        if (!progress) return;
+    }
+}
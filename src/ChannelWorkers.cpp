@@ -0,0 +1,94 @@
+#include "ChannelWorkers.hpp"
+#include <algorithm>
+
+ChannelWorkers::ChannelWorkers(const Thread& parent, const int numWorkers) {
+    for (int i = 0; i < numWorkers; ++i) {
+        mThreads.push_back(std::make_unique<Thread>(parent));
+    }
+    for (int i = 0; i < numWorkers; ++i) {
+        mWorkers.emplace_back(&ChannelWorkers::workLoop, this, std::ref(*mThreads[i]));
+    }
+}
+
+ChannelWorkers::~ChannelWorkers() {
+    {
+        std::lock_guard lock{mMutex};
+        mRunning = false;
+    }
+    mWorkAvailableCondition.notify_all();
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+int ChannelWorkers::threadsFor(const int numChannels) {
+    const int hardwareThreads = static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(1, std::min(hardwareThreads, numChannels));
+}
+
+void ChannelWorkers::doChannels(Thread& th, const ChannelFunc& func, const int numChannels) {
+    for (;;) {
+        const int channel = mNextChannel.fetch_add(1, std::memory_order_relaxed);
+        if (channel >= numChannels) return;
+        try {
+            func(th, channel);
+        } catch (...) {
+            std::lock_guard lock{mMutex};
+            if (!mError) mError = std::current_exception();
+        }
+    }
+}
+
+void ChannelWorkers::run(Thread& th, const int numChannels, const ChannelFunc& func) {
+    {
+        std::lock_guard lock{mMutex};
+        mFunc = &func;
+        mNumChannels = numChannels;
+        mNextChannel.store(0, std::memory_order_relaxed);
+        mError = nullptr;
+        ++mGeneration;
+    }
+    mWorkAvailableCondition.notify_all();
+
+    doChannels(th, func, numChannels);
+
+    std::exception_ptr error;
+    {
+        // every channel has been claimed, so wait for the workers still filling one.
+        std::unique_lock lock{mMutex};
+        mWorkDoneCondition.wait(lock, [this] { return mBusyWorkers == 0; });
+        mFunc = nullptr;
+        error = mError;
+        mError = nullptr;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ChannelWorkers::workLoop(Thread& th) {
+    uint64_t lastGeneration{0};
+    for (;;) {
+        const ChannelFunc* func;
+        int numChannels;
+        {
+            std::unique_lock lock{mMutex};
+            mWorkAvailableCondition.wait(lock, [&] { return !mRunning || mGeneration != lastGeneration; });
+            if (!mRunning) return;
+            lastGeneration = mGeneration;
+            // the job may already be finished if this worker woke late.
+            if (!mFunc) continue;
+            func = mFunc;
+            numChannels = mNumChannels;
+            ++mBusyWorkers;
+        }
+
+        doChannels(th, *func, numChannels);
+
+        {
+            std::lock_guard lock{mMutex};
+            --mBusyWorkers;
+        }
+        mWorkDoneCondition.notify_one();
+    }
+}
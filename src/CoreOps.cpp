@@ -1026,6 +1026,12 @@ static void minfo_(Thread& th, Prim* prim)
 	post("objects freed %qd\n", vm.totalObjectsFreed.load());
 	post("retains %qd\n", vm.totalRetains.load());
 	post("releases %qd\n", vm.totalReleases.load());
+	int64_t poolHits = vm.totalPoolHits.load();
+	int64_t poolMisses = vm.totalPoolMisses.load();
+	int64_t poolRequests = poolHits + poolMisses;
+	post("block pool hits %qd\n", poolHits);
+	post("block pool misses %qd\n", poolMisses);
+	post("block pool hit rate %.1f %%\n", poolRequests ? 100. * (double)poolHits / (double)poolRequests : 0.);
 }
 #endif
 
@@ -149,7 +149,7 @@ public:
                 if (delayStride == 0) {
 					Z zdelay = *delay;
 					zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
-                    Z fpos = std::max(1., zdelay * sr);
+                    Z fpos = std::max<Z>(1., zdelay * sr);
                     Z ipos = floor(fpos);
                     Z frac = fpos - ipos;
                     int32_t offset = (int32_t)ipos;
@@ -166,7 +166,7 @@ public:
                     for (int i = 0; i < n; ++i) {
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
-                        Z fpos = std::max(1., zdelay * sr);
+                        Z fpos = std::max<Z>(1., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
                         int32_t offset = bufPos-(int32_t)ipos;
@@ -249,7 +249,7 @@ public:
                 if (delayStride == 0) {
 					Z zdelay = *delay;
 					zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
-                    Z fpos = std::max(2., zdelay * sr);
+                    Z fpos = std::max<Z>(2., zdelay * sr);
                     Z ipos = floor(fpos);
                     Z frac = fpos - ipos;
                     int32_t offset = (int32_t)ipos;
@@ -268,7 +268,7 @@ public:
                     for (int i = 0; i < n; ++i) {
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
-                        Z fpos = std::max(2., zdelay * sr);
+                        Z fpos = std::max<Z>(2., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
                         int32_t offset = bufPos-(int32_t)ipos;
@@ -358,7 +358,7 @@ public:
 				for (int i = 0; i < n; ++i) {
 					Z zdelay = *delay;
 					zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
-					Z fpos = std::max(2., zdelay * sr + fhalf);
+					Z fpos = std::max<Z>(2., zdelay * sr + fhalf);
 					Z ipos = floor(fpos);
 					Z frac = fpos - ipos;
 					int32_t offset = bufPos-(int32_t)ipos;
@@ -427,7 +427,7 @@ public:
 				for (int i = 0; i < n; ++i) {
 					Z zdelay = *delay;
 					zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
-					Z fpos = std::max(2., zdelay * sr + fhalf);
+					Z fpos = std::max<Z>(2., zdelay * sr + fhalf);
 					Z ipos = floor(fpos);
 					Z frac = fpos - ipos;
 					int32_t offset = bufPos-(int32_t)ipos;
@@ -633,7 +633,7 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(1., zdelay * sr);
+                        Z fpos = std::max<Z>(1., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
                         int32_t offset = (int32_t)ipos;
@@ -653,7 +653,7 @@ public:
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay * rdecay);
-                            Z fpos = std::max(1., zdelay * sr);
+                            Z fpos = std::max<Z>(1., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
                             int32_t offset = bufPos-(int32_t)ipos;
@@ -672,7 +672,7 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(1., zdelay * sr);
+                        Z fpos = std::max<Z>(1., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
 						int32_t offset = bufPos-(int32_t)ipos;
@@ -761,7 +761,7 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(2., zdelay * sr);
+                        Z fpos = std::max<Z>(2., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
                         int32_t offset = (int32_t)ipos;
@@ -783,7 +783,7 @@ public:
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay * rdecay);
-                            Z fpos = std::max(2., zdelay * sr);
+                            Z fpos = std::max<Z>(2., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
 							int32_t offset = bufPos-(int32_t)ipos;
@@ -804,7 +804,7 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(2., zdelay * sr);
+                        Z fpos = std::max<Z>(2., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
 						int32_t offset = bufPos-(int32_t)ipos;
@@ -903,7 +903,7 @@ public:
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay / *decay);
-                            Z fpos = std::max(2., zdelay * sr);
+                            Z fpos = std::max<Z>(2., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
                             int32_t offset = (int32_t)ipos;
@@ -927,7 +927,7 @@ public:
 								Z zdelay = *delay;
 								zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                                 Z fb = calcDecay(zdelay * rdecay);
-                                Z fpos = std::max(2., zdelay * sr);
+                                Z fpos = std::max<Z>(2., zdelay * sr);
                                 Z ipos = floor(fpos);
                                 Z frac = fpos - ipos;
                                 int32_t offset = bufPos-(int32_t)ipos;
@@ -949,7 +949,7 @@ public:
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay / *decay);
-                            Z fpos = std::max(2., zdelay * sr);
+                            Z fpos = std::max<Z>(2., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
                             int32_t offset = bufPos-(int32_t)ipos;
@@ -972,7 +972,7 @@ public:
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay / *decay);
-                            Z fpos = std::max(2., zdelay * sr);
+                            Z fpos = std::max<Z>(2., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
                             int32_t offset = (int32_t)ipos;
@@ -997,7 +997,7 @@ public:
 								Z zdelay = *delay;
 								zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                                 Z fb = calcDecay(zdelay * rdecay);
-                                Z fpos = std::max(2., zdelay * sr);
+                                Z fpos = std::max<Z>(2., zdelay * sr);
                                 Z ipos = floor(fpos);
                                 Z frac = fpos - ipos;
                                 int32_t offset = bufPos-(int32_t)ipos;
@@ -1021,7 +1021,7 @@ public:
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay / *decay);
-                            Z fpos = std::max(2., zdelay * sr);
+                            Z fpos = std::max<Z>(2., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
                             int32_t offset = bufPos-(int32_t)ipos;
@@ -1221,7 +1221,7 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(1., zdelay * sr);
+                        Z fpos = std::max<Z>(1., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
                         int32_t offset = (int32_t)ipos;
@@ -1242,7 +1242,7 @@ public:
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay * rdecay);
-                            Z fpos = std::max(1., zdelay * sr);
+                            Z fpos = std::max<Z>(1., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
                             int32_t offset = bufPos-(int32_t)ipos;
@@ -1262,7 +1262,7 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(1., zdelay * sr);
+                        Z fpos = std::max<Z>(1., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
 						int32_t offset = bufPos-(int32_t)ipos;
@@ -1352,7 +1352,7 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(2., zdelay * sr);
+                        Z fpos = std::max<Z>(2., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
                         int32_t offset = (int32_t)ipos;
@@ -1375,7 +1375,7 @@ public:
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay * rdecay);
-                            Z fpos = std::max(2., zdelay * sr);
+                            Z fpos = std::max<Z>(2., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
 							int32_t offset = bufPos-(int32_t)ipos;
@@ -1397,7 +1397,7 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(2., zdelay * sr);
+                        Z fpos = std::max<Z>(2., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
 						int32_t offset = bufPos-(int32_t)ipos;
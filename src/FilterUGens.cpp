@@ -19,6 +19,7 @@
 
 #include "VM.hpp"
 #include "clz.hpp"
+#include "dsp.hpp"
 #include <climits>
 #include <cmath>
 #include <float.h>
@@ -787,7 +788,7 @@ struct LPF : public Gen
 			}
 			
 			if (freqStride == 0) {
-				Z w0 = std::max(1e-3, *freq) * freqmul;
+				Z w0 = std::max<Z>(1e-3, *freq) * freqmul;
 				Z sn, cs;
 				tsincosx(w0, sn, cs);
 				Z alpha = sn * alphamul;
@@ -815,7 +816,7 @@ struct LPF : public Gen
 				_in.advance(n);
 			} else {
 				for (int i = 0; i < n; ++i) {				
-					Z w0 = std::max(1e-3, *freq) * freqmul;
+					Z w0 = std::max<Z>(1e-3, *freq) * freqmul;
 					Z sn, cs;
 					tsincosx(w0, sn, cs);
 					Z alpha = sn * alphamul;
@@ -895,7 +896,7 @@ struct LPF2 : public Gen
 			}
 			
 			if (freqStride == 0) {
-				Z w0 = std::max(1e-3, *freq) * freqmul;
+				Z w0 = std::max<Z>(1e-3, *freq) * freqmul;
 				Z sn, cs;
 				tsincosx(w0, sn, cs);
 				Z alpha = sn * alphamul;
@@ -929,7 +930,7 @@ struct LPF2 : public Gen
 				_in.advance(n);
 			} else {
 				for (int i = 0; i < n; ++i) {
-					Z w0 = std::max(1e-3, *freq) * freqmul;
+					Z w0 = std::max<Z>(1e-3, *freq) * freqmul;
 					Z sn, cs;
 					tsincosx(w0, sn, cs);
 					Z alpha = sn * alphamul;
@@ -2870,6 +2871,132 @@ static void klank_(Thread& th, Prim* prim)
 	th.push(new List(new Klank(th, in, freqs, amps, ringTimes)));
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// uniformly partitioned overlap-save convolution. The impulse response is cut into partitions of one
+// block, each transformed once. Every block the input spectrum of the last two blocks is pushed onto a
+// frequency domain delay line, and the output is the inverse transform of the sum of each delayed input
+// spectrum times the matching partition's spectrum. Each output block is computed from the input block
+// pulled for it, so there is no latency beyond the block, and the cost per sample is one transform plus
+// one complex multiply-add per partition.
+struct Convolve : public Gen
+{
+	ZIn _in;
+	int _partitionSize;
+	int _fftSize;
+	int _numPartitions;
+	int64_t _irLength;
+	std::vector<Z> _irSpectra;
+	std::vector<Z> _inputSpectra;	// ring of packed spectra, _newest is the latest.
+	int _newest;
+	std::vector<Z> _inputWindow;	// the last two blocks of input.
+	std::vector<Z> _work;
+	int64_t _tailRemaining;		// frames left to output once the input has ended, or -1.
+
+	Convolve(Thread& th, Arg in, P<Array> const& ir)
+		: Gen(th, itemTypeZ, in.isFinite()), _in(in),
+			_partitionSize(NEXTPOWEROFTWO(std::max(mBlockSize, 1 << (kMinFFTLogSize - 1)))),
+			_fftSize(2 * _partitionSize),
+			_numPartitions((int)std::max((int64_t)1, (ir->size() + _partitionSize - 1) / _partitionSize)),
+			_irLength(std::max((int64_t)1, ir->size())),
+			_irSpectra((size_t)_numPartitions * _fftSize, 0.),
+			_inputSpectra((size_t)_numPartitions * _fftSize, 0.),
+			_newest(0),
+			_inputWindow(_fftSize, 0.),
+			_work(_fftSize),
+			_tailRemaining(-1)
+	{
+		// the packed transforms are scaled by 2/n, which the impulse response spectra undo, so that their
+		// product with a packed input spectrum is the packed spectrum of the convolution.
+		Z scale = .5 * _fftSize;
+		Z* h = ir->z();
+		int64_t irSize = ir->size();
+		for (int p = 0; p < _numPartitions; ++p) {
+			Z* spectrum = &_irSpectra[(size_t)p * _fftSize];
+			int64_t offset = (int64_t)p * _partitionSize;
+			int n = (int)std::min((int64_t)_partitionSize, irSize - offset);
+			for (int i = 0; i < n; ++i) spectrum[i] = h[offset + i];
+			rfft_packed(_fftSize, spectrum);
+			for (int i = 0; i < _fftSize; ++i) spectrum[i] *= scale;
+		}
+	}
+	
+	virtual const char* TypeName() const override { return "Convolve"; }
+	
+	virtual void pull(Thread& th) override
+	{
+		int B = _partitionSize;
+		int N = _fftSize;
+		int N2 = N / 2;
+		
+		Z* window = _inputWindow.data();
+		memmove(window, window + B, B * sizeof(Z));
+		if (_tailRemaining < 0) {
+			int n = B;
+			if (_in.fill(th, n, window + B, 1)) {
+				_tailRemaining = n + _irLength - 1;
+			}
+		} else {
+			memset(window + B, 0, B * sizeof(Z));
+		}
+
+		_newest = (_newest + _numPartitions - 1) % _numPartitions;
+		Z* X = &_inputSpectra[(size_t)_newest * N];
+		memcpy(X, window, N * sizeof(Z));
+		rfft_packed(N, X);
+
+		Z* Y = _work.data();
+		memset(Y, 0, N * sizeof(Z));
+		for (int p = 0; p < _numPartitions; ++p) {
+			Z* Xp = &_inputSpectra[(size_t)((_newest + p) % _numPartitions) * N];
+			Z* H = &_irSpectra[(size_t)p * N];
+			// packed spectra: dc and nyquist are real, the other bins are split complex.
+			Y[0] += Xp[0] * H[0];
+			Y[N2] += Xp[N2] * H[N2];
+			Z* Yr = Y;
+			Z* Yi = Y + N2;
+			Z* Xr = Xp;
+			Z* Xi = Xp + N2;
+			Z* Hr = H;
+			Z* Hi = H + N2;
+			for (int k = 1; k < N2; ++k) {
+				Yr[k] += Xr[k] * Hr[k] - Xi[k] * Hi[k];
+				Yi[k] += Xr[k] * Hi[k] + Xi[k] * Hr[k];
+			}
+		}
+		rifft_packed(N, Y);
+
+		int framesToProduce = B;
+		if (_tailRemaining >= 0) {
+			framesToProduce = (int)std::min((int64_t)B, _tailRemaining);
+			_tailRemaining -= framesToProduce;
+		}
+
+		Z* out = mOut->fulfillz(B);
+		memcpy(out, Y + B, B * sizeof(Z));
+		if (_tailRemaining == 0)
+			setDone();
+		produce(B - framesToProduce);
+	}
+};
+
+#ifdef TEST_BUILD
+void conv_(Thread& th, Prim* prim)
+#else
+static void conv_(Thread& th, Prim* prim)
+#endif
+{
+	P<List> ir = th.popZList("conv : ir");
+	V in = th.popZIn("conv : in");
+
+	if (!ir->isFinite())
+		indefiniteOp("conv : ir", "");
+
+	ir = ir->pack(th);
+	
+	th.push(new List(new Convolve(th, in, ir->mArray)));
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -3517,6 +3644,7 @@ void AddFilterUGenOps()
 	DEFMCX(ringz, 3, "(in freq ringTime --> out) resonant filter specified by a ring time in seconds.")
 	DEFMCX(formlet, 4, "(in freq atkTime dcyTime --> out) a formant filter whose impulse response is a sine grain.")
 	DEFAM(klank, zaaa, "(in freqs amps ringTimes --> out) a bank of ringz filters. freqs amps and ringTimes are arrays.")
+	DEFMCX(conv, 2, "(in ir --> out) convolves the input with the impulse response ir using partitioned FFT convolution. the output continues for the length of ir after the input ends.")
 
 	DEFMCX(leakdc, 2, "(in coef --> out) leaks away energy at 0 Hz.")
 	DEFMCX(leaky, 2, "(in coef --> out) leaky integrator.")
@@ -0,0 +1,240 @@
+#ifndef SAPF_AUDIOTOOLBOX
+#include "MappedWavFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// how far ahead of the read position pages are requested, and how far behind it they are released.
+	constexpr size_t kReadAheadBytes{4 * 1024 * 1024};
+	constexpr size_t kKeepBehindBytes{1024 * 1024};
+
+	constexpr uint16_t kFormatPCM{1};
+	constexpr uint16_t kFormatFloat{3};
+	constexpr uint16_t kFormatExtensible{0xFFFE};
+
+	uint16_t readLE16(const uint8_t *p) {
+		return static_cast<uint16_t>(p[0] | (p[1] << 8));
+	}
+
+	uint32_t readLE32(const uint8_t *p) {
+		return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+			| (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+	}
+
+	// sample conversions match libsndfile's normalized reads.
+	struct Unsigned8 {
+		static constexpr size_t size{1};
+		static double read(const uint8_t *p) { return (static_cast<int>(p[0]) - 128) * (1. / 128.); }
+	};
+	struct Int16 {
+		static constexpr size_t size{2};
+		static double read(const uint8_t *p) { return static_cast<int16_t>(readLE16(p)) * (1. / 32768.); }
+	};
+	struct Int24 {
+		static constexpr size_t size{3};
+		static double read(const uint8_t *p) {
+			const auto x = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8)
+				| (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 24));
+			return x * (1. / 2147483648.);
+		}
+	};
+	struct Int32 {
+		static constexpr size_t size{4};
+		static double read(const uint8_t *p) { return static_cast<int32_t>(readLE32(p)) * (1. / 2147483648.); }
+	};
+	struct Float32 {
+		static constexpr size_t size{4};
+		static double read(const uint8_t *p) { float x; memcpy(&x, p, sizeof(x)); return x; }
+	};
+	struct Float64 {
+		static constexpr size_t size{8};
+		static double read(const uint8_t *p) { double x; memcpy(&x, p, sizeof(x)); return x; }
+	};
+
+	size_t bytesPerSample(const MappedWavFile::Encoding encoding) {
+		switch (encoding) {
+			case MappedWavFile::Encoding::Unsigned8: return Unsigned8::size;
+			case MappedWavFile::Encoding::Int16: return Int16::size;
+			case MappedWavFile::Encoding::Int24: return Int24::size;
+			case MappedWavFile::Encoding::Int32: return Int32::size;
+			case MappedWavFile::Encoding::Float32: return Float32::size;
+			case MappedWavFile::Encoding::Float64: return Float64::size;
+		}
+		return 0;
+	}
+
+	template <typename Sample, typename Out>
+	void deInterleave(const uint8_t *frames, const size_t bytesPerFrame, const uint32_t numChannels,
+		const uint32_t numFrames, PortableBuffers &buffers) {
+		for (uint32_t ch = 0; ch < numChannels; ++ch) {
+			auto *out = static_cast<Out *>(buffers.buffers[ch].data);
+			const uint8_t *in = frames + ch * Sample::size;
+			for (uint32_t i = 0; i < numFrames; ++i) {
+				out[i] = Sample::read(in);
+				in += bytesPerFrame;
+			}
+		}
+	}
+}
+
+MappedWavFile::MappedWavFile(void *mapping, const size_t mappingSize, const uint8_t *data, const Encoding encoding,
+	const uint32_t numChannels, const double sampleRate, const int64_t numFrames) :
+	mMapping{mapping}, mMappingSize{mappingSize}, mData{data}, mEncoding{encoding},
+	mNumChannels{numChannels}, mSampleRate{sampleRate}, mNumFrames{numFrames},
+	mBytesPerFrame{bytesPerSample(encoding) * numChannels} {
+}
+
+#ifdef _WIN32
+
+MappedWavFile::~MappedWavFile() = default;
+
+std::unique_ptr<MappedWavFile> MappedWavFile::open(const char *) {
+	return nullptr;
+}
+
+void MappedWavFile::adviseReadAhead(int64_t) {
+}
+
+#else
+
+MappedWavFile::~MappedWavFile() {
+	munmap(mMapping, mMappingSize);
+}
+
+std::unique_ptr<MappedWavFile> MappedWavFile::open(const char *path) {
+	const int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return nullptr;
+
+	struct stat st{};
+	if (fstat(fd, &st) != 0 || st.st_size < 44) {
+		close(fd);
+		return nullptr;
+	}
+	const auto fileSize = static_cast<size_t>(st.st_size);
+	void *mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps its own reference to the file.
+	close(fd);
+	if (mapping == MAP_FAILED) return nullptr;
+
+	const auto *bytes = static_cast<const uint8_t *>(mapping);
+	auto fail = [&] {
+		munmap(mapping, fileSize);
+		return nullptr;
+	};
+
+	if (memcmp(bytes, "RIFF", 4) != 0 || memcmp(bytes + 8, "WAVE", 4) != 0) return fail();
+
+	uint16_t format{0}, numChannels{0}, blockAlign{0}, bitsPerSample{0};
+	uint32_t sampleRate{0};
+	const uint8_t *data{nullptr};
+	size_t dataSize{0};
+
+	// walk the chunks. the data chunk size is clipped to the file, as some writers leave it unset.
+	size_t offset{12};
+	while (offset + 8 <= fileSize) {
+		const uint8_t *chunk = bytes + offset;
+		const size_t chunkSize = readLE32(chunk + 4);
+		const size_t available = fileSize - offset - 8;
+		if (memcmp(chunk, "fmt ", 4) == 0) {
+			if (chunkSize < 16 || chunkSize > available) return fail();
+			format = readLE16(chunk + 8);
+			numChannels = readLE16(chunk + 10);
+			sampleRate = readLE32(chunk + 12);
+			blockAlign = readLE16(chunk + 20);
+			bitsPerSample = readLE16(chunk + 22);
+			if (format == kFormatExtensible) {
+				if (chunkSize < 40) return fail();
+				// the first two bytes of the sub format GUID are the format code.
+				format = readLE16(chunk + 32);
+			}
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			data = chunk + 8;
+			dataSize = std::min(chunkSize, available);
+			break;
+		}
+		offset += 8 + chunkSize + (chunkSize & 1);
+	}
+
+	if (!data || numChannels == 0 || sampleRate == 0) return fail();
+
+	Encoding encoding;
+	if (format == kFormatPCM && bitsPerSample == 8) encoding = Encoding::Unsigned8;
+	else if (format == kFormatPCM && bitsPerSample == 16) encoding = Encoding::Int16;
+	else if (format == kFormatPCM && bitsPerSample == 24) encoding = Encoding::Int24;
+	else if (format == kFormatPCM && bitsPerSample == 32) encoding = Encoding::Int32;
+	else if (format == kFormatFloat && bitsPerSample == 32) encoding = Encoding::Float32;
+	else if (format == kFormatFloat && bitsPerSample == 64) encoding = Encoding::Float64;
+	else return fail();
+
+	if (blockAlign != bytesPerSample(encoding) * numChannels) return fail();
+
+	madvise(mapping, fileSize, MADV_SEQUENTIAL);
+
+	const auto numFrames = static_cast<int64_t>(dataSize / blockAlign);
+	return std::unique_ptr<MappedWavFile>(new MappedWavFile(mapping, fileSize, data, encoding,
+		numChannels, sampleRate, numFrames));
+}
+
+void MappedWavFile::adviseReadAhead(const int64_t frame) {
+	static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	auto *base = static_cast<uint8_t *>(mMapping);
+	const size_t position = static_cast<size_t>(mData - base) + static_cast<size_t>(frame) * mBytesPerFrame;
+
+	// request the next window once the reader has used up half of the last one.
+	if (position + kReadAheadBytes / 2 >= mAdvisedUntil && mAdvisedUntil < mMappingSize) {
+		const size_t start = std::max(mAdvisedUntil, position) & ~(pageSize - 1);
+		const size_t end = std::min(position + kReadAheadBytes, mMappingSize);
+		if (end > start) {
+			madvise(base + start, end - start, MADV_WILLNEED);
+		}
+		mAdvisedUntil = end;
+	}
+
+	if (position > kKeepBehindBytes) {
+		const size_t releaseUntil = (position - kKeepBehindBytes) & ~(pageSize - 1);
+		if (releaseUntil > mReleasedUntil) {
+			madvise(base + mReleasedUntil, releaseUntil - mReleasedUntil, MADV_DONTNEED);
+			mReleasedUntil = releaseUntil;
+		}
+	}
+}
+
+#endif // _WIN32
+
+void MappedWavFile::pull(uint32_t *framesRead, PortableBuffers &buffers) {
+	pullAs<Z>(framesRead, buffers);
+}
+
+void MappedWavFile::pullDouble(uint32_t *framesRead, PortableBuffers &buffers) {
+	pullAs<double>(framesRead, buffers);
+}
+
+template <typename Out>
+void MappedWavFile::pullAs(uint32_t *framesRead, PortableBuffers &buffers) {
+	const auto numFrames = static_cast<uint32_t>(std::min<int64_t>(*framesRead, mNumFrames - mPosition));
+	*framesRead = numFrames;
+	if (numFrames == 0) return;
+
+	adviseReadAhead(mPosition + numFrames);
+
+	const uint8_t *frames = mData + static_cast<size_t>(mPosition) * mBytesPerFrame;
+	switch (mEncoding) {
+		case Encoding::Unsigned8: deInterleave<Unsigned8, Out>(frames, mBytesPerFrame, mNumChannels, numFrames, buffers); break;
+		case Encoding::Int16: deInterleave<Int16, Out>(frames, mBytesPerFrame, mNumChannels, numFrames, buffers); break;
+		case Encoding::Int24: deInterleave<Int24, Out>(frames, mBytesPerFrame, mNumChannels, numFrames, buffers); break;
+		case Encoding::Int32: deInterleave<Int32, Out>(frames, mBytesPerFrame, mNumChannels, numFrames, buffers); break;
+		case Encoding::Float32: deInterleave<Float32, Out>(frames, mBytesPerFrame, mNumChannels, numFrames, buffers); break;
+		case Encoding::Float64: deInterleave<Float64, Out>(frames, mBytesPerFrame, mNumChannels, numFrames, buffers); break;
+	}
+	mPosition += numFrames;
+}
+
+#endif // SAPF_AUDIOTOOLBOX
@@ -17,10 +17,10 @@
 #include "MathFuns.hpp"
 #include "VM.hpp"
 
-double gSineTable[kSineTableSize+1];
-double gDBAmpTable[kDBAmpTableSize+2];
-double gDecayTable[kDecayTableSize+1];
-double gFirstOrderCoeffTable[kFirstOrderCoeffTableSize+1];
+Z gSineTable[kSineTableSize+1];
+Z gDBAmpTable[kDBAmpTableSize+2];
+Z gDecayTable[kDecayTableSize+1];
+Z gFirstOrderCoeffTable[kFirstOrderCoeffTableSize+1];
 
 
 inline double freqToTableF(double freq)
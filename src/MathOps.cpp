@@ -23,6 +23,7 @@
 #else
 #include <Eigen/Dense>
 #include "ZArr.hpp"
+#include "SimdKernels.hpp"
 #endif
 
 V BinaryOp::makeVList(Thread& th, Arg a, Arg b)
@@ -32,7 +33,7 @@ V BinaryOp::makeVList(Thread& th, Arg a, Arg b)
 
 V BinaryOp::makeZList(Thread& th, Arg a, Arg b)
 {
-	return new List(new BinaryOpZGen(th, this, a, b));
+	return new List(new FusedZGen(th, this, a, b));
 }
 
 V BinaryOpLink::makeVList(Thread& th, Arg a, Arg b)
@@ -117,45 +118,177 @@ void BinaryOp::reduce(Thread& th, int n, V& z, V *a, int astride)
 }
 
 
-void UnaryOpZGen::pull(Thread& th) {
-	int framesToFill = mBlockSize;
-	Z* out = mOut->fulfillz(framesToFill);
-	while (framesToFill) {
-		int n = framesToFill;
-		int astride;
-		Z *a;
-		if (_a(th, n,astride, a)) {
-			setDone();
-			break;
+// runs op over a block, through its constant operand kernels when either side is a number.
+static void binaryLoopz(BinaryOp* op, int n, const Z *a, int astride, const Z *b, int bstride, Z *out)
+{
+	if (bstride == 0) {
+		op->loopzs(n, a, astride, *b, out);
+	} else if (astride == 0) {
+		op->loopsz(n, *a, b, bstride, out);
+	} else {
+		op->loopz(n, a, astride, b, bstride, out);
+	}
+}
+
+// upper bound on the operators folded into one FusedZGen, which bounds the scratch it may need.
+const size_t kMaxFusedSteps = 64;
+
+FusedZGen::FusedZGen(Thread& th, UnaryOp* op, Arg a)
+	: Gen(th, itemTypeZ, a.isFinite())
+{
+	mInputs.emplace_back(a);
+	mSteps.push_back({op, nullptr, 0, 0, -1});
+}
+
+FusedZGen::FusedZGen(Thread& th, BinaryOp* op, Arg a, Arg b)
+	: Gen(th, itemTypeZ, mostFinite(a,b))
+{
+	mInputs.emplace_back(a);
+	mInputs.emplace_back(b);
+	mSteps.push_back({nullptr, op, 0, 1, -1});
+}
+
+FusedZGen* FusedZGen::absorbable(const ZIn& in, size_t numSteps) const
+{
+	// only a list that nothing else can see and that has not yet produced anything can be
+	// absorbed. otherwise its values would be computed twice or its blocks would be lost.
+	if (in.isConstant() || in.mOffset != 0) return nullptr;
+	List* list = in.mList();
+	if (!list || list->getRefcount() != 1 || !list->isThunk() || list->isFilled()) return nullptr;
+	FusedZGen* gen = dynamic_cast<FusedZGen*>(list->mGen());
+	if (!gen || gen->getRefcount() != 1 || gen->mOut != list || gen->mFused || gen->mDone) return nullptr;
+	if (gen->mBlockSize != mBlockSize) return nullptr;
+	if (numSteps + gen->mSteps.size() > kMaxFusedSteps) return nullptr;
+	return gen;
+}
+
+int FusedZGen::fuseOperand(FusedZGen* gen, int operand, std::vector<int>& stepMap, std::vector<ZIn>& inputs, std::vector<Step>& steps)
+{
+	if (operand < 0) return ~stepMap[~operand];
+	ZIn& in = gen->mInputs[operand];
+	if (FusedZGen* child = absorbable(in, steps.size())) {
+		return fuseSteps(child, inputs, steps);
+	}
+	inputs.push_back(in);
+	return (int)inputs.size() - 1;
+}
+
+int FusedZGen::fuseSteps(FusedZGen* gen, std::vector<ZIn>& inputs, std::vector<Step>& steps)
+{
+	std::vector<int> stepMap(gen->mSteps.size());
+	for (size_t k = 0; k < gen->mSteps.size(); ++k) {
+		Step step = gen->mSteps[k];
+		step.a = fuseOperand(gen, step.a, stepMap, inputs, steps);
+		if (step.binaryOp) {
+			step.b = fuseOperand(gen, step.b, stepMap, inputs, steps);
+		}
+		stepMap[k] = (int)steps.size();
+		steps.push_back(step);
+	}
+	return ~stepMap.back();
+}
+
+void FusedZGen::allocateScratch()
+{
+	// give each intermediate result a scratch block, reusing a block once its last reader has run.
+	// a step never writes over its own operands, since some loopz kernels make more than one pass.
+	const int numSteps = (int)mSteps.size();
+	std::vector<int> lastUse(numSteps, -1);
+	for (int k = 0; k < numSteps; ++k) {
+		const Step& step = mSteps[k];
+		if (step.a < 0) lastUse[~step.a] = k;
+		if (step.binaryOp && step.b < 0) lastUse[~step.b] = k;
+	}
+
+	std::vector<int> freeBlocks;
+	int numBlocks = 0;
+	for (int k = 0; k < numSteps; ++k) {
+		Step& step = mSteps[k];
+		if (k == numSteps - 1) {
+			step.out = -1;
+		} else if (freeBlocks.empty()) {
+			step.out = numBlocks++;
 		} else {
-			op->loopz(n, a, astride, out);
-			_a.advance(n);
-			framesToFill -= n;
-			out += n;
+			step.out = freeBlocks.back();
+			freeBlocks.pop_back();
 		}
+		if (step.a < 0 && lastUse[~step.a] == k) freeBlocks.push_back(mSteps[~step.a].out);
+		if (step.binaryOp && step.b < 0 && step.b != step.a && lastUse[~step.b] == k) freeBlocks.push_back(mSteps[~step.b].out);
 	}
-	produce(framesToFill);
+	mScratch.assign((size_t)numBlocks * mBlockSize, 0.);
 }
 
+void FusedZGen::fuse()
+{
+	std::vector<ZIn> inputs;
+	std::vector<Step> steps;
+	fuseSteps(this, inputs, steps);
+	// releasing the old inputs frees the absorbed lists and their generators.
+	mInputs = std::move(inputs);
+	mSteps = std::move(steps);
+	mInputBuffers.assign(mInputs.size(), nullptr);
+	mInputStrides.assign(mInputs.size(), 0);
+	allocateScratch();
+	mFused = true;
+}
+
+const Z* FusedZGen::operand(int inOperand, int& outStride) const
+{
+	if (inOperand >= 0) {
+		outStride = mInputStrides[inOperand];
+		return mInputBuffers[inOperand];
+	}
+	outStride = 1;
+	return mScratch.data() + (size_t)mSteps[~inOperand].out * mBlockSize;
+}
 
-void BinaryOpZGen::pull(Thread& th)
+bool FusedZGen::blockInputs(std::vector<ZIn*>& outInputs)
 {
+	// fuse first, so that the schedule sees the inputs that pull() will read.
+	if (!mFused) fuse();
+	for (ZIn& in : mInputs) outInputs.push_back(&in);
+	return true;
+}
+
+void FusedZGen::pull(Thread& th)
+{
+	if (!mFused) fuse();
+
+	const int numInputs = (int)mInputs.size();
+	const int lastStep = (int)mSteps.size() - 1;
 	int framesToFill = mBlockSize;
 	Z* out = mOut->fulfillz(framesToFill);
 	while (framesToFill) {
 		int n = framesToFill;
-		int astride, bstride;
-		Z *a, *b;
-		if (_a(th, n,astride, a) || _b(th, n,bstride, b)) {
+		bool done = false;
+		for (int i = 0; i < numInputs; ++i) {
+			if (mInputs[i](th, n, mInputStrides[i], mInputBuffers[i])) {
+				done = true;
+				break;
+			}
+		}
+		if (done) {
 			setDone();
 			break;
-		} else {
-			op->loopz(n, a, astride, b, bstride, out);
-			_a.advance(n);
-			_b.advance(n);
-			framesToFill -= n;
-			out += n;
 		}
+		for (int k = 0; k <= lastStep; ++k) {
+			const Step& step = mSteps[k];
+			Z* stepOut = k == lastStep ? out : mScratch.data() + (size_t)step.out * mBlockSize;
+			int astride;
+			const Z* a = operand(step.a, astride);
+			if (step.binaryOp) {
+				int bstride;
+				const Z* b = operand(step.b, bstride);
+				binaryLoopz(step.binaryOp, n, a, astride, b, bstride, stepOut);
+			} else {
+				step.unaryOp->loopz(n, a, astride, stepOut);
+			}
+		}
+		for (int i = 0; i < numInputs; ++i) {
+			mInputs[i].advance(n);
+		}
+		framesToFill -= n;
+		out += n;
 	}
 	produce(framesToFill);
 }
@@ -179,7 +312,7 @@ void BinaryOpLinkZGen::pull(Thread& th)
 			setDone();
 			break;
 		} else {
-			op->loopz(n, a, astride, b, bstride, out);
+			binaryLoopz(op, n, a, astride, b, bstride, out);
 			_a.advance(n);
 			_b.advance(n);
 			framesToFill -= n;
@@ -354,21 +487,122 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 	}
 }
 
+// the kernels are run into this many frames of scratch and copied back, rather than run in place,
+// because some of them make more than one pass over their output.
+const int kInPlaceFrames = 4096;
+
+static List* unsharedZList(Arg v)
+{
+	if (!v.isZList()) return nullptr;
+	List* list = (List*)v.o();
+	return list->isUnshared() ? list : nullptr;
+}
+
+static bool isPackedZList(Arg v)
+{
+	return v.isZList() && ((List*)v.o())->isPacked();
+}
+
+bool unaryOpInPlace(Thread& th, UnaryOp* op, Arg a)
+{
+	List* list = unsharedZList(a);
+	if (!list) return false;
+
+	Z* z = list->mArray->z();
+	int64_t size = list->mArray->size();
+	Z buf[kInPlaceFrames];
+	for (int64_t i = 0; i < size; i += kInPlaceFrames) {
+		int n = (int)std::min(size - i, (int64_t)kInPlaceFrames);
+		op->loopz(n, z + i, 1, buf);
+		memcpy(z + i, buf, n * sizeof(Z));
+	}
+	return true;
+}
+
+bool binaryOpInPlace(Thread& th, BinaryOp* op, Arg a, Arg b, V& out)
+{
+	List* list = unsharedZList(a);
+	if (!list || !(b.isReal() || isPackedZList(b))) {
+		list = unsharedZList(b);
+		if (!list || !(a.isReal() || isPackedZList(a))) return false;
+	}
+
+	// lists of different lengths are left to the lazy path, which knows whether the result ends
+	// with the shorter list or, for the link operators, continues with the longer one.
+	int64_t size = list->mArray->size();
+	Z af = a.f, bf = b.f;
+	const Z* az = &af;
+	const Z* bz = &bf;
+	int astride = 0, bstride = 0;
+	if (!a.isReal()) {
+		Array* array = ((List*)a.o())->mArray();
+		if (array->size() != size) return false;
+		az = array->z();
+		astride = 1;
+	}
+	if (!b.isReal()) {
+		Array* array = ((List*)b.o())->mArray();
+		if (array->size() != size) return false;
+		bz = array->z();
+		bstride = 1;
+	}
+
+	Z* z = list->mArray->z();
+	Z buf[kInPlaceFrames];
+	for (int64_t i = 0; i < size; i += kInPlaceFrames) {
+		int n = (int)std::min(size - i, (int64_t)kInPlaceFrames);
+		op->loopz(n, az + i * astride, astride, bz + i * bstride, bstride, buf);
+		memcpy(z + i, buf, n * sizeof(Z));
+	}
+	out = list;
+	return true;
+}
+
+static std::vector<UnaryOp*>& unaryOpTable()
+{
+	static std::vector<UnaryOp*> sOps;
+	return sOps;
+}
+
+static std::vector<BinaryOp*>& binaryOpTable()
+{
+	static std::vector<BinaryOp*> sOps;
+	return sOps;
+}
+
+std::vector<UnaryOp*> const& mathUnaryOps() { return unaryOpTable(); }
+std::vector<BinaryOp*> const& mathBinaryOps() { return binaryOpTable(); }
+
+struct MathOpRegistration
+{
+	MathOpRegistration(UnaryOp* inOp) { unaryOpTable().push_back(inOp); }
+	MathOpRegistration(BinaryOp* inOp) { binaryOpTable().push_back(inOp); }
+};
+
 #define UNARY_OP_PRIM(NAME) \
+	static MathOpRegistration NAME##_registration(&gUnaryOp_##NAME); \
 	static void NAME##_(Thread& th, Prim* prim) \
 	{ \
 		V a = th.pop(); \
+		if (unaryOpInPlace(th, &gUnaryOp_##NAME, a)) { \
+			th.push(a); \
+			return; \
+		} \
 		V c = a.unaryOp(th, &gUnaryOp_##NAME); \
 		th.push(c); \
 	} \
 
 
 #define BINARY_OP_PRIM(NAME) \
+	static MathOpRegistration NAME##_registration(&gBinaryOp_##NAME); \
 	static void NAME##_(Thread& th, Prim* prim) \
 	{ \
 		V b = th.pop(); \
 		V a = th.pop(); \
-		V c = a.binaryOp(th, &gBinaryOp_##NAME, b); \
+		V c; \
+		if (!binaryOpInPlace(th, &gBinaryOp_##NAME, a, b, c)) { \
+			c = a.binaryOp(th, &gBinaryOp_##NAME, b); \
+		} \
 		th.push(c); \
 	} \
 	static void NAME##_reduce_(Thread& th, Prim* prim) \
@@ -422,19 +656,75 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 	UNARY_OP_PRIM(NAME)
 #else
 
+// evaluate the Eigen expression op over A (and B), writing R. contiguous inputs get maps that
+// Eigen can vectorize, with aligned loads when every buffer starts on a pool alignment boundary,
+// as the blocks of pooled arrays do.
 #define ZARR_BINOP(op, n, aa, astride, bb, bstride, out) \
 	do { \
-		const ZArr A = zarr(aa, n, astride); \
-		const ZArr B = zarr(bb, n, bstride); \
-		ZArr R = zarr(out, n, 1); \
-		R = op; \
+		if ((astride) == 1 && (bstride) == 1) { \
+			if (isPoolAligned(aa) && isPoolAligned(bb) && isPoolAligned(out)) { \
+				const ZArrAlignedIn A(aa, n); \
+				const ZArrAlignedIn B(bb, n); \
+				ZArrAligned R(out, n); \
+				R = op; \
+			} else { \
+				const ZArrDenseIn A(aa, n); \
+				const ZArrDenseIn B(bb, n); \
+				ZArrDense R(out, n); \
+				R = op; \
+			} \
+		} else { \
+			const ZArr A = zarr(aa, n, astride); \
+			const ZArr B = zarr(bb, n, bstride); \
+			ZArr R = zarr(out, n, 1); \
+			R = op; \
+		} \
+	} while (0)
+
+// the same with a constant B or A, which Eigen broadcasts within its vector loop.
+#define ZARR_BINOP_ZS(op, n, aa, astride, b, out) \
+	do { \
+		const auto B = ZArrType::Constant(n, b); \
+		ZARR_UNOP(op, n, aa, astride, out); \
+	} while (0)
+
+#define ZARR_BINOP_SZ(op, n, a, bb, bstride, out) \
+	do { \
+		const auto A = ZArrType::Constant(n, a); \
+		if ((bstride) == 1) { \
+			if (isPoolAligned(bb) && isPoolAligned(out)) { \
+				const ZArrAlignedIn B(bb, n); \
+				ZArrAligned R(out, n); \
+				R = op; \
+			} else { \
+				const ZArrDenseIn B(bb, n); \
+				ZArrDense R(out, n); \
+				R = op; \
+			} \
+		} else { \
+			const ZArr B = zarr(bb, n, bstride); \
+			ZArr R = zarr(out, n, 1); \
+			R = op; \
+		} \
 	} while (0)
 
 #define ZARR_UNOP(op, n, aa, astride, out) \
 	do { \
-		const ZArr A = zarr(aa, n, astride); \
-		ZArr R = zarr(out, n, 1); \
-		R = op; \
+		if ((astride) == 1) { \
+			if (isPoolAligned(aa) && isPoolAligned(out)) { \
+				const ZArrAlignedIn A(aa, n); \
+				ZArrAligned R(out, n); \
+				R = op; \
+			} else { \
+				const ZArrDenseIn A(aa, n); \
+				ZArrDense R(out, n); \
+				R = op; \
+			} \
+		} else { \
+			const ZArr A = zarr(aa, n, astride); \
+			ZArr R = zarr(out, n, 1); \
+			R = op; \
+		} \
 	} while (0)
 
 #define DEFINE_UNOP_FLOATVV(NAME, CODE, VVCODE_ACCELERATE, VVCODE_EIGEN) \
@@ -453,28 +743,14 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 	UnaryOp* gUnaryOpPtr_##NAME = &gUnaryOp_##NAME; \
 	UNARY_OP_PRIM(NAME)
 
-// OP should be some code which takes ZBatch A and produces ZBatch R
-// TODO: By switching the relevant vars to use an aligned allocator provided by xsimd,
-//		we could use load/store_aligned and improve performance
-#define DEFINE_UNOP_FLOATVV_XSIMD(NAME, CODE, OP) \
+// loopz runs the kernel of the same name in SimdKernels, built for the best instruction set of
+// the cpu we are running on. It takes any stride, gathering the input when it isn't contiguous.
+#define DEFINE_UNOP_FLOATVV_XSIMD(NAME, CODE) \
 	struct UnaryOp_##NAME : public UnaryOp { \
 		virtual const char *Name() { return #NAME; } \
 		virtual double op(double a) { return CODE; } \
 		virtual void loopz(int n, const Z *aa, int astride, Z *out) { \
-			if (astride == 1) { \
-				size_t vec_size = n - n % zbatch_size; \
-				for (size_t i = 0; i < vec_size; i += zbatch_size) { \
-					ZBatch A = ZBatch::load_unaligned(&aa[i]); \
-					OP \
-					R.store_unaligned(&out[i]); \
-				} \
-				for(size_t i = vec_size; i < n; ++i) { \
-					Z a = aa[i]; \
-					out[i] = CODE; \
-				} \
-			} else { \
-				LOOP(i,n) { Z a = *aa; out[i] = CODE; aa += astride; } \
-			} \
+			simdKernels().NAME(n, aa, astride, out); \
 		} \
 	}; \
 	UnaryOp_##NAME gUnaryOp_##NAME; \
@@ -483,6 +759,16 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 
 #endif // SAPF_ACCELERATE
 
+// ops with a kernel in SimdKernels. Accelerate builds use vForce where it has the function
+// and the scalar loop where it doesn't.
+#ifdef SAPF_ACCELERATE
+#define DEFINE_UNOP_FLOAT_SIMD(NAME, CODE) DEFINE_UNOP_FLOAT(NAME, CODE)
+#define DEFINE_UNOP_FLOATVV_SIMD(NAME, CODE, VVCODE_ACCELERATE) DEFINE_UNOP_FLOATVV(NAME, CODE, VVCODE_ACCELERATE, "todo")
+#else
+#define DEFINE_UNOP_FLOAT_SIMD(NAME, CODE) DEFINE_UNOP_FLOATVV_XSIMD(NAME, CODE)
+#define DEFINE_UNOP_FLOATVV_SIMD(NAME, CODE, VVCODE_ACCELERATE) DEFINE_UNOP_FLOATVV_XSIMD(NAME, CODE)
+#endif // SAPF_ACCELERATE
+
 
 #define DEFINE_UNOP_INT(NAME, CODE) \
 	struct UnaryOp_##NAME : public UnaryOp { \
@@ -540,6 +826,12 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 		virtual void loopz(int n, const Z *aa, int astride, const Z *bb, int bstride, Z *out) { \
 			LOOP(i,n) { Z a = *aa; Z b = *bb; out[i] = CODE; aa += astride; bb += bstride; } \
 		} \
+		virtual void loopzs(int n, const Z *aa, int astride, Z b, Z *out) { \
+			LOOP(i,n) { Z a = *aa; out[i] = CODE; aa += astride; } \
+		} \
+		virtual void loopsz(int n, Z a, const Z *bb, int bstride, Z *out) { \
+			LOOP(i,n) { Z b = *bb; out[i] = CODE; bb += bstride; } \
+		} \
 		virtual void pairsz(int n, Z& z, Z *aa, int astride, Z *out) { \
 			Z b = z; \
 			LOOP(i,n) { Z a = *aa; out[i] = CODE; b = a; aa += astride; } \
@@ -568,6 +860,12 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 		virtual void loopz(int n, const Z *aa, int astride, const Z *bb, int bstride, Z *out) { \
 			LOOP(i,n) { Z a = *aa; Z b = *bb; out[i] = CODE; aa += astride; bb += bstride; } \
 		} \
+		virtual void loopzs(int n, const Z *aa, int astride, Z b, Z *out) { \
+			LOOP(i,n) { Z a = *aa; out[i] = CODE; aa += astride; } \
+		} \
+		virtual void loopsz(int n, Z a, const Z *bb, int bstride, Z *out) { \
+			LOOP(i,n) { Z b = *bb; out[i] = CODE; bb += bstride; } \
+		} \
 		virtual void pairsz(int n, Z& z, Z *aa, int astride, Z *out) { \
 			Z b = z; \
 			LOOP(i,n) { Z a = *aa; out[i] = CODE; b = a; aa += astride; } \
@@ -626,8 +924,7 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 	BinaryOp* gBinaryOpPtr_##NAME = &gBinaryOp_##NAME; \
 	BINARY_OP_PRIM(NAME)
 #else
-// TODO: We could also vectorize the astride=1/bstride=0 (and vice versa) cases if desired
-//	since it's easy to change that via Eigen.
+// a constant operand goes through loopzs / loopsz rather than loopz with a stride of 0.
 #define DEFINE_BINOP_FLOATVV(NAME, REQUIRE_STRIDE_1, CODE, VVCODE_ACCELERATE, VVCODE_EIGEN) \
 	struct BinaryOp_##NAME : public BinaryOp { \
 		virtual const char *Name() { return #NAME; } \
@@ -639,6 +936,12 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 				LOOP(i,n) { Z a = *aa; Z b = *bb; out[i] = CODE; aa += astride; bb += bstride; } \
 			} \
 		} \
+		virtual void loopzs(int n, const Z *aa, int astride, Z b, Z *out) { \
+			ZARR_BINOP_ZS(VVCODE_EIGEN, n, aa, astride, b, out); \
+		} \
+		virtual void loopsz(int n, Z a, const Z *bb, int bstride, Z *out) { \
+			ZARR_BINOP_SZ(VVCODE_EIGEN, n, a, bb, bstride, out); \
+		} \
 		virtual void pairsz(int n, Z& z, Z *aa, int astride, Z *out) { \
 			Z b = z; \
 			LOOP(i,n) { Z a = *aa; out[i] = CODE; b = a; aa += astride; } \
@@ -659,31 +962,14 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 	BinaryOp* gBinaryOpPtr_##NAME = &gBinaryOp_##NAME; \
 	BINARY_OP_PRIM(NAME)
 
-// op should take a ZBatch A and ZBatch B and
-// populate a ZBatch R with the result.
-// TODO: By switching the relevant vars to use an aligned allocator provided by xsimd,
-//		we could use load/store_aligned and improve performance
-#define DEFINE_BINOP_FLOATVV_XSIMD(NAME, CODE, OP) \
+// loopz runs the kernel of the same name in SimdKernels, built for the best instruction set of
+// the cpu we are running on, for any strides.
+#define DEFINE_BINOP_FLOATVV_XSIMD(NAME, CODE) \
 	struct BinaryOp_##NAME : public BinaryOp { \
 		virtual const char *Name() { return #NAME; } \
 		virtual double op(double a, double b) { return CODE; } \
 		virtual void loopz(int n, const Z *aa, int astride, const Z *bb, int bstride, Z *out) { \
-			if (astride == 1 && bstride == 1) { \
-				size_t vec_size = n - n % zbatch_size; \
-				for (size_t i = 0; i < vec_size; i += zbatch_size) { \
-					ZBatch A = ZBatch::load_unaligned(&aa[i]); \
-					ZBatch B = ZBatch::load_unaligned(&bb[i]); \
-					OP \
-					R.store_unaligned(&out[i]); \
-				} \
-				for(size_t i = vec_size; i < n; ++i) { \
-					Z a = aa[i]; \
-					Z b = bb[i]; \
-					out[i] = CODE; \
-				} \
-			} else { \
-				LOOP(i,n) { Z a = *aa; Z b = *bb; out[i] = CODE; aa += astride; bb += bstride; } \
-			} \
+			simdKernels().NAME(n, aa, astride, bb, bstride, out); \
 		} \
 		virtual void pairsz(int n, Z& z, Z *aa, int astride, Z *out) { \
 			Z b = z; \
@@ -708,6 +994,14 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 	
 #endif // SAPF_ACCELERATE
 
+#ifdef SAPF_ACCELERATE
+#define DEFINE_BINOP_FLOAT_SIMD(NAME, CODE) DEFINE_BINOP_FLOAT(NAME, CODE)
+#define DEFINE_BINOP_FLOATVV_SIMD(NAME, REQUIRE_STRIDE_1, CODE, VVCODE_ACCELERATE) DEFINE_BINOP_FLOATVV(NAME, REQUIRE_STRIDE_1, CODE, VVCODE_ACCELERATE, "todo")
+#else
+#define DEFINE_BINOP_FLOAT_SIMD(NAME, CODE) DEFINE_BINOP_FLOATVV_XSIMD(NAME, CODE)
+#define DEFINE_BINOP_FLOATVV_SIMD(NAME, REQUIRE_STRIDE_1, CODE, VVCODE_ACCELERATE) DEFINE_BINOP_FLOATVV_XSIMD(NAME, CODE)
+#endif // SAPF_ACCELERATE
+
 #define DEFINE_BINOP_INT(NAME, CODE) \
 	struct BinaryOp_##NAME : public BinaryOp { \
 		virtual const char *Name() { return #NAME; } \
@@ -746,6 +1040,12 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 		virtual void loopz(int n, const Z *aa, int astride, const Z *bb, int bstride, Z *out) { \
 			LOOP(i,n) { Z a = *aa; Z b = *bb; out[i] = (CODE) ? 1. : 0.; aa += astride; bb += bstride; } \
 		} \
+		virtual void loopzs(int n, const Z *aa, int astride, Z b, Z *out) { \
+			LOOP(i,n) { Z a = *aa; out[i] = (CODE) ? 1. : 0.; aa += astride; } \
+		} \
+		virtual void loopsz(int n, Z a, const Z *bb, int bstride, Z *out) { \
+			LOOP(i,n) { Z b = *bb; out[i] = (CODE) ? 1. : 0.; bb += bstride; } \
+		} \
 		virtual void pairsz(int n, Z& z, Z *aa, int astride, Z *out) { \
 			Z b = z; \
 			LOOP(i,n) { Z a = *aa; out[i] = (CODE) ? 1. : 0.; b = a; aa += astride; } \
@@ -821,7 +1121,7 @@ struct UnaryOp_ToZero : public UnaryOp {
 UnaryOp_ToZero gUnaryOp_ToZero; 
 
 DEFINE_UNOP_FLOATVV(neg, -a, vDSP_vnegD(const_cast<Z*>(aa), astride, out, 1, n), A * -1)
-DEFINE_UNOP_FLOAT(sgn, sc_sgn(a))
+DEFINE_UNOP_FLOAT_SIMD(sgn, sc_sgn(a))
 DEFINE_UNOP_FLOATVV(abs, fabs(a), vvfabs(out, aa, &n), A.abs())
 
 DEFINE_UNOP_INT(tolower, tolower((int)a))
@@ -839,67 +1139,52 @@ DEFINE_UNOP_INT(toupper, toupper((int)a))
 DEFINE_UNOP_FLOATVV(frac, a - floor(a), vvfloor(out, aa, &n); vDSP_vsubD(out, 1, aa, astride, out, 1, n), A - A.floor())
 DEFINE_UNOP_FLOATVV(floor, floor(a), vvfloor(out, aa, &n), A.floor())
 DEFINE_UNOP_FLOATVV(ceil, ceil(a), vvceil(out, aa, &n), A.ceil())
-DEFINE_UNOP_FLOATVV(rint, rint(a), vvnint(out, aa, &n), A.round())
+DEFINE_UNOP_FLOATVV_SIMD(rint, rint(a), vvnint(out, aa, &n))
 
-DEFINE_UNOP_FLOAT(erf, erf(a))
-DEFINE_UNOP_FLOAT(erfc, erfc(a))
+DEFINE_UNOP_FLOAT_SIMD(erf, erf(a))
+DEFINE_UNOP_FLOAT_SIMD(erfc, erfc(a))
 
 DEFINE_UNOP_FLOATVV(recip, 1./a, vvrec(out, aa, &n), 1. / A)
-DEFINE_UNOP_FLOATVV(sqrt, sc_sqrt(a), vvsqrt(out, aa, &n), A.sqrt())
-DEFINE_UNOP_FLOATVV(rsqrt, 1./sc_sqrt(a), vvrsqrt(out, aa, &n), A.rsqrt())
+DEFINE_UNOP_FLOATVV_SIMD(sqrt, sc_sqrt(a), vvsqrt(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(rsqrt, 1./sc_sqrt(a), vvrsqrt(out, aa, &n))
 DEFINE_UNOP_FLOATVV(ssq, copysign(a*a, a), vDSP_vssqD(aa, astride, out, 1, n), A.sign() * A.square())
 DEFINE_UNOP_FLOATVV(sq, a*a, vDSP_vsqD(aa, astride, out, 1, n), A.square())
-DEFINE_UNOP_FLOAT(cbrt, cbrt(a))
-
-DEFINE_UNOP_FLOAT(cb, a*a*a)
-DEFINE_UNOP_FLOAT(pow4, sc_fourth(a))
-DEFINE_UNOP_FLOAT(pow5, sc_fifth(a))
-DEFINE_UNOP_FLOAT(pow6, sc_sixth(a))
-DEFINE_UNOP_FLOAT(pow7, sc_seventh(a))
-DEFINE_UNOP_FLOAT(pow8, sc_eighth(a))
-DEFINE_UNOP_FLOAT(pow9, sc_ninth(a))
-
-DEFINE_UNOP_FLOATVV(exp, exp(a), vvexp(out, aa, &n), A.exp())
-DEFINE_UNOP_FLOATVV(exp2, exp2(a), vvexp2(out, aa, &n), pow(2,A))
-DEFINE_UNOP_FLOATVV(expm1, expm1(a), vvexpm1(out, aa, &n), A.exp() - 1)
-DEFINE_UNOP_FLOATVV(log, sc_log(a), vvlog(out, aa, &n), A.log())
-DEFINE_UNOP_FLOATVV(log2, sc_log2(a), vvlog2(out, aa, &n), A.log() / sc_log(2.0))
-DEFINE_UNOP_FLOATVV(log10, sc_log10(a), vvlog10(out, aa, &n), A.log10())
-DEFINE_UNOP_FLOATVV(log1p, log1p(a), vvlog1p(out, aa, &n), A.log1p())
-DEFINE_UNOP_FLOAT(exp10, pow(10., a))
-
-#ifdef SAPF_ACCELERATE
-	DEFINE_UNOP_FLOATVV(logb, logb(a), vvlogb(out, aa, &n), "todo")
-#else
-	// Extract IEEE 754 exponent bits, then unbias by subtracting
-	#if SAMPLE_IS_DOUBLE
-		DEFINE_UNOP_FLOATVV_XSIMD(logb, logb(a),
-			auto bits = xsimd::bitwise_cast<Z_INT_EQUIV>(A);
-			auto R = xsimd::to_float((bits >> 52) & 0x7FF) - 1023.0;
-		)
-	#else
-		DEFINE_UNOP_FLOATVV_XSIMD(logb, logb(a),
-			auto bits = xsimd::bitwise_cast<Z_INT_EQUIV>(A);
-			auto R = xsimd::to_float((bits >> 23) & 0xFF) - 127.0f;
-		)
-	#endif
-#endif
-
-DEFINE_UNOP_FLOAT(sinc, sc_sinc(a))
-DEFINE_UNOP_FLOATVV(sin, sin(a), vvsin(out, aa, &n), A.sin())
-DEFINE_UNOP_FLOATVV(cos, cos(a), vvcos(out, aa, &n), A.cos())
-DEFINE_UNOP_FLOATVV(sin1, sin(a * kTwoPi), Z b = kTwoPi; vDSP_vsmulD(const_cast<Z*>(aa), astride, &b, out, 1, n); vvsin(out, out, &n), (kTwoPi * A).sin())
-DEFINE_UNOP_FLOATVV(cos1, cos(a * kTwoPi), Z b = kTwoPi; vDSP_vsmulD(const_cast<Z*>(aa), astride, &b, out, 1, n); vvcos(out, out, &n), (kTwoPi * A).cos())
-DEFINE_UNOP_FLOATVV(tan, tan(a), vvtan(out, aa, &n), A.tan())
-DEFINE_UNOP_FLOATVV(asin, asin(a), vvasin(out, aa, &n), A.asin())
-DEFINE_UNOP_FLOATVV(acos, acos(a), vvacos(out, aa, &n), A.acos())
-DEFINE_UNOP_FLOATVV(atan, atan(a), vvatan(out, aa, &n), A.atan())
-DEFINE_UNOP_FLOATVV(sinh, sinh(a), vvsinh(out, aa, &n), A.sinh())
-DEFINE_UNOP_FLOATVV(cosh, cosh(a), vvcosh(out, aa, &n), A.cosh())
-DEFINE_UNOP_FLOATVV(tanh, tanh(a), vvtanh(out, aa, &n), A.tanh())
-DEFINE_UNOP_FLOATVV(asinh, asinh(a), vvasinh(out, aa, &n), A.asinh())
-DEFINE_UNOP_FLOATVV(acosh, acosh(a), vvacosh(out, aa, &n), A.acosh())
-DEFINE_UNOP_FLOATVV(atanh, atanh(a), vvatanh(out, aa, &n), A.atanh())
+DEFINE_UNOP_FLOAT_SIMD(cbrt, cbrt(a))
+
+DEFINE_UNOP_FLOAT_SIMD(cb, a*a*a)
+DEFINE_UNOP_FLOAT_SIMD(pow4, sc_fourth(a))
+DEFINE_UNOP_FLOAT_SIMD(pow5, sc_fifth(a))
+DEFINE_UNOP_FLOAT_SIMD(pow6, sc_sixth(a))
+DEFINE_UNOP_FLOAT_SIMD(pow7, sc_seventh(a))
+DEFINE_UNOP_FLOAT_SIMD(pow8, sc_eighth(a))
+DEFINE_UNOP_FLOAT_SIMD(pow9, sc_ninth(a))
+
+DEFINE_UNOP_FLOATVV_SIMD(exp, exp(a), vvexp(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(exp2, exp2(a), vvexp2(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(expm1, expm1(a), vvexpm1(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(log, sc_log(a), vvlog(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(log2, sc_log2(a), vvlog2(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(log10, sc_log10(a), vvlog10(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(log1p, log1p(a), vvlog1p(out, aa, &n))
+DEFINE_UNOP_FLOAT_SIMD(exp10, pow(10., a))
+
+DEFINE_UNOP_FLOATVV_SIMD(logb, logb(a), vvlogb(out, aa, &n))
+
+DEFINE_UNOP_FLOAT_SIMD(sinc, sc_sinc(a))
+DEFINE_UNOP_FLOATVV_SIMD(sin, sin(a), vvsin(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(cos, cos(a), vvcos(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(sin1, sin(a * kTwoPi), Z b = kTwoPi; vDSP_vsmulD(const_cast<Z*>(aa), astride, &b, out, 1, n); vvsin(out, out, &n))
+DEFINE_UNOP_FLOATVV_SIMD(cos1, cos(a * kTwoPi), Z b = kTwoPi; vDSP_vsmulD(const_cast<Z*>(aa), astride, &b, out, 1, n); vvcos(out, out, &n))
+DEFINE_UNOP_FLOATVV_SIMD(tan, tan(a), vvtan(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(asin, asin(a), vvasin(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(acos, acos(a), vvacos(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(atan, atan(a), vvatan(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(sinh, sinh(a), vvsinh(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(cosh, cosh(a), vvcosh(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(tanh, tanh(a), vvtanh(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(asinh, asinh(a), vvasinh(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(acosh, acosh(a), vvacosh(out, aa, &n))
+DEFINE_UNOP_FLOATVV_SIMD(atanh, atanh(a), vvatanh(out, aa, &n))
 
 #ifdef _WIN32
 	DEFINE_UNOP_FLOAT(J0, _j0(a))
@@ -913,8 +1198,8 @@ DEFINE_UNOP_FLOATVV(atanh, atanh(a), vvatanh(out, aa, &n), A.atanh())
 	DEFINE_UNOP_FLOAT(Y1, y1(a))
 #endif
 
-DEFINE_UNOP_FLOAT(tgamma, tgamma(a))
-DEFINE_UNOP_FLOAT(lgamma, lgamma(a))
+DEFINE_UNOP_FLOAT_SIMD(tgamma, tgamma(a))
+DEFINE_UNOP_FLOAT_SIMD(lgamma, lgamma(a))
 
 static void sc_clipv(int n, const Z* in, Z* out, Z a, Z b)
 {
@@ -930,27 +1215,27 @@ DEFINE_UNOP_FLOATVV(twice, a*2., Z b = 2.; vDSP_vsmulD(const_cast<Z*>(aa), astri
 
 DEFINE_UNOP_FLOATVV(biuni, a*.5+.5, Z b = .5; vDSP_vsmulD(const_cast<Z*>(aa), astride, &b, out, 1, n); vDSP_vsaddD(out, 1, &b, out, 1, n), A * .5 + .5)
 DEFINE_UNOP_FLOATVV(unibi, a*2.-1., Z b = 2.; Z c = -1.; vDSP_vsmulD(aa, astride, &b, out, 1, n); vDSP_vsaddD(out, 1, &c, out, 1, n), A * 2. - 1.)
-DEFINE_UNOP_FLOATVV(biunic, std::clamp(a,-1.,1.)*.5+.5, Z b = .5; sc_clipv(n, aa, out, -1., 1.); vDSP_vsmulD(out, astride, &b, out, 1, n); vDSP_vsaddD(out, 1, &b, out, 1, n), A.min(1.).max(-1.) * .5 + .5)
-DEFINE_UNOP_FLOATVV(unibic, std::clamp(a,0.,1.)*2.-1., Z b = 2.; Z c = -1.; sc_clipv(n, aa, out, 0., 1.); vDSP_vsmulD(out, astride, &b, out, 1, n); vDSP_vsaddD(out, 1, &c, out, 1, n), A.min(1.).max(0.) * 2. - 1.)
-DEFINE_UNOP_FLOAT(cmpl, 1.-a)
+DEFINE_UNOP_FLOATVV(biunic, std::clamp<Z>(a,-1.,1.)*.5+.5, Z b = .5; sc_clipv(n, aa, out, -1., 1.); vDSP_vsmulD(out, astride, &b, out, 1, n); vDSP_vsaddD(out, 1, &b, out, 1, n), A.min(1.).max(-1.) * .5 + .5)
+DEFINE_UNOP_FLOATVV(unibic, std::clamp<Z>(a,0.,1.)*2.-1., Z b = 2.; Z c = -1.; sc_clipv(n, aa, out, 0., 1.); vDSP_vsmulD(out, astride, &b, out, 1, n); vDSP_vsaddD(out, 1, &c, out, 1, n), A.min(1.).max(0.) * 2. - 1.)
+DEFINE_UNOP_FLOAT_SIMD(cmpl, 1.-a)
 
-DEFINE_UNOP_FLOATVV(ampdb, sc_ampdb(a), Z b = 1.; vDSP_vdbconD(const_cast<Z*>(aa), astride, &b, out, 1, n, 1),  A.log10() * 20.)
-DEFINE_UNOP_FLOAT(dbamp,     sc_dbamp(a))
+DEFINE_UNOP_FLOATVV_SIMD(ampdb, sc_ampdb(a), Z b = 1.; vDSP_vdbconD(const_cast<Z*>(aa), astride, &b, out, 1, n, 1))
+DEFINE_UNOP_FLOAT_SIMD(dbamp,     sc_dbamp(a))
 
-DEFINE_UNOP_FLOAT(hzo,   sc_hzoct(a))
-DEFINE_UNOP_FLOAT(ohz,   sc_octhz(a))
+DEFINE_UNOP_FLOAT_SIMD(hzo,   sc_hzoct(a))
+DEFINE_UNOP_FLOAT_SIMD(ohz,   sc_octhz(a))
 
-DEFINE_UNOP_FLOAT(hzst,   sc_hzkey(a))
-DEFINE_UNOP_FLOAT(sthz,   sc_keyhz(a))
+DEFINE_UNOP_FLOAT_SIMD(hzst,   sc_hzkey(a))
+DEFINE_UNOP_FLOAT_SIMD(sthz,   sc_keyhz(a))
 
-DEFINE_UNOP_FLOAT(hznn,   sc_hznn(a))
-DEFINE_UNOP_FLOAT(nnhz,   sc_nnhz(a))
+DEFINE_UNOP_FLOAT_SIMD(hznn,   sc_hznn(a))
+DEFINE_UNOP_FLOAT_SIMD(nnhz,   sc_nnhz(a))
 
-DEFINE_UNOP_FLOAT(centsratio, sc_centsratio(a))
-DEFINE_UNOP_FLOAT(ratiocents, sc_ratiocents(a))
+DEFINE_UNOP_FLOAT_SIMD(centsratio, sc_centsratio(a))
+DEFINE_UNOP_FLOAT_SIMD(ratiocents, sc_ratiocents(a))
 
-DEFINE_UNOP_FLOAT(semiratio, sc_semiratio(a))
-DEFINE_UNOP_FLOAT(ratiosemi, sc_ratiosemi(a))
+DEFINE_UNOP_FLOAT_SIMD(semiratio, sc_semiratio(a))
+DEFINE_UNOP_FLOAT_SIMD(ratiosemi, sc_ratiosemi(a))
 
 DEFINE_UNOP_FLOATVV(degrad, a*kDegToRad, Z b = kDegToRad; vDSP_vsmulD(aa, astride, &b, out, 1, n), A * kDegToRad)
 DEFINE_UNOP_FLOATVV(raddeg, a*kRadToDeg, Z b = kRadToDeg; vDSP_vsmulD(aa, astride, &b, out, 1, n), A * kRadToDeg)
@@ -958,19 +1243,19 @@ DEFINE_UNOP_FLOATVV(minsec, a*kMinToSecs, Z b = kMinToSecs; vDSP_vsmulD(aa, astr
 DEFINE_UNOP_FLOATVV(secmin, a*kSecsToMin, Z b = kSecsToMin; vDSP_vsmulD(aa, astride, &b, out, 1, n), A * kSecsToMin)
 DEFINE_UNOP_FLOATVV(bpmsec, kMinToSecs / a, Z b = kMinToSecs; vDSP_svdivD(&b, const_cast<double*>(aa), astride, out, 1, n), kMinToSecs / A)
 
-DEFINE_UNOP_FLOAT(distort,  sc_distort(a))
-DEFINE_UNOP_FLOAT(softclip, sc_softclip(a))
+DEFINE_UNOP_FLOAT_SIMD(distort,  sc_distort(a))
+DEFINE_UNOP_FLOAT_SIMD(softclip, sc_softclip(a))
 
-DEFINE_UNOP_FLOAT(rectWin,  sc_rectWindow(a))
-DEFINE_UNOP_FLOAT(triWin,   sc_triWindow(a))
-DEFINE_UNOP_FLOAT(bitriWin, sc_bitriWindow(a))
-DEFINE_UNOP_FLOAT(hanWin,   sc_hanWindow(a))
-DEFINE_UNOP_FLOAT(sinWin,   sc_sinWindow(a))
-DEFINE_UNOP_FLOAT(ramp,     sc_ramp(a))
-DEFINE_UNOP_FLOAT(scurve,   sc_scurve(a))
-DEFINE_UNOP_FLOAT(sigm,		a/sqrt(1.+a*a))
+DEFINE_UNOP_FLOAT_SIMD(rectWin,  sc_rectWindow(a))
+DEFINE_UNOP_FLOAT_SIMD(triWin,   sc_triWindow(a))
+DEFINE_UNOP_FLOAT_SIMD(bitriWin, sc_bitriWindow(a))
+DEFINE_UNOP_FLOAT_SIMD(hanWin,   sc_hanWindow(a))
+DEFINE_UNOP_FLOAT_SIMD(sinWin,   sc_sinWindow(a))
+DEFINE_UNOP_FLOAT_SIMD(ramp,     sc_ramp(a))
+DEFINE_UNOP_FLOAT_SIMD(scurve,   sc_scurve(a))
+DEFINE_UNOP_FLOAT_SIMD(sigm,		a/sqrt(1.+a*a))
 
-DEFINE_UNOP_FLOAT(zapgremlins, zapgremlins(a))
+DEFINE_UNOP_FLOAT_SIMD(zapgremlins, zapgremlins(a))
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -982,48 +1267,49 @@ DEFINE_BINOP_BOOL_FLOAT(eq, a == b, strcmp(a, b) == 0)
 DEFINE_BINOP_BOOL_FLOAT(ne, a != b, strcmp(a, b) != 0)
 DEFINE_BINOP_FLOAT_STRING(cmp,  sc_cmp(a, b), sc_sgn(strcmp(a, b)))
 
-DEFINE_BINOP_FLOATVV(copysign, 1, copysign(a, b), vvcopysign(out, const_cast<Z*>(aa), bb, &n), A.abs() * B.sign()) // bug in vForce.h requires const_cast
-
-#ifdef SAPF_ACCELERATE
-	DEFINE_BINOP_FLOATVV(nextafter, 1, nextafter(a, b), vvnextafter(out, const_cast<Z*>(aa), bb, &n), "todo") // bug in vForce.h requires const_cast
-#else
-    using int_batch  = xsimd::batch<Z_INT_EQUIV>;
-    using bool_batch = xsimd::batch_bool<Z_INT_EQUIV>;
-
-    const xsimd::batch<Z_INT_EQUIV> sign_mask = xsimd::bitwise_cast<Z_INT_EQUIV>(xsimd::batch<Z>{-0.0});
-    const xsimd::batch<Z_INT_EQUIV> zero_mask{0};
-    const xsimd::batch<Z_INT_EQUIV> one_mask{1};
-    const xsimd::batch<Z_INT_EQUIV> neg_one_mask{-1};
-
-    DEFINE_BINOP_FLOATVV_XSIMD(nextafter, nextafter(a, b),
-        // Handle case where from == to
-        auto equal_mask = (A == B);
-
-        // Bitwise view
-        auto from_bits = xsimd::bitwise_cast<Z_INT_EQUIV>(A);
-        auto to_bits   = xsimd::bitwise_cast<Z_INT_EQUIV>(B);
-
-        // Handle -0.0 correctly: treat it as 0
-        auto is_neg_zero = (from_bits == sign_mask);
-        auto cleaned_from_bits = xsimd::select(is_neg_zero, zero_mask, from_bits);
-
-        // Compare bitwise: from_bits < to_bits
-        bool_batch direction_mask = (cleaned_from_bits < to_bits);
+DEFINE_BINOP_FLOATVV_SIMD(copysign, 1, copysign(a, b), vvcopysign(out, const_cast<Z*>(aa), bb, &n)) // bug in vForce.h requires const_cast
 
-        // Select +1 or -1 based on direction
-        auto increment = xsimd::select(direction_mask, one_mask, neg_one_mask);
+DEFINE_BINOP_FLOATVV_SIMD(nextafter, 1, nextafter(a, b), vvnextafter(out, const_cast<Z*>(aa), bb, &n)) // bug in vForce.h requires const_cast
 
-        auto adjusted_bits = cleaned_from_bits + increment;
+// identity optimizations of basic operators.
 
-        // Reinterpret as Z
-        auto result = xsimd::bitwise_cast<Z>(adjusted_bits);
+static void copyz(int n, const Z *aa, int astride, Z *out)
+{
+	if (astride == 1) {
+		memcpy(out, aa, n * sizeof(Z));
+	} else {
+		LOOP(i,n) { out[i] = *aa; aa += astride; }
+	}
+}
 
-        // Use original comparison to handle from == to
-        auto R = xsimd::select(equal_mask, B, result);
-    )
-#endif
+// offset and gain by a constant, the most common signal math of all.
+static void addzs(int n, const Z *aa, int astride, Z b, Z *out)
+{
+	if (b == 0.) {
+		copyz(n, aa, astride, out);
+	} else {
+#ifdef SAPF_ACCELERATE
+		vDSP_vsaddD(const_cast<Z*>(aa), astride, &b, out, 1, n);
+#else
+		ZARR_UNOP(A + b, n, aa, astride, out);
+#endif // SAPF_ACCELERATE
+	}
+}
 
-// identity optimizations of basic operators.
+static void mulzs(int n, const Z *aa, int astride, Z b, Z *out)
+{
+	if (b == 1.) {
+		copyz(n, aa, astride, out);
+	} else if (b == 0.) {
+		LOOP(i,n) { out[i] = 0.; }
+	} else {
+#ifdef SAPF_ACCELERATE
+		vDSP_vsmulD(const_cast<Z*>(aa), astride, &b, out, 1, n);
+#else
+		ZARR_UNOP(A * b, n, aa, astride, out);
+#endif // SAPF_ACCELERATE
+	}
+}
 
 	struct BinaryOp_plus : public BinaryOp {
 		virtual const char *Name() { return "plus"; }
@@ -1058,6 +1344,12 @@ DEFINE_BINOP_FLOATVV(copysign, 1, copysign(a, b), vvcopysign(out, const_cast<Z*>
 #endif // SAPF_ACCELERATE
 			}
         }
+		virtual void loopzs(int n, const Z *aa, int astride, Z b, Z *out) {
+			addzs(n, aa, astride, b, out);
+		}
+		virtual void loopsz(int n, Z a, const Z *bb, int bstride, Z *out) {
+			addzs(n, bb, bstride, a, out);
+		}
         virtual void pairsz(int n, Z& z, Z *aa, int astride, Z *out) {
 			Z b = z;
 			LOOP(i,n) { Z a = *aa; out[i] = a + b; b = a; aa += astride; }
@@ -1084,7 +1376,7 @@ DEFINE_BINOP_FLOATVV(copysign, 1, copysign(a, b), vvcopysign(out, const_cast<Z*>
 		{
 			if (a.isReal() && a.f == 0.) return b;
 			if (b.isReal() && b.f == 0.) return a;
-			return new List(new BinaryOpZGen(th, this, a, b));
+			return new List(new FusedZGen(th, this, a, b));
 		}
 	};
 	BinaryOp_plus gBinaryOp_plus;
@@ -1125,6 +1417,12 @@ DEFINE_BINOP_FLOATVV(copysign, 1, copysign(a, b), vvcopysign(out, const_cast<Z*>
 #endif // SAPF_ACCELERATE
 			}
 		}
+		virtual void loopzs(int n, const Z *aa, int astride, Z b, Z *out) {
+			addzs(n, aa, astride, b, out);
+		}
+		virtual void loopsz(int n, Z a, const Z *bb, int bstride, Z *out) {
+			addzs(n, bb, bstride, a, out);
+		}
 		virtual void pairsz(int n, Z& z, Z *aa, int astride, Z *out) {
 			Z b = z;
 			LOOP(i,n) { Z a = *aa; out[i] = a + b; b = a; aa += astride; }
@@ -1193,6 +1491,17 @@ DEFINE_BINOP_FLOATVV(copysign, 1, copysign(a, b), vvcopysign(out, const_cast<Z*>
 #endif // SAPF_ACCELERATE
 			}
 		}
+		virtual void loopzs(int n, const Z *aa, int astride, Z b, Z *out) {
+			addzs(n, aa, astride, -b, out);
+		}
+		virtual void loopsz(int n, Z a, const Z *bb, int bstride, Z *out) {
+#ifdef SAPF_ACCELERATE
+			Z m = -1.;
+			vDSP_vsmsaD(const_cast<Z*>(bb), bstride, &m, &a, out, 1, n);
+#else
+			ZARR_UNOP(a - A, n, bb, bstride, out);
+#endif // SAPF_ACCELERATE
+		}
 		virtual void pairsz(int n, Z& z, Z *aa, int astride, Z *out) {
 			Z b = z;
 			LOOP(i,n) { Z a = *aa; out[i] = a - b; b = a; aa += astride; }
@@ -1218,9 +1527,9 @@ DEFINE_BINOP_FLOATVV(copysign, 1, copysign(a, b), vvcopysign(out, const_cast<Z*>
 
 		virtual V makeZList(Thread& th, Arg a, Arg b)
 		{
-			if (a.isReal() && a.f == 0.) return new List(new UnaryOpZGen(th, &gUnaryOp_neg, b));
+			if (a.isReal() && a.f == 0.) return new List(new FusedZGen(th, &gUnaryOp_neg, b));
 			if (b.isReal() && b.f == 0.) return a;
-			return new List(new BinaryOpZGen(th, this, a, b));
+			return new List(new FusedZGen(th, this, a, b));
 		}
 	};
 	BinaryOp_minus gBinaryOp_minus;
@@ -1263,6 +1572,12 @@ DEFINE_BINOP_FLOATVV(copysign, 1, copysign(a, b), vvcopysign(out, const_cast<Z*>
 #endif // SAPF_ACCELERATE
 			}
 		}
+		virtual void loopzs(int n, const Z *aa, int astride, Z b, Z *out) {
+			mulzs(n, aa, astride, b, out);
+		}
+		virtual void loopsz(int n, Z a, const Z *bb, int bstride, Z *out) {
+			mulzs(n, bb, bstride, a, out);
+		}
 		virtual void pairsz(int n, Z& z, Z *aa, int astride, Z *out) {
 			Z b = z;
 			LOOP(i,n) { Z a = *aa; out[i] = a * b; b = a; aa += astride; }
@@ -1298,15 +1613,15 @@ DEFINE_BINOP_FLOATVV(copysign, 1, copysign(a, b), vvcopysign(out, const_cast<Z*>
 		{
 			if (a.isReal()) {
 				if (a.f == 1.) return b;
-				if (a.f == 0.) return new List(new UnaryOpZGen(th, &gUnaryOp_ToZero, b));
-				if (a.f == -1.) return new List(new UnaryOpZGen(th, &gUnaryOp_neg, b));
+				if (a.f == 0.) return new List(new FusedZGen(th, &gUnaryOp_ToZero, b));
+				if (a.f == -1.) return new List(new FusedZGen(th, &gUnaryOp_neg, b));
 			}
 			if (b.isReal()) {
 				if (b.f == 1.) return a;
-				if (b.f == 0.) return new List(new UnaryOpZGen(th, &gUnaryOp_ToZero, a));
-				if (b.f == -1.) return new List(new UnaryOpZGen(th, &gUnaryOp_neg, a));
+				if (b.f == 0.) return new List(new FusedZGen(th, &gUnaryOp_ToZero, a));
+				if (b.f == -1.) return new List(new FusedZGen(th, &gUnaryOp_neg, a));
 			}
-			return new List(new BinaryOpZGen(th, this, a, b));
+			return new List(new FusedZGen(th, this, a, b));
 		}
 	};
 	BinaryOp_mul gBinaryOp_mul;
@@ -1321,7 +1636,7 @@ DEFINE_BINOP_FLOATVV(copysign, 1, copysign(a, b), vvcopysign(out, const_cast<Z*>
 				LOOP(i,n) { out[i] = 0.; }
 			} else if (bstride == 0) {
 				if (*bb == 1.) {
-					LOOP(i,n) { out[i] = *aa; aa += bstride; }
+					LOOP(i,n) { out[i] = *aa; aa += astride; }
 				} else {
 					Z rb = 1. / *bb;
 #ifdef SAPF_ACCELERATE
@@ -1335,6 +1650,29 @@ DEFINE_BINOP_FLOATVV(copysign, 1, copysign(a, b), vvcopysign(out, const_cast<Z*>
 				vDSP_vdivD(const_cast<Z*>(bb), bstride, const_cast<Z*>(aa), astride, out, 1, n);
 #else
                  ZARR_BINOP(A / B, n, aa, astride, bb, bstride, out);
+#endif // SAPF_ACCELERATE
+			}
+		}
+		virtual void loopzs(int n, const Z *aa, int astride, Z b, Z *out) {
+			if (b == 1.) {
+				copyz(n, aa, astride, out);
+			} else {
+#ifdef SAPF_ACCELERATE
+				Z rb = 1. / b;
+				vDSP_vsmulD(const_cast<Z*>(aa), astride, &rb, out, 1, n);
+#else
+				ZARR_UNOP(A / b, n, aa, astride, out);
+#endif // SAPF_ACCELERATE
+			}
+		}
+		virtual void loopsz(int n, Z a, const Z *bb, int bstride, Z *out) {
+			if (a == 0.) {
+				LOOP(i,n) { out[i] = 0.; }
+			} else {
+#ifdef SAPF_ACCELERATE
+				vDSP_svdivD(&a, const_cast<Z*>(bb), bstride, out, 1, n);
+#else
+				ZARR_UNOP(a / A, n, bb, bstride, out);
 #endif // SAPF_ACCELERATE
 			}
 		}
@@ -1362,9 +1700,9 @@ DEFINE_BINOP_FLOATVV(copysign, 1, copysign(a, b), vvcopysign(out, const_cast<Z*>
 
 		virtual V makeZList(Thread& th, Arg a, Arg b)
 		{
-			if (a.isReal() && a.f == 0.) return new List(new UnaryOpZGen(th, &gUnaryOp_ToZero, b));
+			if (a.isReal() && a.f == 0.) return new List(new FusedZGen(th, &gUnaryOp_ToZero, b));
 			if (b.isReal() && b.f == 1.) return a;
-			return new List(new BinaryOpZGen(th, this, a, b));
+			return new List(new FusedZGen(th, this, a, b));
 		}
 	};
 	BinaryOp_div gBinaryOp_div;
@@ -1377,15 +1715,9 @@ DEFINE_BINOP_FLOAT(remainder, remainder(a, b))
 DEFINE_BINOP_INT(idiv, sc_div(a, b))
 DEFINE_BINOP_INT(imod, sc_imod(a, b))
 
-DEFINE_BINOP_FLOATVV(pow, 1, sc_pow(a, b), vvpow(out, bb, aa, &n), pow(A, B))
+DEFINE_BINOP_FLOATVV_SIMD(pow, 1, sc_pow(a, b), vvpow(out, bb, aa, &n))
 
-#ifdef SAPF_ACCELERATE
-	DEFINE_BINOP_FLOATVV(atan2, 1, atan2(a, b), vvatan2(out, aa, bb, &n), "todo")
-#else
-	DEFINE_BINOP_FLOATVV_XSIMD(atan2, atan2(a, b),
-		auto R = xsimd::atan2(A, B);
-	)
-#endif
+DEFINE_BINOP_FLOATVV_SIMD(atan2, 1, atan2(a, b), vvatan2(out, aa, bb, &n))
 
 
 #ifdef _WIN32
@@ -1398,44 +1730,44 @@ DEFINE_BINOP_FLOATVV(pow, 1, sc_pow(a, b), vvpow(out, bb, aa, &n), pow(A, B))
 
 DEFINE_BINOP_FLOATVV(min, 0, fmin(a, b), vDSP_vminD(const_cast<Z*>(aa), astride, const_cast<Z*>(bb), bstride, out, 1, n), A.min(B))
 DEFINE_BINOP_FLOATVV(max, 0, fmax(a, b), vDSP_vmaxD(const_cast<Z*>(aa), astride, const_cast<Z*>(bb), bstride, out, 1, n), A.max(B))
-DEFINE_BINOP_FLOAT(dim, fdim(a, b))
+DEFINE_BINOP_FLOAT_SIMD(dim, fdim(a, b))
 DEFINE_BINOP_FLOAT(xor, fdim(a, b))
 
-DEFINE_BINOP_FLOAT(avg2, (a + b) * .5)
-DEFINE_BINOP_FLOAT(absdif, fabs(a - b))
-DEFINE_BINOP_FLOATVV(hypot, 0, hypot(a, b), vDSP_vdistD(const_cast<Z*>(aa), astride, const_cast<Z*>(bb), bstride, out, 1, n), (A.square() + B.square()).sqrt())
-DEFINE_BINOP_FLOAT(sumsq, a*a + b*b)
-DEFINE_BINOP_FLOAT(difsq, a*a - b*b)
-DEFINE_BINOP_FLOAT(sqsum, sc_squared(a + b))
-DEFINE_BINOP_FLOAT(sqdif, sc_squared(a - b))
+DEFINE_BINOP_FLOAT_SIMD(avg2, (a + b) * .5)
+DEFINE_BINOP_FLOAT_SIMD(absdif, fabs(a - b))
+DEFINE_BINOP_FLOATVV_SIMD(hypot, 0, hypot(a, b), vDSP_vdistD(const_cast<Z*>(aa), astride, const_cast<Z*>(bb), bstride, out, 1, n))
+DEFINE_BINOP_FLOAT_SIMD(sumsq, a*a + b*b)
+DEFINE_BINOP_FLOAT_SIMD(difsq, a*a - b*b)
+DEFINE_BINOP_FLOAT_SIMD(sqsum, sc_squared(a + b))
+DEFINE_BINOP_FLOAT_SIMD(sqdif, sc_squared(a - b))
 
-DEFINE_BINOP_FLOAT(thresh,   a <  b  ? 0. : a)
-DEFINE_BINOP_FLOAT(absthresh,  fabs(a) <  b  ? 0. : a)
-DEFINE_BINOP_FLOAT(amclip,   b <= 0. ? 0. : a * b)
-DEFINE_BINOP_FLOAT(scaleneg, a <  0. ? a * b : a)
+DEFINE_BINOP_FLOAT_SIMD(thresh,   a <  b  ? 0. : a)
+DEFINE_BINOP_FLOAT_SIMD(absthresh,  fabs(a) <  b  ? 0. : a)
+DEFINE_BINOP_FLOAT_SIMD(amclip,   b <= 0. ? 0. : a * b)
+DEFINE_BINOP_FLOAT_SIMD(scaleneg, a <  0. ? a * b : a)
 
-DEFINE_BINOP_FLOAT(ring1, a * b + a)
-DEFINE_BINOP_FLOAT(ring2, a * b + a + b)
-DEFINE_BINOP_FLOAT(ring3, a*a*b)
-DEFINE_BINOP_FLOAT(ring4, a*b*(a - b))
+DEFINE_BINOP_FLOAT_SIMD(ring1, a * b + a)
+DEFINE_BINOP_FLOAT_SIMD(ring2, a * b + a + b)
+DEFINE_BINOP_FLOAT_SIMD(ring3, a*a*b)
+DEFINE_BINOP_FLOAT_SIMD(ring4, a*b*(a - b))
 
 DEFINE_BINOP_INT(gcd, sc_gcd(a, b))
 DEFINE_BINOP_INT(lcm, sc_lcm(a, b))
 
-DEFINE_BINOP_FLOAT(clip2, std::clamp(a, -b, b))
-DEFINE_BINOP_FLOAT(wrap2, sc_wrap(a, -b, b))
-DEFINE_BINOP_FLOAT(fold2, sc_fold(a, -b, b))
+DEFINE_BINOP_FLOAT_SIMD(clip2, std::clamp(a, -b, b))
+DEFINE_BINOP_FLOAT_SIMD(wrap2, sc_wrap(a, -b, b))
+DEFINE_BINOP_FLOAT_SIMD(fold2, sc_fold(a, -b, b))
 DEFINE_BINOP_INT(iwrap2, sc_iwrap(a, -b, b))
 DEFINE_BINOP_INT(ifold2, sc_ifold(a, -b, b))
-DEFINE_BINOP_FLOAT(excess, a - std::clamp(a, -b, b))
+DEFINE_BINOP_FLOAT_SIMD(excess, a - std::clamp(a, -b, b))
 
-DEFINE_BINOP_FLOAT(clip0, std::clamp(a, 0., b))
-DEFINE_BINOP_FLOAT(wrap0, sc_wrap(a, 0., b))
-DEFINE_BINOP_FLOAT(fold0, sc_fold(a, 0., b))
+DEFINE_BINOP_FLOAT_SIMD(clip0, std::clamp<Z>(a, 0., b))
+DEFINE_BINOP_FLOAT_SIMD(wrap0, sc_wrap(a, 0., b))
+DEFINE_BINOP_FLOAT_SIMD(fold0, sc_fold(a, 0., b))
 
-DEFINE_BINOP_FLOAT(round, sc_round(a, b))
-DEFINE_BINOP_FLOAT(roundUp, sc_roundUp(a, b))
-DEFINE_BINOP_FLOAT(trunc, sc_trunc(a, b))
+DEFINE_BINOP_FLOAT_SIMD(round, sc_round(a, b))
+DEFINE_BINOP_FLOAT_SIMD(roundUp, sc_roundUp(a, b))
+DEFINE_BINOP_FLOAT_SIMD(trunc, sc_trunc(a, b))
 
 #define DEFN(FUNNAME, OPNAME, HELP) 	vm.def(OPNAME, 1, 1, FUNNAME##_, "(x --> z) " HELP);
 #define DEFNa(FUNNAME, OPNAME, HELP) 	DEFN(FUNNAME, #OPNAME, HELP)
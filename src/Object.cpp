@@ -19,8 +19,10 @@
 #include "clz.hpp"
 #include "MathOps.hpp"
 #include "Opcode.hpp"
+#include "SimdKernels.hpp"
 #include <algorithm>
 #include <cstdarg>
+#include <thread>
 
 void post(const char* fmt, ...)
 {
@@ -152,17 +154,21 @@ Form::Form(P<Table> const& inTable, P<Form> const& inNext)
 {
 }
 
-volatile int64_t gTreeNodeSerialNumber;
+std::atomic<int64_t> gTreeNodeSerialNumber;
+
+std::atomic<uint64_t> gWorkspaceVersion{1};
 
 GForm::GForm(P<GTable> const& inTable, P<GForm> const& inNext)
 	: Object(), mTable(inTable), mNextForm(inNext)
 {
+	++gWorkspaceVersion;
 }
 
 GForm::GForm(P<GForm> const& inNext)
 	: Object(), mNextForm(inNext)
 { 
 	mTable = new GTable();
+	++gWorkspaceVersion;
 }
 
 P<GForm> consForm(P<GTable> const& inTable, P<GForm> const& inNext) { return new GForm(inTable, inNext); }
@@ -235,7 +241,7 @@ void Fun::runREPL(Thread& th)
 	
 	th.fun = this;
 	
-	th.run(mDef->mCode->getOps());
+	th.run(mDef->mCode());
 }
 
 void Fun::run(Thread& th)
@@ -263,7 +269,7 @@ void Fun::run(Thread& th)
 
 	th.fun = this;
 	
-	th.run(mDef->mCode->getOps());
+	th.run(mDef->mCode());
 }
 
 void Fun::apply(Thread& th) 
@@ -301,11 +307,16 @@ void Fun::apply(Thread& th)
 }
 
 Fun::Fun(Thread& th, FunDef* def)
-	: mDef(def), mWorkspace(def->Workspace())
-{
-	if (NumVars()) {
-		mVars.insert(mVars.end(), th.stack.end() - NumVars(), th.stack.end());
-		th.stack.erase(th.stack.end() - NumVars(), th.stack.end());
+	: mDef(def), mVars(mInlineVars), mWorkspace(def->Workspace())
+{
+	size_t numVars = NumVars();
+	if (numVars) {
+		if (numVars > kInlineFunVars) mVars = new V[numVars];
+		V* vars = &*(th.stack.end() - numVars);
+		for (size_t i = 0; i < numVars; ++i) {
+			mVars[i] = std::move(vars[i]);
+		}
+		th.stack.erase(th.stack.end() - numVars, th.stack.end());
 	}
 }
 
@@ -318,6 +329,7 @@ FunDef::FunDef(Thread& th, P<Code> const& inCode, uint16_t inNumArgs, uint16_t i
 
 Fun::~Fun()
 {
+	if (mVars != mInlineVars) delete [] mVars;
 }
 
 void Prim::apply(Thread& th) 
@@ -393,6 +405,18 @@ bool GForm::get(Thread& th, Arg key, V& value) const
     return false;
 }
 
+TreeEntry* GForm::getEntry(Arg key) const
+{
+    const GForm* e = this;
+    do {
+        if (TreeEntry* entry = e->mTable->getEntry(key)) {
+            return entry;
+        }
+        e = (GForm*)e->mNextForm();
+    } while (e);
+    return nullptr;
+}
+
 GForm* GForm::putImpure(Arg key, Arg value)
 {
 	if (mTable->putImpure(key, value)) return this;
@@ -416,58 +440,74 @@ V GForm::mustGet(Thread& th, Arg key) const
 }
 
 
-GTable* GTable::putPure(Arg inKey, int64_t inKeyHash, Arg inValue)
+// symbols are unique, but strings made at run time may equal one without being it.
+static bool sameKey(Arg a, Arg b)
 {
-    auto tree = mTree.load();
-	if (tree) {
-		return new GTable(tree->putPure(inKey, inKeyHash, inValue));
-	} else {
-		int64_t serialNo = ++gTreeNodeSerialNumber;
-		return new GTable(new TreeNode(inKey, inKeyHash, inValue, serialNo, nullptr, nullptr));
+	if (a.Identical(b)) return true;
+	return a.isString() && b.isString() && strcmp(((String*)a.o())->cstr(), ((String*)b.o())->cstr()) == 0;
+}
+
+static int treeIndex(int32_t inHash, int inShift)
+{
+	return (int)(((uint32_t)inHash >> inShift) & kTreeMask);
+}
+
+static TreeEntry* putPureChain(TreeEntry* entry, Arg inKey, int32_t inKeyHash, Arg inValue)
+{
+	if (!entry) {
+		return new TreeEntry(inKey, inKeyHash, inValue, ++gTreeNodeSerialNumber, nullptr);
+	}
+	TreeEntry* next = entry->mNext.load(std::memory_order_acquire);
+	if (sameKey(inKey, entry->mKey)) {
+		return new TreeEntry(entry->mKey, inKeyHash, inValue, entry->mSerialNumber, next);
 	}
+	return new TreeEntry(entry->mKey, entry->mHash, entry->mValue, entry->mSerialNumber,
+						putPureChain(next, inKey, inKeyHash, inValue));
 }
 
-TreeNode* TreeNode::putPure(Arg inKey, int64_t inKeyHash, Arg inValue)
+// returns a new node for the subtree at inShift with the binding added, sharing everything else.
+static TreeNode* putPureTree(TreeNode* node, Arg inKey, int32_t inKeyHash, Arg inValue, int inShift)
 {
-	if (inKeyHash == mHash && inKey.Identical(mKey)) {
-		return new TreeNode(mKey, mHash, inValue, mSerialNumber, mLeft, mRight);
-	} 
-    auto left = mLeft.load();
-    auto right = mRight.load();
-    if (inKeyHash < mHash) {
-        if (left) {
-            return new TreeNode(mKey, mHash, mValue, mSerialNumber, left->putPure(inKey, inKeyHash, inValue), right);
-        } else {
-            int64_t serialNo = ++gTreeNodeSerialNumber;
-            return new TreeNode(mKey, mHash, mValue, mSerialNumber, new TreeNode(inKey, inKeyHash, inValue, serialNo, nullptr, nullptr), right);
-        }
-	} else {
-        if (right) {
-            return new TreeNode(mKey, mHash, mValue, mSerialNumber, left, right->putPure(inKey, inKeyHash, inValue));
-        } else {
-            int64_t serialNo = ++gTreeNodeSerialNumber;
-            return new TreeNode(mKey, mHash, mValue, mSerialNumber, left, new TreeNode(inKey, inKeyHash, inValue, serialNo, nullptr, nullptr));
-        }
+	if (!node) {
+		return new TreeEntry(inKey, inKeyHash, inValue, ++gTreeNodeSerialNumber, nullptr);
 	}
+	if (node->mIsBranch) {
+		TreeBranch* branch = new TreeBranch(*(TreeBranch*)node);
+		int i = treeIndex(inKeyHash, inShift);
+		branch->setSlot(i, putPureTree(branch->mSlots[i].load(), inKey, inKeyHash, inValue, inShift + kTreeBits));
+		return branch;
+	}
+	TreeEntry* entry = (TreeEntry*)node;
+	if (entry->mHash == inKeyHash) {
+		return putPureChain(entry, inKey, inKeyHash, inValue);
+	}
+	// split on the next bits of the hash.
+	TreeBranch* branch = new TreeBranch();
+	branch->setSlot(treeIndex(entry->mHash, inShift), entry);
+	int i = treeIndex(inKeyHash, inShift);
+	branch->setSlot(i, putPureTree(branch->mSlots[i].load(), inKey, inKeyHash, inValue, inShift + kTreeBits));
+	return branch;
 }
 
-static bool TreeNodeEquals(Thread& th, TreeNode* a, TreeNode* b)
+GTable* GTable::putPure(Arg inKey, int64_t inKeyHash, Arg inValue)
 {
-    while (1) {
-        if (!a) return !b;
-        if (!b) return false;
-        
-        if (!a->mKey.Equals(th, b->mKey)) return false;
-        if (!a->mValue.Equals(th, b->mValue)) return false;
-        if (a->mLeft == 0) {
-            if (b->mLeft != 0) return false;
-        } else {
-            if (b->mLeft == 0) return false;
-            if (!TreeNodeEquals(th, a->mLeft, b->mLeft)) return false;
-        }
-        a = a->mRight;
-        b = b->mRight;
-    }
+	++gWorkspaceVersion;
+	return new GTable(putPureTree(mTree.load(std::memory_order_acquire), inKey, (int32_t)inKeyHash, inValue, 0));
+}
+
+static void getAllEntries(TreeNode* node, std::vector<P<TreeEntry> >& vec)
+{
+	if (!node) return;
+	if (node->mIsBranch) {
+		TreeBranch* branch = (TreeBranch*)node;
+		for (int i = 0; i < kTreeWidth; ++i) {
+			getAllEntries(branch->mSlots[i].load(std::memory_order_acquire), vec);
+		}
+	} else {
+		for (TreeEntry* entry = (TreeEntry*)node; entry; entry = entry->mNext.load(std::memory_order_acquire)) {
+			vec.push_back(entry);
+		}
+	}
 }
 
 bool GTable::Equals(Thread& th, Arg v)
@@ -476,14 +516,24 @@ bool GTable::Equals(Thread& th, Arg v)
 	if (!v.isGTable()) return false;
 	if (this == v.o()) return true;
 	GTable* that = (GTable*)v.o();
-    return TreeNodeEquals(th, mTree.load(), that->mTree.load());
+	
+	std::vector<P<TreeEntry> > a, b;
+	getAllEntries(mTree.load(std::memory_order_acquire), a);
+	getAllEntries(that->mTree.load(std::memory_order_acquire), b);
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); ++i) {
+		V value;
+		if (!that->getInner(a[i]->mKey, value)) return false;
+		if (!a[i]->mValue.Equals(th, value)) return false;
+	}
+	return true;
 }
 
 void GTable::print(Thread& th, std::string& out, int depth)
 {
-	std::vector<P<TreeNode> > vec = sorted();
+	std::vector<P<TreeEntry> > vec = sorted();
 	for (size_t i = 0; i < vec.size(); ++i) {
-		P<TreeNode>& p = vec[i];
+		P<TreeEntry>& p = vec[i];
 		zprintf(out, "   ");
 		p->mValue.print(th, out);
 		zprintf(out, " :");
@@ -494,9 +544,9 @@ void GTable::print(Thread& th, std::string& out, int depth)
 
 void GTable::printSomethingIWant(Thread& th, std::string& out, int depth)
 {
-	std::vector<P<TreeNode> > vec = sorted();
+	std::vector<P<TreeEntry> > vec = sorted();
 	for (size_t i = 0; i < vec.size(); ++i) {
-		P<TreeNode>& p = vec[i];
+		P<TreeEntry>& p = vec[i];
 		if (p->mValue.leaves() != 0 && p->mValue.leaves() != 1) {
 			zprintf(out, "   ");
 			p->mKey.print(th, out);
@@ -509,38 +559,31 @@ void GTable::printSomethingIWant(Thread& th, std::string& out, int depth)
 
 bool GTable::get(Thread& th, Arg inKey, V& outValue) const
 {
-	int32_t inKeyHash = inKey.Hash();
-	TreeNode* tree = mTree.load();
-	while (1) {
-		if (tree == nullptr) return false;
-		int32_t treeKeyHash = tree->mKey.Hash();
-		if (inKeyHash == treeKeyHash) {
-			outValue = tree->mValue;
-			return true;
-		} else if (inKeyHash < treeKeyHash) {
-			tree = tree->mLeft.load();
-		} else {
-			tree = tree->mRight.load();
-		}
-	}
+	return getInner(inKey, outValue);
 }
 
 bool GTable::getInner(Arg inKey, V& outValue) const
+{
+	TreeEntry* entry = getEntry(inKey);
+	if (!entry) return false;
+	outValue = entry->mValue;
+	return true;
+}
+
+TreeEntry* GTable::getEntry(Arg inKey) const
 {
 	int32_t inKeyHash = inKey.Hash();
-	TreeNode* tree = mTree.load();
-	while (1) {
-		if (tree == nullptr) return false;
-		int32_t treeKeyHash = tree->mKey.Hash();
-		if (inKeyHash == treeKeyHash) {
-			outValue = tree->mValue;
-			return true;
-		} else if (inKeyHash < treeKeyHash) {
-			tree = tree->mLeft.load();
-		} else {
-			tree = tree->mRight.load();
-		}
+	TreeNode* node = mTree.load(std::memory_order_acquire);
+	int shift = 0;
+	while (node && node->mIsBranch) {
+		node = ((TreeBranch*)node)->mSlots[treeIndex(inKeyHash, shift)].load(std::memory_order_acquire);
+		shift += kTreeBits;
 	}
+	for (TreeEntry* entry = (TreeEntry*)node; entry; entry = entry->mNext.load(std::memory_order_acquire)) {
+		if (entry->mHash != inKeyHash) return nullptr;
+		if (sameKey(inKey, entry->mKey)) return entry;
+	}
+	return nullptr;
 }
 
 V GTable::mustGet(Thread& th, Arg inKey) const
@@ -551,60 +594,71 @@ V GTable::mustGet(Thread& th, Arg inKey) const
 	throw errNotFound;
 }
 
+// nodes reachable from a table are never removed or freed while it lives. a slot only ever
+// changes from null to a new entry, or from an entry to a new branch that holds that entry, so
+// readers need no locks.
 bool GTable::putImpure(Arg inKey, Arg inValue)
 {
 	int32_t inKeyHash = inKey.Hash();
-	volatile std::atomic<TreeNode*>* treeNodePtr = &mTree;
+	std::atomic<TreeNode*>* slot = &mTree;
+	int shift = 0;
+	P<TreeEntry> newEntry;
 	while (1) {
-		TreeNode* tree = treeNodePtr->load();
-		if (tree == nullptr) {
-            int64_t serialNo = ++gTreeNodeSerialNumber;
-			TreeNode* newNode = new TreeNode(inKey, inKeyHash, inValue, serialNo, nullptr, nullptr);
-			newNode->retain();
-            TreeNode* nullNode = nullptr;
-            if (treeNodePtr->compare_exchange_weak(nullNode, newNode)) {
-                break;
-            }
-            newNode->release();
+		TreeNode* node = slot->load(std::memory_order_acquire);
+		if (node == nullptr) {
+			if (!newEntry) newEntry = new TreeEntry(inKey, inKeyHash, inValue, ++gTreeNodeSerialNumber, nullptr);
+			newEntry->retain();
+			if (slot->compare_exchange_weak(node, newEntry(), std::memory_order_acq_rel)) {
+				++gWorkspaceVersion;
+				return true;
+			}
+			newEntry->release();
+		} else if (node->mIsBranch) {
+			slot = &((TreeBranch*)node)->mSlots[treeIndex(inKeyHash, shift)];
+			shift += kTreeBits;
+		} else if (((TreeEntry*)node)->mHash == inKeyHash) {
+			// append to the chain of entries with this hash.
+			TreeEntry* entry = (TreeEntry*)node;
+			while (1) {
+				if (sameKey(inKey, entry->mKey)) {
+					return false; // cannot rebind an existing value.
+				}
+				TreeEntry* next = entry->mNext.load(std::memory_order_acquire);
+				if (next) {
+					entry = next;
+					continue;
+				}
+				if (!newEntry) newEntry = new TreeEntry(inKey, inKeyHash, inValue, ++gTreeNodeSerialNumber, nullptr);
+				newEntry->retain();
+				if (entry->mNext.compare_exchange_weak(next, newEntry(), std::memory_order_acq_rel)) {
+					++gWorkspaceVersion;
+					return true;
+				}
+				newEntry->release();
+			}
 		} else {
-			int32_t treeKeyHash = tree->mKey.Hash();
-			if (treeKeyHash == inKeyHash) {
-				return false; // cannot rebind an existing value.
-			} else if (inKeyHash < treeKeyHash) {
-				treeNodePtr = &tree->mLeft;
+			// move the entry down into a branch, then try again from the branch.
+			TreeEntry* entry = (TreeEntry*)node;
+			TreeBranch* branch = new TreeBranch();
+			branch->setSlot(treeIndex(entry->mHash, shift), entry);
+			branch->retain();
+			if (slot->compare_exchange_weak(node, branch, std::memory_order_acq_rel)) {
+				// the branch now holds the slot's reference to the entry.
+				entry->release();
 			} else {
-				treeNodePtr = &tree->mRight;
+				branch->release();
 			}
 		}
 	}
-	return true;
 }
 
-
-void TreeNode::getAll(std::vector<P<TreeNode> >& vec)
+std::vector<P<TreeEntry> > GTable::sorted() const
 {
-	P<TreeNode> node = this;
-	do {
-		vec.push_back(node);
-        auto left = node->mLeft.load();
-		if (left) left->getAll(vec);
-		node = node->mRight.load();
-	} while (node());
-}
-
-static bool compareTreeNodes(P<TreeNode> const& a, P<TreeNode> const& b)
-{
-	return a->mSerialNumber < b->mSerialNumber;
-}
-
-std::vector<P<TreeNode> > GTable::sorted() const
-{
-	std::vector<P<TreeNode> > vec;
-    auto tree = mTree.load();
-	if (tree) {
-		tree->getAll(vec);
-		sort(vec.begin(), vec.end(), compareTreeNodes);
-	}
+	std::vector<P<TreeEntry> > vec;
+	getAllEntries(mTree.load(std::memory_order_acquire), vec);
+	sort(vec.begin(), vec.end(), [](P<TreeEntry> const& a, P<TreeEntry> const& b) {
+		return a->mSerialNumber < b->mSerialNumber;
+	});
 	return vec;
 }
 
@@ -616,7 +670,7 @@ V List::unaryOp(Thread& th, UnaryOp* op)
 	if (isVList())
 		return new List(new UnaryOpGen(th, op, this));
 	else
-		return new List(new UnaryOpZGen(th, op, this));
+		return new List(new FusedZGen(th, op, this));
 		
 }
 
@@ -1059,18 +1113,32 @@ void List::link(Thread& th, List* inList)
 	mGen = nullptr;
 }
 
-void List::force(Thread& th)
-{	
-	SpinLocker lock(mSpinLock);
-	if (mGen) {
-		P<Gen> gen = mGen; // keep the gen from being destroyed out from under pull().
-		if (gen->done()) {
-			gen->end();
-		} else {
-			gen->pull(th);
+void List::forceSlow(Thread& th)
+{
+	for (int spins = 0; ; ++spins) {
+		uint8_t state = mForceState.load(std::memory_order_acquire);
+		if (state == kForced) return;
+		if (state == kUnforced && mForceState.compare_exchange_weak(state, kForcing, std::memory_order_acquire))
+			break;
+		// another thread is forcing this list. forcing one block is brief, so spin a little before yielding.
+		if (spins >= 64) std::this_thread::yield();
+	}
+
+	try {
+		if (mGen) {
+			P<Gen> gen = mGen; // keep the gen from being destroyed out from under pull().
+			if (gen->done()) {
+				gen->end();
+			} else {
+				gen->pull(th);
+			}
+			// mGen should be NULL at this point because one of the following should have been called: fulfill, link, end.
 		}
-		// mGen should be NULL at this point because one of the following should have been called: fulfill, link, end.
+	} catch (...) {
+		mForceState.store(kUnforced, std::memory_order_release);
+		throw;
 	}
+	mForceState.store(mGen ? kUnforced : kForced, std::memory_order_release);
 }
 
 int64_t List::length(Thread& th)
@@ -1091,27 +1159,62 @@ int64_t List::length(Thread& th)
 	return sum;
 }
 
+Array::Array(P<Array> const& inParent, int64_t inOffset, int64_t inSize)
+	: mSize(inSize), mCap(inSize), p(0)
+{
+	elemType = inParent->elemType;
+	// views always refer to the array that owns the storage, so they never form chains.
+	mParent = inParent->isView() ? inParent->mParent : inParent;
+	p = (char*)inParent->p + inOffset * elemSize();
+}
+
 Array::~Array()
 {
+	if (mParent) return;
 	if (isV()) {
-		delete [] vv;
-	} else {
-		free(p);
+		for (int64_t i = 0; i < mCap; ++i)
+			vv[i].~V();
 	}
+	poolFree(p, mCap * elemSize());
 }
 
+// payloads come from the block pool so that the per-block arrays made by fulfill
+// are recycled rather than returned to malloc.
+// Z payloads are rounded up to whole kPoolAlignment lines, so they start aligned and a
+// SIMD kernel can run whole batches over any block that starts at the beginning of one.
 void Array::alloc(int64_t inCap)
 {
 	if (mCap >= inCap) return;
+	int64_t oldCap = mCap;
+	void* oldp = p;
 	mCap = inCap;
+	if (isZ()) {
+		const int64_t zPerLine = kPoolAlignment / sizeof(Z);
+		mCap = (inCap + zPerLine - 1) & ~(zPerLine - 1);
+	}
 	if (isV()) {
 		V* oldv = vv;
-		vv = new V[mCap];
-		for (int64_t i = 0; i < size(); ++i) 
-			vv[i] = oldv[i];
-		delete [] oldv;
+		vv = (V*)poolAlloc(mCap * sizeof(V));
+		for (int64_t i = 0; i < mCap; ++i)
+			new (vv + i) V();
+		if (mParent) {
+			for (int64_t i = 0; i < size(); ++i) 
+				vv[i] = oldv[i];
+		} else {
+			for (int64_t i = 0; i < size(); ++i) 
+				vv[i] = std::move(oldv[i]);
+			for (int64_t i = 0; i < oldCap; ++i)
+				oldv[i].~V();
+		}
 	} else {
-		p = realloc(p, mCap * elemSize());
+		p = poolAlloc(mCap * sizeof(Z));
+		if (mSize) memcpy(p, oldp, mSize * sizeof(Z));
+	}
+	if (mParent) {
+		// a view that grows copies its items and lets go of the parent's storage.
+		mParent = nullptr;
+	} else {
+		poolFree(oldp, oldCap * elemSize());
 	}
 }
 
@@ -1307,11 +1410,21 @@ bool VIn::operator()(Thread& th, int& ioNum, int& outStride, V*& outBuffer)
 	return true;
 }
 
+Z* ZIn::constantBuffer()
+{
+#if SAMPLE_IS_DOUBLE
+	return mConstant.fptr();
+#else
+	mZConstant = (Z)mConstant.asFloat();
+	return &mZConstant;
+#endif
+}
+
 bool ZIn::operator()(Thread& th, int& ioNum, int& outStride, Z*& outBuffer)
 {
 	if (mIsConstant) {
 		outStride = 0;
-		outBuffer = &mConstant.f;
+		outBuffer = constantBuffer();
 		return false;
 	}
 	if (mList) {
@@ -1334,7 +1447,7 @@ bool ZIn::operator()(Thread& th, int& ioNum, int& outStride, Z*& outBuffer)
 	}
 	mConstant = 0.;
 	outStride = 0;
-	outBuffer = &mConstant.f;
+	outBuffer = constantBuffer();
     ioNum = 0;
 	mDone = true;
 	return true;
@@ -1610,6 +1723,22 @@ bool ZIn::fill(Thread& th, int& ioNum, Z* outBuffer, int outStride)
 	return false;
 }
 
+#if SAMPLE_IS_DOUBLE
+static void copyToFloat(int n, const Z* a, int astride, float* out, int outStride)
+{
+#ifndef SAPF_ACCELERATE
+	if (astride == 1 && outStride == 1) {
+		simdKernels().toFloat(n, a, out);
+		return;
+	}
+#endif
+	for (int i = 0, j = 0, k = 0; i < n; ++i)	{
+		out[k] = a[j];
+		j += astride;
+		k += outStride;
+	}
+}
+
 bool ZIn::fill(Thread& th, int& ioNum, float* outBuffer, int outStride)
 {
 	int framesToFill = ioNum;
@@ -1626,11 +1755,7 @@ bool ZIn::fill(Thread& th, int& ioNum, float* outBuffer, int outStride)
 			ioNum = framesFilled;
 			return true;
 		}
-		for (int i = 0, j = 0, k = 0; i < n; ++i)	{
-			outBuffer[k] = a[j];
-			j += astride;
-			k += outStride;
-		}
+		copyToFloat(n, a, astride, outBuffer, outStride);
 		framesToFill -= n;
 		framesFilled += n;
 		advance(n);
@@ -1639,6 +1764,7 @@ bool ZIn::fill(Thread& th, int& ioNum, float* outBuffer, int outStride)
 	ioNum = framesFilled;
 	return false;
 }
+#endif
 
 void ZIn::hop(Thread& th, int framesToAdvance)
 {
@@ -1664,6 +1790,15 @@ void ZIn::hop(Thread& th, int framesToAdvance)
 	}
 }
 
+P<Array> ZIn::segmentView(Thread& th, int inNum)
+{
+	if (mIsConstant || !mList || inNum <= 0) return nullptr;
+	mList->force(th);
+	Array* a = mList->mArray();
+	if (mOffset + inNum > a->size()) return nullptr;
+	return new Array(mList->mArray, mOffset, inNum);
+}
+
 bool ZIn::fillSegment(Thread& th, int inNum, Z* outBuffer)
 {
 	int framesToFill = inNum;
@@ -1884,14 +2019,14 @@ bool List::Equals(Thread& th, Arg v)
 }
 
 List::List(int inItemType) // construct nil
-	: mNext(nullptr), mGen(nullptr), mArray(new Array(inItemType, 0))
+	: mNext(nullptr), mForceState(kForced), mGen(nullptr), mArray(new Array(inItemType, 0))
 {
 	elemType = inItemType;
 	setFinite(true);
 }
 
 List::List(int inItemType, int64_t inCap) // construct nil
-	: mNext(nullptr), mGen(nullptr), mArray(new Array(inItemType, inCap))
+	: mNext(nullptr), mForceState(kForced), mGen(nullptr), mArray(new Array(inItemType, inCap))
 {
 	elemType = inItemType;
 	setFinite(true);
@@ -1900,7 +2035,7 @@ List::List(int inItemType, int64_t inCap) // construct nil
 
 
 List::List(P<Gen> const& inGen) 
-	: mNext(nullptr), mGen(inGen), mArray(0)
+	: mNext(nullptr), mForceState(kUnforced), mGen(inGen), mArray(0)
 {
 	elemType = inGen->elemType;
 	setFinite(inGen->isFinite());
@@ -1908,14 +2043,14 @@ List::List(P<Gen> const& inGen)
 }
 
 List::List(P<Array> const& inArray) 
-	: mNext(nullptr), mGen(nullptr), mArray(inArray)
+	: mNext(nullptr), mForceState(kForced), mGen(nullptr), mArray(inArray)
 {
 	elemType = inArray->elemType;
 	setFinite(true);
 }
 
 List::List(P<Array> const& inArray, P<List> const& inNext) 
-	: mNext(inNext), mGen(0), mArray(inArray)
+	: mNext(inNext), mForceState(kForced), mGen(0), mArray(inArray)
 {
 	assert(!mNext || mArray->elemType == mNext->elemType);
 	elemType = inArray->elemType;
@@ -2109,8 +2244,10 @@ V Fun::msgSend(Thread& th, Arg receiver)
 	}
 }
 	
+static std::atomic<uint64_t> gTableMapSerialNumber{0};
+
 TableMap::TableMap(size_t inSize)
-	: mSize(inSize)
+	: mId(++gTableMapSerialNumber), mSize(inSize)
 {
 	if (inSize == 0) {
 		mMask = 0;
@@ -2125,7 +2262,7 @@ TableMap::TableMap(size_t inSize)
 }
 
 TableMap::TableMap(Arg inKey)
-	: mSize(1)
+	: mId(++gTableMapSerialNumber), mSize(1)
 {
 	mMask = 1;
 	mIndices = new size_t[2]();
@@ -46,9 +46,151 @@ const char* opcode_name[kNumOpcodes] =
 	"opNewForm",
 	"opInherit",
 	"opEach",
-	"opReturn"
+	"opReturn",
+	
+	"opPushImmCallImm",
+	"opPushLocalCallImm",
+	"opPushLocalPushLocal",
+	"opBindLocalBindLocal"
 };
 
+static std::atomic<bool> gInlineCaching{true};
+
+void setInlineCaching(bool inEnabled)
+{
+	gInlineCaching = inEnabled;
+}
+
+bool inlineCaching()
+{
+	return gInlineCaching.load(std::memory_order_relaxed);
+}
+
+// the value bound to key in the current function's workspace. the cache is keyed on the
+// workspace form and the workspace version, so any new binding or form invalidates it.
+static V workspaceVar(Thread& th, Arg key, InlineCache& cache)
+{
+	GForm* workspace = th.fun->Workspace()();
+	if (!inlineCaching()) return workspace->mustGet(th, key);
+	
+	// read the version before looking, so a binding made during the lookup invalidates it.
+	uint64_t version = gWorkspaceVersion.load(std::memory_order_acquire);
+	uint64_t target;
+	if (cache.lookup(version, (uint64_t)workspace, target)) {
+		return ((TreeEntry*)target)->mValue;
+	}
+	TreeEntry* entry = workspace->getEntry(key);
+	if (!entry) {
+		post("not found: ");
+		throw errNotFound;
+	}
+	cache.store(version, (uint64_t)workspace, (uint64_t)entry);
+	return entry->mValue;
+}
+
+// forms made from the same literal share a TableMap, so the index of a key found in the form's
+// own table is cached by map. keys inherited from a parent form take the slow path.
+static bool dot(Thread& th, Arg key, InlineCache& cache, V receiver, V& ioValue)
+{
+	if (!receiver.isForm() || !inlineCaching()) return receiver.dot(th, key, ioValue);
+	
+	Form* form = (Form*)receiver.o();
+	Table* table = form->mTable();
+	TableMap* map = table->mMap();
+	uint64_t index;
+	if (!cache.lookup(map->mId, 0, index)) {
+		size_t i;
+		if (!map->getIndex(key, key.Hash(), i)) return receiver.dot(th, key, ioValue);
+		cache.store(map->mId, 0, i);
+		index = i;
+	}
+	ioValue = table->mValues[index].msgSend(th, receiver);
+	return true;
+}
+
+static void bindWorkspaceVar(Thread& th, Arg key, Arg value)
+{
+	if (value.isList() && !value.isFinite()) {
+		post("WARNING: binding a possibly infinite list at the top level can leak unbounded memory!\n");
+	} else if (value.isFun()) {
+		const char* mask = value.GetAutoMapMask();
+		const char* help = value.OneLineHelp();
+		if (mask || help) {
+			char* name = ((String*)key.o())->s;
+			vm.addUdfHelp(name, mask, help);
+		}
+	}
+	th.fun->Workspace() = th.fun->Workspace()->putImpure(key, value); // workspace mutation
+	th.mWorkspace = th.mWorkspace->putImpure(key, value); // workspace mutation
+}
+
+static V nextFromList(Thread& th, BothIn& in)
+{
+	V value;
+	if (in.one(th, value)) {
+		post("not enough items in list for = [..]\n");
+		throw errFailed;
+	}
+	return value;
+}
+
+static void newList(Thread& th, Code* code, P<Prim> const& maker)
+{
+	V x;
+	{
+		SaveStack ss(th);
+		th.run(code);
+		size_t len = th.stackDepth();
+		maker->apply_n(th, len);
+		x = th.pop();
+	}
+	th.push(x);
+}
+
+static void inherit(Thread& th, Code* code)
+{
+	V result;
+	{
+		SaveStack ss(th);
+		th.run(code);
+		size_t depth = th.stackDepth();
+		if (depth < 1) {
+			result = vm._ee;
+		} else if (depth > 1) {
+			fprintf(stderr, "more arguments than keys for form.\n");
+			throw errFailed;
+		} else {
+			vm.inherit->apply_n(th, 1);
+			result = th.pop();
+		}
+	}
+	th.push(result);
+}
+
+static void newForm(Thread& th, Code* code)
+{
+	V result;
+	{
+		SaveStack ss(th);
+		th.run(code);
+		size_t depth = th.stackDepth();
+		TableMap* tmap = (TableMap*)th.top().o();
+		size_t numArgs = tmap->mSize;
+		if (depth == numArgs+1) {
+			// no inheritance, must insert zero for parent.
+			th.tuck(numArgs+1, V(0.));
+		} else if (depth < numArgs+1) {
+			fprintf(stderr, "fewer arguments than keys for form.\n");
+			throw errStackUnderflow;
+		} else if (depth > numArgs+2) {
+			fprintf(stderr, "more arguments than keys for form.\n");
+			throw errFailed;
+		}
+		vm.newForm->apply_n(th, numArgs+2);
+		result = th.pop();
+	}
+	th.push(result);
+}
 
 static void printOpcode(Thread& th, Opcode* c)
 {
@@ -94,7 +236,49 @@ static void printOpcode(Thread& th, Opcode* c)
 	post("\n");
 }
 
-void Thread::run(Opcode* opc)
+static void printInstr(Thread& th, Code* code, Instr* ip)
+{
+	post("%s ", opcode_name[ip->op]);
+	switch (ip->op) {
+		case opPushImmediate :
+		case opPushWorkspaceVar :
+		case opPushFun : 
+		case opCallImmediate :
+		case opCallWorkspaceVar :
+		case opDot :
+		case opComma :
+		case opInherit :
+		case opNewForm :
+		case opBindWorkspaceVar :
+		case opBindWorkspaceVarFromList :
+		case opParens :
+		case opNewVList : 
+		case opNewZList : 
+			code->consts[ip->a].printShort(th);
+			break;
+		case opPushImmCallImm :
+			code->consts[ip->a].printShort(th);
+			post(" ");
+			code->consts[ip->b].printShort(th);
+			break;
+		case opPushLocalCallImm :
+			post("%u ", ip->a);
+			code->consts[ip->b].printShort(th);
+			break;
+		case opPushLocalPushLocal :
+		case opBindLocalBindLocal :
+			post("%u %u", ip->a, ip->b);
+			break;
+		case opEach :
+			post("%x", ip->a);
+			break;
+		default :
+			post("%u", ip->a);
+	}
+}
+
+// the reference interpreter, over the readable opcodes. used when tracing.
+void Thread::runTraced(Opcode* opc)
 {
 	Thread& th = *this;
 	try {
@@ -102,10 +286,8 @@ void Thread::run(Opcode* opc)
 
 			V& v = opc->v;
 
-			if (vm.traceon) {
-				post("stack : "); th.printStack(); post("\n");
-				printOpcode(th, opc);
-			}
+			post("stack : "); th.printStack(); post("\n");
+			printOpcode(th, opc);
 
 			switch (opc->op) {
 				case opNone :
@@ -161,124 +343,39 @@ void Thread::run(Opcode* opc)
 				case opBindLocal :
 					getLocal(v.i) = pop();
 					break;
-				case opBindWorkspaceVar : {
-                    V value = pop();
-                    if (value.isList() && !value.isFinite()) {
-                        post("WARNING: binding a possibly infinite list at the top level can leak unbounded memory!\n");
-                    } else if (value.isFun()) {
-						const char* mask = value.GetAutoMapMask();
-						const char* help = value.OneLineHelp();
-						if (mask || help) {
-							char* name = ((String*)v.o())->s;
-							vm.addUdfHelp(name, mask, help);
-						}
-					}
-					fun->Workspace() = fun->Workspace()->putImpure(v, value); // workspace mutation
-					th.mWorkspace = th.mWorkspace->putImpure(v, value); // workspace mutation
-                } break;
+				case opBindWorkspaceVar :
+					bindWorkspaceVar(th, v, pop());
+					break;
                 
 				case opBindLocalFromList :
 				case opBindWorkspaceVarFromList :
 				{
 					V list = pop();
 					BothIn in(list);
-					while (1) {
-						if (opc->op == opNone) {
-							break;
+					for (; opc->op != opNone; ++opc) {
+						if (opc->op == opBindLocalFromList) {
+							getLocal(opc->v.i) = nextFromList(th, in);
 						} else {
-							V value;
-							if (in.one(th, value)) {
-								post("not enough items in list for = [..]\n");
-								throw errFailed;
-							}
-							if (opc->op == opBindLocalFromList) {
-								getLocal(opc->v.i) = value;
-							} else if (opc->op == opBindWorkspaceVarFromList) {
-								v = opc->v;
-								if (value.isList() && !value.isFinite()) {
-									post("WARNING: binding a possibly infinite list at the top level can leak unbounded memory!\n");
-								} else if (value.isFun()) {
-									const char* mask = value.GetAutoMapMask();
-									const char* help = value.OneLineHelp();
-									if (mask || help) {
-										char* name = ((String*)v.o())->s;
-										vm.addUdfHelp(name, mask, help);
-									}
-								}
-								fun->Workspace() = fun->Workspace()->putImpure(v, value); // workspace mutation
-								th.mWorkspace = th.mWorkspace->putImpure(v, value); // workspace mutation
-							}
+							bindWorkspaceVar(th, opc->v, nextFromList(th, in));
 						}
-						++opc;
 					}
 				} break;
 				case opParens : {
 						ParenStack ss(th);
-						run(((Code*)v.o())->getOps());
-					} break;
-				case opNewVList : {
-						V x;
-						{
-							SaveStack ss(th);
-							run(((Code*)v.o())->getOps());
-							size_t len = stackDepth();
-							vm.newVList->apply_n(th, len);
-							x = th.pop();
-						}
-						th.push(x);
-					} break;
-				case opNewZList : {
-						V x;
-						{
-							SaveStack ss(th);
-							run(((Code*)v.o())->getOps());
-							size_t len = stackDepth();
-							vm.newZList->apply_n(th, len);
-							x = th.pop();
-						}
-						th.push(x);
-					} break;
-				case opInherit : {
-						V result;
-						{
-							SaveStack ss(th);
-							run(((Code*)v.o())->getOps());
-							size_t depth = stackDepth();
-							if (depth < 1) {
-								result = vm._ee;
-							} else if (depth > 1) {
-								fprintf(stderr, "more arguments than keys for form.\n");
-								throw errFailed;
-							} else {
-								vm.inherit->apply_n(th, 1);
-								result = th.pop();
-							}
-						}
-						th.push(result);
-					} break;
-				case opNewForm : {
-						V result;
-						{
-							SaveStack ss(th);
-							run(((Code*)v.o())->getOps());
-							size_t depth = stackDepth();
-							TableMap* tmap = (TableMap*)th.top().o();
-							size_t numArgs = tmap->mSize;
-							if (depth == numArgs+1) {
-								// no inheritance, must insert zero for parent.
-								th.tuck(numArgs+1, V(0.));
-							} else if (depth < numArgs+1) {
-								fprintf(stderr, "fewer arguments than keys for form.\n");
-								throw errStackUnderflow;
-							} else if (depth > numArgs+2) {
-								fprintf(stderr, "more arguments than keys for form.\n");
-								throw errFailed;
-							}
-							vm.newForm->apply_n(th, numArgs+2);
-							result = th.pop();
-						}
-						th.push(result);
+						run((Code*)v.o());
 					} break;
+				case opNewVList :
+					newList(th, (Code*)v.o(), vm.newVList);
+					break;
+				case opNewZList :
+					newList(th, (Code*)v.o(), vm.newZList);
+					break;
+				case opInherit :
+					inherit(th, (Code*)v.o());
+					break;
+				case opNewForm :
+					newForm(th, (Code*)v.o());
+					break;
 				case opEach :
 					push(new EachOp(pop(), (int)v.i));
 					break;
@@ -298,11 +395,286 @@ void Thread::run(Opcode* opc)
 	}
 }
 
+// dispatch through a table of label addresses where the compiler allows it, so that every
+// instruction ends in its own indirect jump. otherwise use a switch.
+#if defined(__GNUC__) && !defined(SAPF_NO_COMPUTED_GOTO)
+#define SAPF_COMPUTED_GOTO 1
+#endif
+
+void Thread::run(Code* code)
+{
+	if (vm.traceon) {
+		runTraced(code->getOps());
+		return;
+	}
+
+	Thread& th = *this;
+	Instr* ip = code->getInstrs();
+	V* consts = code->consts.data();
+	InlineCache* caches = code->caches.get();
+
+#if SAPF_COMPUTED_GOTO
+	static void* const labels[] = {
+		&&L_BAD_OPCODE,
+		&&L_opNone,
+		&&L_opPushImmediate,
+		&&L_opPushLocalVar,
+		&&L_opPushFunVar,
+		&&L_opPushWorkspaceVar,
+		&&L_opPushFun,
+		&&L_opCallImmediate,
+		&&L_opCallLocalVar,
+		&&L_opCallFunVar,
+		&&L_opCallWorkspaceVar,
+		&&L_opDot,
+		&&L_opComma,
+		&&L_opBindLocal,
+		&&L_opBindLocalFromList,
+		&&L_opBindWorkspaceVar,
+		&&L_opBindWorkspaceVarFromList,
+		&&L_opParens,
+		&&L_opNewVList,
+		&&L_opNewZList,
+		&&L_opNewForm,
+		&&L_opInherit,
+		&&L_opEach,
+		&&L_opReturn,
+		&&L_opPushImmCallImm,
+		&&L_opPushLocalCallImm,
+		&&L_opPushLocalPushLocal,
+		&&L_opBindLocalBindLocal,
+	};
+	static_assert(sizeof(labels) / sizeof(labels[0]) == kNumOpcodes, "one label per opcode, in order");
+	#define CASE(name) L_##name
+	#define DISPATCH() goto *labels[ip->op]
+	#define NEXT() do { ++ip; DISPATCH(); } while (0)
+#else
+	#define CASE(name) case name
+	#define DISPATCH() goto dispatch
+	#define NEXT() do { ++ip; goto dispatch; } while (0)
+#endif
+
+	try {
+#if SAPF_COMPUTED_GOTO
+		DISPATCH();
+#else
+	dispatch:
+		switch (ip->op) {
+#endif
+		CASE(opNone) :
+			NEXT();
+			
+		CASE(opPushImmediate) :
+			push(consts[ip->a]);
+			NEXT();
+			
+		CASE(opPushLocalVar) :
+			push(getLocal(ip->a));
+			NEXT();
+			
+		CASE(opPushFunVar) :
+			push(fun->mVars[ip->a]);
+			NEXT();
+			
+		CASE(opPushWorkspaceVar) :
+			push(workspaceVar(th, consts[ip->a], caches[ip->a]));
+			NEXT();
+			
+		CASE(opPushFun) :
+			push(new Fun(th, (FunDef*)consts[ip->a].o()));
+			NEXT();
+			
+		CASE(opCallImmediate) :
+			consts[ip->a].apply(th);
+			NEXT();
+			
+		CASE(opCallLocalVar) :
+			getLocal(ip->a).apply(th);
+			NEXT();
+			
+		CASE(opCallFunVar) :
+			fun->mVars[ip->a].apply(th);
+			NEXT();
+			
+		CASE(opCallWorkspaceVar) :
+			workspaceVar(th, consts[ip->a], caches[ip->a]).apply(th);
+			NEXT();
+
+		CASE(opDot) : {
+			V ioValue;
+			if (!dot(th, consts[ip->a], caches[ip->a], pop(), ioValue))
+				notFound(consts[ip->a]);
+			push(ioValue);
+			NEXT();
+		}
+		CASE(opComma) :
+			push(pop().comma(th, consts[ip->a]));
+			NEXT();
+			
+		CASE(opBindLocal) :
+			getLocal(ip->a) = pop();
+			NEXT();
+			
+		CASE(opBindWorkspaceVar) :
+			bindWorkspaceVar(th, consts[ip->a], pop());
+			NEXT();
+			
+		CASE(opBindLocalFromList) :
+		CASE(opBindWorkspaceVarFromList) : {
+			V list = pop();
+			BothIn in(list);
+			for (; ip->op != opNone; ++ip) {
+				if (ip->op == opBindLocalFromList) {
+					getLocal(ip->a) = nextFromList(th, in);
+				} else {
+					bindWorkspaceVar(th, consts[ip->a], nextFromList(th, in));
+				}
+			}
+			NEXT();
+		}
+		CASE(opParens) : {
+			ParenStack ss(th);
+			run((Code*)consts[ip->a].o());
+			NEXT();
+		}
+		CASE(opNewVList) :
+			newList(th, (Code*)consts[ip->a].o(), vm.newVList);
+			NEXT();
+			
+		CASE(opNewZList) :
+			newList(th, (Code*)consts[ip->a].o(), vm.newZList);
+			NEXT();
+			
+		CASE(opNewForm) :
+			newForm(th, (Code*)consts[ip->a].o());
+			NEXT();
+			
+		CASE(opInherit) :
+			inherit(th, (Code*)consts[ip->a].o());
+			NEXT();
+			
+		CASE(opEach) :
+			push(new EachOp(pop(), (int)ip->a));
+			NEXT();
+		
+		CASE(opReturn) :
+			return;
+			
+		CASE(opPushImmCallImm) :
+			push(consts[ip->a]);
+			consts[ip->b].apply(th);
+			NEXT();
+			
+		CASE(opPushLocalCallImm) :
+			push(getLocal(ip->a));
+			consts[ip->b].apply(th);
+			NEXT();
+			
+		CASE(opPushLocalPushLocal) :
+			push(getLocal(ip->a));
+			push(getLocal(ip->b));
+			NEXT();
+			
+		CASE(opBindLocalBindLocal) :
+			getLocal(ip->a) = pop();
+			getLocal(ip->b) = pop();
+			NEXT();
+			
+#if SAPF_COMPUTED_GOTO
+		L_BAD_OPCODE :
+#else
+		default :
+#endif
+			post("BAD OPCODE\n");
+			throw errInternalError;
+#if !SAPF_COMPUTED_GOTO
+		}
+#endif
+	} catch (...) {
+		post("backtrace: ");
+		printInstr(th, code, ip);
+		post("\n");
+		throw;
+	}
+	
+	#undef CASE
+	#undef DISPATCH
+	#undef NEXT
+}
+
 Code::~Code() { }
 
 void Code::shrinkToFit()
 {
 	std::vector<Opcode>(ops.begin(), ops.end()).swap(ops);
+	compact();
+}
+
+// operands that are values go in consts. ops that look up a name also get the InlineCache with
+// the same index.
+static bool hasConstOperand(int op)
+{
+	switch (op) {
+		case opPushImmediate :
+		case opPushWorkspaceVar :
+		case opPushFun :
+		case opCallImmediate :
+		case opCallWorkspaceVar :
+		case opDot :
+		case opComma :
+		case opBindWorkspaceVar :
+		case opBindWorkspaceVarFromList :
+		case opParens :
+		case opNewVList :
+		case opNewZList :
+		case opNewForm :
+		case opInherit :
+			return true;
+		default :
+			return false;
+	}
+}
+
+void Code::compact()
+{
+	instrs.clear();
+	consts.clear();
+	instrs.reserve(ops.size());
+	for (Opcode& c : ops) {
+		if (hasConstOperand(c.op)) {
+			instrs.push_back(Instr{(uint16_t)c.op, 0, (uint32_t)consts.size()});
+			consts.push_back(c.v);
+		} else {
+			instrs.push_back(Instr{(uint16_t)c.op, 0, (uint32_t)c.v.i});
+		}
+	}
+	caches.reset(new InlineCache[consts.size()]);
+	
+	// fuse the common pairs the parser emits into superinstructions. there are no jumps into the
+	// middle of code, so any adjacent pair can be fused. the sequences of ops that bind from a
+	// list are never fused since they are walked to their opNone.
+	size_t j = 0;
+	for (size_t i = 0; i < instrs.size(); ++i) {
+		Instr in = instrs[i];
+		if (i + 1 < instrs.size()) {
+			Instr next = instrs[i+1];
+			int fused = BAD_OPCODE;
+			if (next.a <= UINT16_MAX) {
+				if (in.op == opPushImmediate && next.op == opCallImmediate) fused = opPushImmCallImm;
+				else if (in.op == opPushLocalVar && next.op == opCallImmediate) fused = opPushLocalCallImm;
+				else if (in.op == opPushLocalVar && next.op == opPushLocalVar) fused = opPushLocalPushLocal;
+				else if (in.op == opBindLocal && next.op == opBindLocal) fused = opBindLocalBindLocal;
+			}
+			if (fused != BAD_OPCODE) {
+				in.op = (uint16_t)fused;
+				in.b = (uint16_t)next.a;
+				++i;
+			}
+		}
+		instrs[j++] = in;
+	}
+	instrs.resize(j);
+	instrs.shrink_to_fit();
 }
 
 void Code::add(int _op, Arg v)
@@ -31,6 +31,7 @@
 #include <Accelerate/Accelerate.h>
 #else
 #include "ZArr.hpp"
+#include "SimdKernels.hpp"
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -82,7 +83,7 @@ static void normalize(int n, Z* buf)
 {
 	Z maxabs = 0.;
 	for (int i = 0; i < n; ++i) {
-		maxabs = std::max(maxabs, fabs(buf[i]));
+		maxabs = std::max<Z>(maxabs, fabs(buf[i]));
 	}
 	if (maxabs > 0.) {
 		Z scale = 1. / maxabs;
@@ -132,7 +133,7 @@ static void fillWaveTable(int n, Z* amps, int ampStride, Z* phases, int phaseStr
 #else
 	ZArr real_zarr = zarr(real, kWaveTableSize2, 1);
 	ZArr imag_zarr = zarr(imag, kWaveTableSize2, 1);
-	Eigen::ArrayXd mag = real_zarr;
+	ZArrType mag = real_zarr;
 	real_zarr = mag * imag_zarr.cos();
 	imag_zarr = mag * imag_zarr.sin();
 #endif // SAPF_ACCELERATE
@@ -172,6 +173,7 @@ static void wavefill_(Thread& th, Prim* prim)
 	P<List> ampl;
 	P<List> phasel;
 	Z *phasez, *ampz;
+	Z phase, amp;
 	int phaseStride, ampStride; 
 	int64_t n = kMaxHarmonics;
 	if (phases.isZList()) {
@@ -179,7 +181,8 @@ static void wavefill_(Thread& th, Prim* prim)
 		phasez = phasel->mArray->z();
 		phaseStride = 1;
 	} else {
-		phasez = &phases.f;
+		phase = phases.f;
+		phasez = &phase;
 		phaseStride = 0;
 	}
 	
@@ -188,7 +191,8 @@ static void wavefill_(Thread& th, Prim* prim)
 		ampz = ampl->mArray->z();
 		ampStride = 1;
 	} else {
-		ampz = &amps.f;
+		amp = amps.f;
+		ampz = &amp;
 		ampStride = 0;
 	}
 	
@@ -615,7 +619,7 @@ struct VarSaw : public ThreeInputUGen<VarSaw>
 			int index1 = (int)iphase1;
 			Z fracphase1 = pphase1 - iphase1;
 			
-			Z zduty = std::clamp(*duty, .01, .99);
+			Z zduty = std::clamp<Z>(*duty, .01, .99);
 			Z pphase2 = pphase1 + zduty * kWaveTableSizeF;
 			Z iphase2 = floor(pphase2);
 			int index2 = (int)iphase2;
@@ -1187,8 +1191,7 @@ void SinOsc::calc(int n, Z *out, Z *freq, int freqStride)
 #if SAPF_ACCELERATE
 	vvsin(out, out, &n);
 #else
-	ZArr A = zarr(out, n, 1);
-	A = A.sin();
+	simdKernels().sin(n, out, 1, out);
 #endif
 }
 
@@ -1338,8 +1341,7 @@ void SinOscPM::calc(int n, Z *out, Z *freq, Z *phasemod, int freqStride, int pha
 #if SAPF_ACCELERATE
 	vvsin(out, out, &n);
 #else
-	ZArr A = zarr(out, n, 1);
-	A = A.sin();
+	simdKernels().sin(n, out, 1, out);
 #endif
 }
 
@@ -1595,7 +1597,7 @@ struct DSF3 : public FourInputUGen<DSF3>
 
 			//f(x)=x-x*sqrt(c^2+1)/sqrt(c^2*x^2+1)
 
-			Z a = std::clamp(*coef, -.9999, .9999);
+			Z a = std::clamp<Z>(*coef, -.9999, .9999);
 			Z a2 = a*a;
 			Z an1 = pow(a, N1);
 			Z scalePeak = (a - 1.)/(2.*an1 - a - 1.);
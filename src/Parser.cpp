@@ -478,7 +478,12 @@ static bool parseLambda(Thread& th, P<Code>& code)
 
     FunDef* def = new FunDef(th, code2, args.size(), cs->mLocals.size(), cs->mVars.size(), help);
 	def->mArgNames = args;
-	code->add(opPushFun, def);
+	if (cs->mVars.empty()) {
+		// nothing is captured, so every evaluation would make the same Fun. make it once.
+		code->add(opPushImmediate, V(new Fun(th, def)));
+	} else {
+		code->add(opPushFun, def);
+	}
 
 	return true;
 }
@@ -23,13 +23,54 @@
 #include <RtAudio.h>
 #endif
 #include <pthread.h>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <mutex>
 #include <thread>
 
 #include "AsyncAudioFileWriter.hpp"
+#include "BlockSchedule.hpp"
+#include "RenderAhead.hpp"
 #include "SoundFiles.hpp"
 #include "Buffers.hpp"
 
+// timing of a player's audio callbacks, for tuning the buffer size. written by the callback only.
+struct CallbackStats
+{
+	std::atomic<int64_t> count{0};
+	std::atomic<int64_t> totalNanos{0};
+	std::atomic<int64_t> maxNanos{0};
+	std::atomic<int64_t> budgetNanos{0};
+	std::atomic<int64_t> overBudget{0};
+
+	void add(std::chrono::steady_clock::time_point start, unsigned int numFrames)
+	{
+		auto nanos = (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		auto budget = (int64_t)(1e9 * numFrames * vm.ar.invSampleRate);
+		count.fetch_add(1, std::memory_order_relaxed);
+		totalNanos.fetch_add(nanos, std::memory_order_relaxed);
+		if (nanos > maxNanos.load(std::memory_order_relaxed)) maxNanos.store(nanos, std::memory_order_relaxed);
+		budgetNanos.store(budget, std::memory_order_relaxed);
+		if (nanos > budget) overBudget.fetch_add(1, std::memory_order_relaxed);
+	}
+};
+
+std::mutex gPlayConfigMutex;
+PlayConfig gPlayConfig;
+
+PlayConfig playConfig()
+{
+	std::lock_guard lock{gPlayConfigMutex};
+	return gPlayConfig;
+}
+
+void setPlayConfig(const PlayConfig& config)
+{
+	std::lock_guard lock{gPlayConfigMutex};
+	gPlayConfig = config;
+}
+
 #if defined(SAPF_AUDIOTOOLBOX)
 static OSStatus inputCallback(
 	void *inRefCon,
@@ -85,34 +126,50 @@ public:
 			exit(0);
 		}
 
-		// TODO: below will enumerate devices.
-		// It defaults to ASIO. And it's going to play through the "first channel" which may
-		// not be the user's default audio device.
-		// We could enhance this by getting it to default to a (slower) windows API, and also
-		// giving the ability to somehow pick the driver + device (and maybe "remembering" the settings)
-		// auto deviceIds = this->audio.getDeviceIds();
-		// for (auto & element : deviceIds) {
-		// 	auto deviceInfo = this->audio.getDeviceInfo(element);
-		// 	printf("%s id: %d outputs: %d \n", deviceInfo.name.c_str(), element, deviceInfo.outputChannels);
-		// }
-
+		const PlayConfig config = playConfig();
 
 		RtAudio::StreamParameters parameters;
-		parameters.deviceId = this->audio.getDefaultOutputDevice();
+		parameters.deviceId = findOutputDevice(this->audio, config.device);
 		parameters.nChannels = this->numChannels;
 		parameters.firstChannel = 0;
 		unsigned int sampleRate = vm.ar.sampleRate;
-		unsigned int bufferFrames = 256; // 256 sample frames
+		unsigned int bufferFrames = std::max(config.bufferFrames, 1);
 		RtAudio::StreamOptions options;
-		options.flags = RTAUDIO_NONINTERLEAVED /* | RTAUDIO_MINIMIZE_LATENCY | RTAUDIO_SCHEDULE_REALTIME */;
- 
+		options.flags = RTAUDIO_NONINTERLEAVED | RTAUDIO_MINIMIZE_LATENCY;
+		if (config.priority > 0) {
+			options.flags |= RTAUDIO_SCHEDULE_REALTIME;
+			options.priority = config.priority;
+		}
+
+		this->cpu = config.cpu;
+#if !defined(__linux__)
+		if (this->cpu >= 0) {
+			post("pinning the audio thread to a cpu is not supported on this platform. ignored.\n");
+			this->cpu = -1;
+		}
+#endif
+
 		this->audio.openStream(&parameters, NULL, RTAUDIO_FLOAT32, sampleRate, &bufferFrames, &rtPlayerBackendCallback, this->player, &options);
 		this->audio.startStream();
 
-		post("start output unit OK\n");
+		post("start output unit OK. '%s', %u frames per buffer\n",
+			this->audio.getDeviceInfo(parameters.deviceId).name.c_str(), bufferFrames);
  
 		return 0;
 	}
+
+	// called from the audio callback thread, on the first callback.
+	void pinCallbackThread() {
+#if defined(__linux__)
+		if (this->cpu >= 0) {
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			CPU_SET(this->cpu, &cpus);
+			pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+		}
+#endif
+		this->pinned = true;
+	}
 	
 	void stop() {
 		if(this->audio.isStreamRunning()) {
@@ -124,8 +181,46 @@ public:
 		}		
 	}
 	
+	static std::vector<unsigned int> deviceIds(RtAudio& audio) {
+#if defined(RTAUDIO_VERSION_MAJOR) && RTAUDIO_VERSION_MAJOR >= 6
+		return audio.getDeviceIds();
+#else
+		std::vector<unsigned int> ids;
+		for (unsigned int i = 0; i < audio.getDeviceCount(); ++i) ids.push_back(i);
+		return ids;
+#endif
+	}
+
+	// device may be an id, or a name or part of one.
+	static unsigned int findOutputDevice(RtAudio& audio, const std::string& device) {
+		if (device.empty()) return audio.getDefaultOutputDevice();
+
+		char* end;
+		unsigned long number = strtoul(device.c_str(), &end, 10);
+		bool isNumber = *end == 0;
+		for (unsigned int id : deviceIds(audio)) {
+			RtAudio::DeviceInfo info = audio.getDeviceInfo(id);
+			if (info.outputChannels == 0) continue;
+			if (isNumber ? id == number : info.name.find(device) != std::string::npos) return id;
+		}
+		post("audio device '%s' not found. using the default output device.\n", device.c_str());
+		return audio.getDefaultOutputDevice();
+	}
+
+	static void postDevices() {
+		RtAudio audio;
+		unsigned int defaultId = audio.getDefaultOutputDevice();
+		for (unsigned int id : deviceIds(audio)) {
+			RtAudio::DeviceInfo info = audio.getDeviceInfo(id);
+			if (info.outputChannels == 0) continue;
+			post("%3u  %s  %u outputs%s\n", id, info.name.c_str(), info.outputChannels, id == defaultId ? "  (default)" : "");
+		}
+	}
+
 	void *player;
 	int numChannels;
+	int cpu = -1;
+	bool pinned = false;
 	RtAudio audio;
 };
 
@@ -134,6 +229,14 @@ typedef RtPlayerBackend PlayerBackend;
 
 const int kMaxChannels = 32;
 
+#ifndef SAPF_AUDIOTOOLBOX
+// frames per block rendered ahead of the audio callback.
+const int kRenderAheadBlockFrames = 256;
+#endif
+
+// number of blocks to render ahead of the audio callback. 0 renders inside the callback.
+std::atomic<int> gRenderAheadBlocks = 0;
+
 struct Player {
 	Player(const Thread& inThread, int numChannels, std::unique_ptr<SoundFile> soundFile);
 	// create without an output file
@@ -154,7 +257,11 @@ struct Player {
 	ZIn in[kMaxChannels];
 	// ExtAudioFileRef xaf = nullptr;
 	std::unique_ptr<SoundFile> soundFile;
-
+	std::unique_ptr<BlockSchedule> schedule;
+#ifndef SAPF_AUDIOTOOLBOX
+	std::unique_ptr<RenderAhead> renderAhead;
+#endif
+	CallbackStats callbackStats;
 };
 
 #if defined(SAPF_AUDIOTOOLBOX)
@@ -285,11 +392,31 @@ int Player::numChannels() {
 }
 
 int32_t Player::createGraph() {
+	if (blockScheduling()) {
+		this->schedule = std::make_unique<BlockSchedule>(this->in, numChannels());
+	}
+#ifndef SAPF_AUDIOTOOLBOX
+	int numBlocks = gRenderAheadBlocks.load();
+	if (numBlocks > 0) {
+		this->renderAhead = std::make_unique<RenderAhead>(numChannels(), kRenderAheadBlockFrames, numBlocks,
+			[this](RtBuffers& buffers, int inNumFrames) { return fillBufferList(this, inNumFrames, &buffers); });
+		this->renderAhead->start();
+	}
+#endif
 	return this->backend.createGraph();
 }
 
 void Player::stop() {
 	this->backend.stop();
+#ifndef SAPF_AUDIOTOOLBOX
+	if (this->renderAhead) {
+		this->renderAhead->stop();
+		if (this->renderAhead->underruns()) {
+			post("play ahead: %lld underruns, %lld frames of silence\n",
+				(long long)this->renderAhead->underruns(), (long long)this->renderAhead->underrunFrames());
+		}
+	}
+#endif
 }
 
 pthread_mutex_t gPlayerMutex = PTHREAD_MUTEX_INITIALIZER;
@@ -305,6 +432,7 @@ static OSStatus inputCallback(	void *							inRefCon,
 	                              AudioBufferList *				ioData)
 {
 	
+	auto start = std::chrono::steady_clock::now();
 	Player* player = (Player*)inRefCon;
 	Buffers buffers(ioData);
 		
@@ -314,6 +442,7 @@ static OSStatus inputCallback(	void *							inRefCon,
 	if (done) {
 		player->done = true;
 	}
+	player->callbackStats.add(start, inNumberFrames);
 	return noErr;
 }
 #else
@@ -329,19 +458,30 @@ int rtPlayerBackendCallback(
 	RtAudioStreamStatus status,
 	void *userData
 ) {
+	auto start = std::chrono::steady_clock::now();
 	Player *player = (Player *) userData;
 	RtBuffers buffers((float *) outputBuffer, player->numChannels(), nBufferFrames);
+
+	if (!player->backend.pinned) {
+		player->backend.pinCallbackThread();
+	}
  
 	if(status) {
 		std::cout << "Stream underflow detected!" << std::endl;
 	}
 
-	bool done = fillBufferList(player, nBufferFrames, &buffers);
+	bool done;
+	if (player->renderAhead) {
+		done = player->renderAhead->read(buffers, nBufferFrames);
+	} else {
+		done = fillBufferList(player, nBufferFrames, &buffers);
+	}
 	recordPlayer(*player, nBufferFrames, buffers);
 
 	if (done) {
 		player->done = true;
 	}
+	player->callbackStats.add(start, nBufferFrames);
 	return 0;
 }
 #endif
@@ -381,6 +521,62 @@ void stopPlayingIfDone()
 #endif // SAPF_AUDIOTOOLBOX
 }
 
+void setPlayAhead(int numBlocks)
+{
+#ifdef SAPF_AUDIOTOOLBOX
+	post("play ahead is not supported with AudioToolbox. ignored.\n");
+#else
+	gRenderAheadBlocks = std::clamp(numBlocks, 0, kMaxRenderAheadBlocks);
+#endif
+}
+
+int playAhead()
+{
+	return gRenderAheadBlocks.load();
+}
+
+void postPlayStats()
+{
+	Locker lock(&gPlayerMutex);
+
+	int i = 0;
+	for (Player* player = gAllPlayers; player; player = player->next, ++i) {
+		post("player %d: %d channels%s\n", i, player->numChannels(), player->done ? ", done" : "");
+		if (player->schedule) {
+			post("  block schedule of %d generators, %d with unknown inputs\n",
+				player->schedule->numNodes(), player->schedule->numOpaqueNodes());
+		}
+#ifndef SAPF_AUDIOTOOLBOX
+		RenderAhead* ra = player->renderAhead.get();
+		if (ra) {
+			post("  play ahead %d blocks of %d frames\n", ra->numBlocks(), ra->blockFrames());
+			post("  blocks rendered %lld\n", (long long)ra->blocksRendered());
+			post("  underruns %lld, %lld frames of silence\n", (long long)ra->underruns(), (long long)ra->underrunFrames());
+		}
+#endif
+		CallbackStats& cs = player->callbackStats;
+		int64_t count = cs.count.load(std::memory_order_relaxed);
+		if (count) {
+			double mean = 1e-3 * cs.totalNanos.load(std::memory_order_relaxed) / count;
+			double max = 1e-3 * cs.maxNanos.load(std::memory_order_relaxed);
+			double budget = 1e-3 * cs.budgetNanos.load(std::memory_order_relaxed);
+			post("  callbacks %lld, mean %.1f us, max %.1f us, budget %.1f us\n", (long long)count, mean, max, budget);
+			post("  mean %.1f %% of budget, max %.1f %%, %lld over budget\n", 100. * mean / budget, 100. * max / budget,
+				(long long)cs.overBudget.load(std::memory_order_relaxed));
+		}
+	}
+	if (i == 0) post("no players.\n");
+}
+
+void postAudioDevices()
+{
+#ifdef SAPF_AUDIOTOOLBOX
+	post("audio device selection is not supported with AudioToolbox.\n");
+#else
+	RtPlayerBackend::postDevices();
+#endif
+}
+
 static bool fillBufferList(Player *player, int inNumberFrames, Buffers *buffers)
 {
 	if (player->done) {
@@ -392,39 +588,42 @@ static bool fillBufferList(Player *player, int inNumberFrames, Buffers *buffers)
 	}
 	ZIn* in = player->in;
 	bool done = true;
-	for (int i = 0; i < (int)buffers->count(); ++i) {
-		int n = inNumberFrames;
-		if (i >= player->numChannels()) {
-			memset(buffers->data(i), 0, buffers->size(i));
-		} else {
-			try {
+	try {
+		if (player->schedule) {
+			player->schedule->prepare(player->th, inNumberFrames);
+		}
+		for (int i = 0; i < (int)buffers->count(); ++i) {
+			int n = inNumberFrames;
+			if (i >= player->numChannels()) {
+				memset(buffers->data(i), 0, buffers->size(i));
+			} else {
 				float* buf = buffers->data(i);
 				bool imdone = in[i].fill(player->th, n, buf, 1);
 				if (n < inNumberFrames) {
 					memset(buffers->data(i) + n, 0, (inNumberFrames - n) * sizeof(float));
 				}
 				done = done && imdone;
-			} catch (int err) {
-				if (err <= -1000 && err > -1000 - kNumErrors) {
-					post("\nerror: %s\n", errString[-1000 - err]);
-				} else {
-					post("\nerror: %d\n", err);
-				}
-				post("exception in real time. stopping player.\n");
-				done = true;
-				goto zeroAll;
-			} catch (std::bad_alloc& xerr) {
-				post("\nnot enough memory\n");
-				post("exception in real time. stopping player.\n");
-				done = true;
-				goto zeroAll;
-			} catch (...) {
-				post("\nunknown error\n");
-				post("exception in real time. stopping player.\n");
-				done = true;
-				goto zeroAll;
 			}
 		}
+	} catch (int err) {
+		if (err <= -1000 && err > -1000 - kNumErrors) {
+			post("\nerror: %s\n", errString[-1000 - err]);
+		} else {
+			post("\nerror: %d\n", err);
+		}
+		post("exception in real time. stopping player.\n");
+		done = true;
+		goto zeroAll;
+	} catch (std::bad_alloc& xerr) {
+		post("\nnot enough memory\n");
+		post("exception in real time. stopping player.\n");
+		done = true;
+		goto zeroAll;
+	} catch (...) {
+		post("\nunknown error\n");
+		post("exception in real time. stopping player.\n");
+		done = true;
+		goto zeroAll;
 	}
 	
 	return done;
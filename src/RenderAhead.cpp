@@ -0,0 +1,121 @@
+#ifndef SAPF_AUDIOTOOLBOX
+#include "RenderAhead.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+RenderAhead::RenderAhead(const int numChannels, const int blockFrames, const int numBlocks, RenderFunc render)
+    : mNumChannels{numChannels}, mBlockFrames{blockFrames},
+      mNumBlocks{std::clamp(numBlocks, 1, kMaxRenderAheadBlocks)}, mRender{std::move(render)},
+      mSlotData(static_cast<size_t>(mNumBlocks) * numChannels * blockFrames, 0.f),
+      mSlotFrames(mNumBlocks, 0) {
+    for (uint32_t slot = 0; slot < static_cast<uint32_t>(mNumBlocks); ++slot) {
+        mFree.insert(slot);
+    }
+}
+
+RenderAhead::~RenderAhead() {
+    stop();
+}
+
+void RenderAhead::start() {
+    mRunning = true;
+    mWorkerThread = std::thread(&RenderAhead::renderLoop, this);
+
+    // prime the lookahead so the first callbacks don't underrun.
+    using namespace std::chrono_literals;
+    while (mReady.readAvailable() < static_cast<size_t>(mNumBlocks) && !mRenderDone.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(1ms);
+    }
+}
+
+void RenderAhead::stop() {
+    {
+        std::lock_guard lock{mWorkerMutex};
+        mRunning = false;
+    }
+    mSlotFreedCondition.notify_one();
+    if (mWorkerThread.joinable()) {
+        mWorkerThread.join();
+    }
+}
+
+void RenderAhead::renderLoop() {
+    // used only to bound the wait if a notification from the callback is missed.
+    const auto wakeupTimeout = std::chrono::milliseconds{5};
+    while (mRunning.load(std::memory_order_relaxed)) {
+        uint32_t slot;
+        if (!mFree.remove(slot)) {
+            std::unique_lock lock{mWorkerMutex};
+            mSlotFreedCondition.wait_for(lock, wakeupTimeout, [this] {
+                return !mRunning.load(std::memory_order_relaxed) || !mFree.isEmpty();
+            });
+            continue;
+        }
+
+        RtBuffers buffers(slotData(slot), static_cast<uint32_t>(mNumChannels), static_cast<uint32_t>(mBlockFrames));
+        const bool done = mRender(buffers, mBlockFrames);
+        mSlotFrames[slot] = mBlockFrames;
+        mReady.insert(slot);
+        mBlocksRendered.fetch_add(1, std::memory_order_relaxed);
+
+        if (done) {
+            mRenderDone.store(true, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+bool RenderAhead::read(const RtBuffers& buffers, const unsigned int nBufferFrames) {
+    const int numFrames = static_cast<int>(nBufferFrames);
+    const int numBuffers = static_cast<int>(buffers.count());
+    int framesDone = 0;
+    bool freedSlot = false;
+
+    while (framesDone < numFrames) {
+        if (mCurrentSlot < 0) {
+            uint32_t slot;
+            if (!mReady.remove(slot)) break;
+            mCurrentSlot = slot;
+            mCurrentOffset = 0;
+        }
+
+        const uint32_t slot = static_cast<uint32_t>(mCurrentSlot);
+        const int n = std::min(mSlotFrames[slot] - mCurrentOffset, numFrames - framesDone);
+        const float* in = slotData(slot) + mCurrentOffset;
+        for (int i = 0; i < numBuffers; ++i) {
+            float* out = buffers.data(i) + framesDone;
+            if (i < mNumChannels) {
+                std::memcpy(out, in + static_cast<size_t>(i) * mBlockFrames, n * sizeof(float));
+            } else {
+                std::memset(out, 0, n * sizeof(float));
+            }
+        }
+        framesDone += n;
+        mCurrentOffset += n;
+
+        if (mCurrentOffset == mSlotFrames[slot]) {
+            mFree.insert(slot);
+            mCurrentSlot = -1;
+            freedSlot = true;
+        }
+    }
+
+    if (freedSlot) {
+        mSlotFreedCondition.notify_one();
+    }
+
+    if (framesDone < numFrames) {
+        for (int i = 0; i < numBuffers; ++i) {
+            std::memset(buffers.data(i) + framesDone, 0, (numFrames - framesDone) * sizeof(float));
+        }
+        if (mRenderDone.load(std::memory_order_acquire) && mReady.isEmpty()) {
+            return true;
+        }
+        mUnderruns.fetch_add(1, std::memory_order_relaxed);
+        mUnderrunFrames.fetch_add(numFrames - framesDone, std::memory_order_relaxed);
+    }
+    return false;
+}
+
+#endif // SAPF_AUDIOTOOLBOX
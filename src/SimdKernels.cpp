@@ -0,0 +1,43 @@
+#ifndef SAPF_ACCELERATE
+#include "SimdKernelsImpl.hpp"
+#include "Object.hpp"
+#include <cstdlib>
+#include <cstring>
+
+// the kernels for whatever this unit is compiled for. The only ones on platforms without
+// separately built architectures, and the last resort on those with them.
+static const SimdKernels* defaultSimdKernels() {
+    static const SimdKernels kernels = makeSimdKernels<xsimd::default_arch>(xsimd::default_arch::name());
+    return &kernels;
+}
+
+std::vector<const SimdKernels*> availableSimdKernels() {
+    std::vector<const SimdKernels*> kernels;
+#if SAPF_SIMD_DISPATCH_X86
+    const auto cpu = xsimd::available_architectures();
+    if (cpu.avx512f) kernels.push_back(simdKernelsAvx512());
+    if (cpu.avx2 && cpu.fma3_avx2) kernels.push_back(simdKernelsAvx2());
+    if (cpu.sse4_2) kernels.push_back(simdKernelsSse4_2());
+    kernels.push_back(simdKernelsSse2());
+#endif
+    kernels.push_back(defaultSimdKernels());
+    return kernels;
+}
+
+static const SimdKernels* chooseSimdKernels() {
+    const std::vector<const SimdKernels*> kernels = availableSimdKernels();
+    if (const char* name = getenv("SAPF_SIMD")) {
+        for (const SimdKernels* k : kernels) {
+            if (strcmp(k->name, name) == 0) return k;
+        }
+        post("SAPF_SIMD: no %s kernels for this cpu, using %s\n", name, kernels.front()->name);
+    }
+    return kernels.front();
+}
+
+const SimdKernels& simdKernels() {
+    static const SimdKernels* const kernels = chooseSimdKernels();
+    return *kernels;
+}
+
+#endif // SAPF_ACCELERATE
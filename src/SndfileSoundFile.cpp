@@ -2,22 +2,73 @@
 #include "SndfileSoundFile.hpp"
 
 #include "SoundFiles.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <thread>
 
 using Resampler = r8b::CDSPResampler;
 using namespace std;
 
-// de-interleave audio data from interleaved format to channel buffers
-void SndfileSoundFile::deInterleaveAudio(const double* const interleavedData, double* const channelBuffer, const int numFrames, const int numChannels, const int channelIndex) {
-    for (sf_count_t frame = 0; frame < numFrames; ++frame) {
-        channelBuffer[frame] = interleavedData[frame * numChannels + channelIndex];
-    }
+namespace {
+	// input frames per resampler run. large chunks amortize the per call overhead of the
+	// resamplers and keep each worker busy long enough to be worth waking.
+	constexpr int kResampleChunkFrames{16384};
+
+	// de-interleaves numFrames frames of N channels. with N known at compile time the strided
+	// loads vectorize.
+	template <int N>
+	void deInterleave(const double *interleaved, std::vector<std::vector<double>> &channels, const int numFrames) {
+		for (int ch = 0; ch < N; ++ch) {
+			double *out = channels[ch].data();
+			const double *in = interleaved + ch;
+			for (int frame = 0; frame < numFrames; ++frame) {
+				out[frame] = in[frame * N];
+			}
+		}
+	}
+
+	void deInterleave(const double *interleaved, std::vector<std::vector<double>> &channels, const int numFrames,
+		const int numChannels) {
+		for (int ch = 0; ch < numChannels; ++ch) {
+			double *out = channels[ch].data();
+			for (int frame = 0; frame < numFrames; ++frame) {
+				out[frame] = interleaved[frame * numChannels + ch];
+			}
+		}
+	}
+
+	// returns the path the resampled audio of path at sampleRate is cached at, or an empty string
+	// if caching is disabled or the file can't be identified.
+	std::string resampleCachePath(const char *path, const double sampleRate) {
+		const char *cacheDir = getenv("SAPF_RESAMPLE_CACHE");
+		if (!cacheDir || strlen(cacheDir) == 0) return {};
+
+		std::error_code ec;
+		const auto absolutePath = std::filesystem::absolute(path, ec);
+		if (ec) return {};
+		const auto size = std::filesystem::file_size(absolutePath, ec);
+		if (ec) return {};
+		const auto modified = std::filesystem::last_write_time(absolutePath, ec);
+		if (ec) return {};
+
+		const std::string key = absolutePath.string() + "|" + std::to_string(size) + "|"
+			+ std::to_string(modified.time_since_epoch().count());
+		char name[64];
+		snprintf(name, sizeof(name), "%016llx-%d.wav",
+			static_cast<unsigned long long>(std::hash<std::string>{}(key)), static_cast<int>(sampleRate));
+		return (std::filesystem::path(cacheDir) / name).string();
+	}
 }
-    
+
 // read frames from file into interleaved buffer
 int SndfileSoundFile::readFramesFromFile(SNDFILE* const sndfile, double* const interleavedBuffer, const int framesToRead) {
 	return static_cast<int>(sf_readf_double(sndfile, interleavedBuffer, framesToRead));
 }
 
+int SndfileSoundFile::readFramesFromFile(SNDFILE* const sndfile, float* const interleavedBuffer, const int framesToRead) {
+	return static_cast<int>(sf_readf_float(sndfile, interleavedBuffer, framesToRead));
+}
+
 std::vector<std::unique_ptr<r8b::CDSPResampler>> SndfileSoundFile::initResamplers(const int numChannels, const double fileSampleRate, const double threadSampleRate, const int resamplerInputBufLen) {
 	std::vector<std::unique_ptr<r8b::CDSPResampler>> resamplers;
 	if (std::abs(fileSampleRate - threadSampleRate) > 1e-9) {
@@ -42,57 +93,32 @@ SndfileSoundFile::SndfileSoundFile(std::string path, std::unique_ptr<AsyncAudioF
 	const double inThreadSampleRate, const int maxBufLen) :
 	mPath{path}, mWriter{std::move(writer)},
 	mSndfile{inSndfile}, mNumChannels{inNumChannels},
-	mDestToSrcSampleRateRatio(inThreadSampleRate / inFileSampleRate), mResamplerInputBufLen(maxBufLen / mDestToSrcSampleRateRatio),
+	mDestToSrcSampleRateRatio(inThreadSampleRate / inFileSampleRate),
+	mResamplerInputBufLen(std::max(kResampleChunkFrames, static_cast<int>(maxBufLen / mDestToSrcSampleRateRatio))),
 	mFileFramesRead{0}, mTotalFramesOutput{0}, mExpectedTotalFramesOutput{0}, mAtEndOfFile{false},
 	mResamplers(initResamplers(inNumChannels, inFileSampleRate, inThreadSampleRate, mResamplerInputBufLen)),
 	mResamplerInputs(initResamplerInputs(inNumChannels, inFileSampleRate, inThreadSampleRate, mResamplerInputBufLen)) {
-	
-	mResampleSamplesBeforeOutput = mResamplers.empty() ? 0 : mResamplers[0]->getInLenBeforeOutPos(0);
+	if (!mResamplers.empty()) {
+		mResampled.resize(inNumChannels);
+	}
 }
 	
 SndfileSoundFile::~SndfileSoundFile() {
 	if (this->mSndfile) {
 		sf_close(this->mSndfile);
 	}
+	if (mCacheFile) {
+		// the file wasn't read to the end, so the cache would be incomplete.
+		sf_close(mCacheFile);
+		std::error_code ec;
+		std::filesystem::remove(mCachePath + ".part", ec);
+	}
 }
 
 uint32_t SndfileSoundFile::numChannels() const {
 	return this->mNumChannels;
 }
 
-/*
- * Reads data from the input file until hitting the end of the file
- * or the resamplers are going to produce output on their next call.
- * This accounts for the lookahead of the resampler.
- */
-void SndfileSoundFile::readUntilResamplerOutput(double* const interleaved) {
-	int framesReadFromFile{0};
-	while (mResampleSamplesBeforeOutput > 0) {
-		const auto framesToRead = min(mResamplerInputBufLen, mResampleSamplesBeforeOutput);
-		framesReadFromFile = readFramesFromFile(
-			this->mSndfile, 
-			interleaved,
-			framesToRead
-		);
-		mFileFramesRead += framesReadFromFile;
-
-		if (framesReadFromFile < framesToRead) {
-			endOfInputFile();
-		}
-		if (framesReadFromFile == 0) return;
-		
-		// De-interleave and feed in each channel to the resampler
-		for (int ch = 0; ch < this->mNumChannels; ++ch) {
-			auto resamplerInputBuf = mResamplerInputs[ch].data();
-			deInterleaveAudio(interleaved, resamplerInputBuf, framesReadFromFile, this->mNumChannels, ch);
-			double *resamplerOutput;
-			mResamplers[ch]->process(resamplerInputBuf, framesReadFromFile, resamplerOutput);
-		}
-            
-		mResampleSamplesBeforeOutput -= framesReadFromFile;
-	}		
-}
-
 // update necessary state when we have finished reading everything from the input file.
 void SndfileSoundFile::endOfInputFile() {
 	mAtEndOfFile = true;
@@ -102,8 +128,8 @@ void SndfileSoundFile::endOfInputFile() {
 // direct read without resampling and de-interleave
 void SndfileSoundFile::pullWithoutResampling(uint32_t *framesRead, PortableBuffers &buffers,
                                              const int requestedOutputFrames) const {
-	buffers.interleaved.resize(requestedOutputFrames * this->mNumChannels * sizeof(double));
-	const auto interleaved = (double *) buffers.interleaved.data();
+	buffers.interleaved.resize(requestedOutputFrames * this->mNumChannels * sizeof(Z));
+	const auto interleaved = (Z *) buffers.interleaved.data();
         
 	const auto framesReallyRead = readFramesFromFile(this->mSndfile, interleaved, requestedOutputFrames);
 
@@ -111,89 +137,163 @@ void SndfileSoundFile::pullWithoutResampling(uint32_t *framesRead, PortableBuffe
             
 	// De-interleave each channel
 	for (int ch = 0; ch < this->mNumChannels; ++ch) {
-		auto *buf = (double *) buffers.buffers[ch].data;
-		deInterleaveAudio(interleaved, buf, framesReallyRead, this->mNumChannels, ch);
+		auto *buf = (Z *) buffers.buffers[ch].data;
+		for (int frame = 0; frame < framesReallyRead; ++frame) {
+			buf[frame] = interleaved[frame * this->mNumChannels + ch];
+		}
 	}
 }
 
-// read some data from the input file if there still is some, until we hit the end of the file
-// or we've filled the output buffer.
-// Returns number of frames emitted.
-uint32_t SndfileSoundFile::readAndResample(PortableBuffers &buffers, const int requestedOutputFrames, double * const interleaved) {
-	const int inputFramesToRead = static_cast<int>(requestedOutputFrames / mDestToSrcSampleRateRatio);
-	const int fileFramesRead = readFramesFromFile(this->mSndfile, interleaved, inputFramesToRead);
-	mFileFramesRead += fileFramesRead;
-    		
-	if (fileFramesRead < inputFramesToRead) {
-		endOfInputFile();
+void SndfileSoundFile::deInterleaveChunk(const int numFrames) {
+	const double *interleaved = mInterleaved.data();
+	switch (mNumChannels) {
+		case 1: memcpy(mResamplerInputs[0].data(), interleaved, numFrames * sizeof(double)); break;
+		case 2: deInterleave<2>(interleaved, mResamplerInputs, numFrames); break;
+		case 4: deInterleave<4>(interleaved, mResamplerInputs, numFrames); break;
+		case 6: deInterleave<6>(interleaved, mResamplerInputs, numFrames); break;
+		case 8: deInterleave<8>(interleaved, mResamplerInputs, numFrames); break;
+		default: deInterleave(interleaved, mResamplerInputs, numFrames, mNumChannels); break;
 	}
-	if (fileFramesRead > 0) {
-		int outputSamples = 0;
-		for (int ch = 0; ch < this->mNumChannels; ++ch) {
-			auto resamplerInputBuf = mResamplerInputs[ch].data();
-			deInterleaveAudio(interleaved, resamplerInputBuf, fileFramesRead, this->mNumChannels, ch);
-			double *resamplerOutput;
-			outputSamples = mResamplers[ch]->process(resamplerInputBuf, fileFramesRead, resamplerOutput);
-
-			// Copy from resampler output buffer to final output buffer.
-			// Note because the resampler uses its own internal buffer to hold its output, we cannot
-			// emit the resampler output DIRECTLY to the target - hence the need for copying.
-			if (outputSamples > 0) {
-				memcpy(buffers.buffers[ch].data, resamplerOutput, outputSamples * sizeof(double));
-			}
+}
+
+int SndfileSoundFile::readInputChunk() {
+	uint32_t framesRead = mResamplerInputBufLen;
+	if (mMapped) {
+		// decode straight from the mapping into the resampler inputs.
+		PortableBuffers inputs(mNumChannels);
+		for (int ch = 0; ch < mNumChannels; ++ch) {
+			inputs.setData(ch, mResamplerInputs[ch].data());
 		}
-		mTotalFramesOutput += outputSamples;
-		return outputSamples;
+		mMapped->pullDouble(&framesRead, inputs);
+	} else {
+		mInterleaved.resize(static_cast<size_t>(mResamplerInputBufLen) * mNumChannels);
+		framesRead = readFramesFromFile(mSndfile, mInterleaved.data(), mResamplerInputBufLen);
+		deInterleaveChunk(static_cast<int>(framesRead));
 	}
-	return 0;
+	return static_cast<int>(framesRead);
 }
 
-// if we're at the end of the file but we haven't yet output the "tail" of the resampler
-// output caused by lookahead,
-// feed 0s to the resampler until we fill the buffer or we reach the end of expected output. This
-// is needed to consume the "tail" of the resampler (since it uses lookahead)
-// Returns number of samples output.
-uint32_t SndfileSoundFile::resampleTail(uint32_t framesAlreadyOutput, PortableBuffers &buffers, const int requestedOutputFrames) {
-	const int framesToOutput = min(static_cast<int>(mExpectedTotalFramesOutput - mTotalFramesOutput),
-	                               requestedOutputFrames - static_cast<int>(framesAlreadyOutput));
-	const int framesToInput = static_cast<int>(static_cast<double>(framesToOutput) / mDestToSrcSampleRateRatio);
-
-	int outputSamples{0};
-	for (int ch = 0; ch < this->mNumChannels; ++ch) {
-		auto resamplerInputBuf = mResamplerInputs[ch].data();
-		memset(resamplerInputBuf, 0, framesToInput * sizeof(double));
+// runs every channel's resampler over the first inputFrames frames of mResamplerInputs, on
+// several threads when there are several channels, appending the output to mResampled.
+void SndfileSoundFile::resampleChannels(const int inputFrames, std::vector<int> &outputFrames) {
+	auto resampleChannel = [&](const int ch) {
 		double *resamplerOutput;
-		outputSamples = mResamplers[ch]->process(resamplerInputBuf, framesToInput, resamplerOutput);
+		const int n = mResamplers[ch]->process(mResamplerInputs[ch].data(), inputFrames, resamplerOutput);
+		auto &resampled = mResampled[ch];
+		if (resampled.size() < static_cast<size_t>(mResampledEnd + n)) {
+			resampled.resize(mResampledEnd + n);
+		}
+		memcpy(resampled.data() + mResampledEnd, resamplerOutput, n * sizeof(double));
+		outputFrames[ch] = n;
+	};
+
+	const int numThreads = std::max(1, std::min(static_cast<int>(std::thread::hardware_concurrency()), mNumChannels));
+	if (numThreads == 1) {
+		for (int ch = 0; ch < mNumChannels; ++ch) {
+			resampleChannel(ch);
+		}
+		return;
+	}
 
-		if (outputSamples > 0) {
-			// it's + *framesRead because in the event we hit the end of the file this iteration,
-			// we may not have filled the buffer but we may have read some samples already, so we
-			// we need to preserve what we already read and append to those values.
-			memcpy(static_cast<double *>(buffers.buffers[ch].data) + framesAlreadyOutput, resamplerOutput, outputSamples * sizeof(double));
+	// the resamplers and output buffers are per channel, so the threads share nothing.
+	auto resampleChannels = [&](const int first) {
+		for (int ch = first; ch < mNumChannels; ch += numThreads) {
+			resampleChannel(ch);
 		}
+	};
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; ++i) {
+		threads.emplace_back(resampleChannels, i);
+	}
+	resampleChannels(0);
+	for (auto &thread : threads) {
+		thread.join();
 	}
-    		
-	mTotalFramesOutput += outputSamples;
-	return outputSamples;
 }
 
-void SndfileSoundFile::pullWithResampling(uint32_t *framesRead, PortableBuffers &buffers, const int requestedOutputFrames) {
-	buffers.interleaved.resize(mResamplerInputBufLen * this->mNumChannels * sizeof(double));
-	const auto interleaved = reinterpret_cast<double *>(buffers.interleaved.data());
+void SndfileSoundFile::resampleNextChunk() {
+	int inputFrames;
+	if (!mAtEndOfFile) {
+		inputFrames = readInputChunk();
+		mFileFramesRead += inputFrames;
+		if (inputFrames < mResamplerInputBufLen) {
+			endOfInputFile();
+		}
+	} else {
+		// feed silence to flush the tail out of the resamplers.
+		inputFrames = mResamplerInputBufLen;
+		for (auto &input : mResamplerInputs) {
+			std::fill(input.begin(), input.end(), 0.);
+		}
+	}
+	if (inputFrames == 0) return;
 
-	if (mResampleSamplesBeforeOutput > 0) {
-		readUntilResamplerOutput(interleaved);
+	// keep the pending output at the start of the buffers so they stay small.
+	if (mResampledStart > 0) {
+		for (auto &resampled : mResampled) {
+			std::copy(resampled.begin() + mResampledStart, resampled.begin() + mResampledEnd, resampled.begin());
+		}
+		mResampledEnd -= mResampledStart;
+		mResampledStart = 0;
 	}
-    	
-	if (!mAtEndOfFile) {
-		*framesRead += readAndResample(buffers, requestedOutputFrames, interleaved);
+
+	std::vector<int> outputFrames(mNumChannels);
+	resampleChannels(inputFrames, outputFrames);
+
+	// every channel's resampler is identical, so they all output the same number of frames.
+	// anything past the expected length is just the flushed tail of the filters.
+	sf_count_t newFrames = outputFrames[0];
+	if (mAtEndOfFile) {
+		newFrames = std::min(newFrames, mExpectedTotalFramesOutput - mTotalFramesOutput);
 	}
+	writeToCache(mResampledEnd, static_cast<int>(newFrames));
+	mResampledEnd += static_cast<int>(newFrames);
+	mTotalFramesOutput += newFrames;
 
+	if (mAtEndOfFile && mTotalFramesOutput >= mExpectedTotalFramesOutput) {
+		finishCache();
+	}
+}
 
-	if (mAtEndOfFile &&
-	    mTotalFramesOutput < mExpectedTotalFramesOutput) {
-		*framesRead += resampleTail(*framesRead, buffers, requestedOutputFrames);
+void SndfileSoundFile::writeToCache(const int start, const int numFrames) {
+	if (!mCacheFile || numFrames <= 0) return;
+	mInterleaved.resize(static_cast<size_t>(numFrames) * mNumChannels);
+	for (int ch = 0; ch < mNumChannels; ++ch) {
+		const double *in = mResampled[ch].data() + start;
+		for (int frame = 0; frame < numFrames; ++frame) {
+			mInterleaved[frame * mNumChannels + ch] = in[frame];
+		}
 	}
+	mCacheFramesWritten += sf_writef_double(mCacheFile, mInterleaved.data(), numFrames);
+}
+
+void SndfileSoundFile::finishCache() {
+	if (!mCacheFile) return;
+	sf_close(mCacheFile);
+	mCacheFile = nullptr;
+
+	const std::string partPath = mCachePath + ".part";
+	std::error_code ec;
+	if (mCacheFramesWritten == mTotalFramesOutput) {
+		std::filesystem::rename(partPath, mCachePath, ec);
+	}
+	if (ec || mCacheFramesWritten != mTotalFramesOutput) {
+		std::filesystem::remove(partPath, ec);
+	}
+}
+
+void SndfileSoundFile::pullWithResampling(uint32_t *framesRead, PortableBuffers &buffers, const int requestedOutputFrames) {
+	while (mResampledEnd - mResampledStart < requestedOutputFrames
+	       && !(mAtEndOfFile && mTotalFramesOutput >= mExpectedTotalFramesOutput)) {
+		resampleNextChunk();
+	}
+
+	const int n = std::min(requestedOutputFrames, mResampledEnd - mResampledStart);
+	for (int ch = 0; ch < this->mNumChannels; ++ch) {
+		std::copy_n(mResampled[ch].data() + mResampledStart, n, static_cast<Z *>(buffers.buffers[ch].data));
+	}
+	mResampledStart += n;
+	*framesRead = n;
 }
 
 int SndfileSoundFile::pull(uint32_t *framesRead, PortableBuffers& buffers) {
@@ -202,6 +302,8 @@ int SndfileSoundFile::pull(uint32_t *framesRead, PortableBuffers& buffers) {
     
     if (!mResamplers.empty()) {
         pullWithResampling(framesRead, buffers, requestedOutputFrames);
+    } else if (mMapped) {
+        mMapped->pull(framesRead, buffers);
     } else {
 		pullWithoutResampling(framesRead, buffers, requestedOutputFrames);
     }
@@ -220,7 +322,8 @@ void SndfileSoundFile::writeAsync(const RtBuffers& buffers, const unsigned int n
 	mWriter->writeAsync(buffers, nBufferFrames);
 }
 
-unique_ptr<SndfileSoundFile> SndfileSoundFile::open(const char *path, const double threadSampleRate, const int maxBufLen) {
+unique_ptr<SndfileSoundFile> SndfileSoundFile::open(const char *path, const double threadSampleRate, const int maxBufLen,
+	const bool allowMapping) {
 	SNDFILE *sndfile = nullptr;
 	SF_INFO sfinfo = {0};
 		
@@ -239,7 +342,36 @@ unique_ptr<SndfileSoundFile> SndfileSoundFile::open(const char *path, const doub
 		return nullptr;
 	}
 
-	return make_unique<SndfileSoundFile>(path, nullptr, sndfile, numChannels, sfinfo.samplerate, threadSampleRate, maxBufLen);
+	const bool resampling = std::abs(sfinfo.samplerate - threadSampleRate) > 1e-9;
+	const std::string cachePath = resampling ? resampleCachePath(path, threadSampleRate) : std::string{};
+	if (!cachePath.empty() && std::filesystem::exists(cachePath)) {
+		if (auto cached = open(cachePath.c_str(), threadSampleRate, maxBufLen, allowMapping)) {
+			sf_close(sndfile);
+			return cached;
+		}
+	}
+
+	auto soundFile = make_unique<SndfileSoundFile>(path, nullptr, sndfile, numChannels, sfinfo.samplerate, threadSampleRate, maxBufLen);
+
+	// libsndfile has already validated the file, so only use the mapping if it agrees about the contents.
+	if (allowMapping) {
+		auto mapped = MappedWavFile::open(path);
+		if (mapped && mapped->numChannels() == numChannels && mapped->numFrames() == sfinfo.frames) {
+			soundFile->mMapped = std::move(mapped);
+		}
+	}
+
+	if (!cachePath.empty()) {
+		SF_INFO cacheInfo{
+			.samplerate = static_cast<int>(threadSampleRate),
+			.channels = static_cast<int>(numChannels),
+			.format = SF_FORMAT_WAV | SF_FORMAT_DOUBLE};
+		soundFile->mCacheFile = sf_open((cachePath + ".part").c_str(), SFM_WRITE, &cacheInfo);
+		if (soundFile->mCacheFile) {
+			soundFile->mCachePath = cachePath;
+		}
+	}
+	return soundFile;
 }
 
 // NOTE: ATTOW, interleaved is always passed as true, and
@@ -15,6 +15,10 @@
 //    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "SoundFiles.hpp"
+#include "BlockSchedule.hpp"
+#include "ChannelWorkers.hpp"
+#include "elapsedTime.hpp"
+#include <filesystem>
 #include <valarray>
 
 extern char gSessionTime[256];
@@ -115,8 +119,6 @@ void SFReader::fulfillOutputs(int blockSize)
 		this->mBuffers.setNumChannels(i, 1);
 		this->mBuffers.setData(i, out);
 		this->mBuffers.setSize(i, bufSize);
-		
-		memset(out, 0, bufSize);
 	};
 }
 
@@ -194,6 +196,56 @@ void sfread(Thread& th, Arg filename, int64_t offset, int64_t frames)
 	}
 }
 
+#ifndef SAPF_AUDIOTOOLBOX
+// reads the whole file in blocks, returning the elapsed time and the number of frames read.
+static double timeFileRead(Thread& th, const char* path, bool allowMapping, int64_t& outFrames, bool& outMapped)
+{
+	const int blockSize = th.rate.blockSize;
+	std::unique_ptr<SoundFile> soundFile = SoundFile::open(path, th.rate.sampleRate, blockSize, allowMapping);
+	if (!soundFile) throw errNotFound;
+
+	const uint32_t numChannels = soundFile->numChannels();
+	AudioBuffers bufs(numChannels);
+	std::vector<Z> data(numChannels * blockSize);
+	for (uint32_t i = 0; i < numChannels; ++i) {
+		bufs.setData(i, &data[i * blockSize]);
+		bufs.setSize(i, blockSize * sizeof(Z));
+	}
+
+	outFrames = 0;
+	outMapped = soundFile->isMapped();
+	double t0 = elapsedTime();
+	for (;;) {
+		uint32_t framesRead = blockSize;
+		if (soundFile->pull(&framesRead, bufs) || framesRead == 0) break;
+		outFrames += framesRead;
+	}
+	return elapsedTime() - t0;
+}
+
+void sfreadbench(Thread& th, Arg filename)
+{
+	const char* path = ((String*)filename.o())->s;
+
+	std::error_code ec;
+	const double megabytes = (double)std::filesystem::file_size(path, ec) / (1024. * 1024.);
+	if (ec) throw errNotFound;
+
+	post("sfbench '%s'  %g MB:\n", path, megabytes);
+	for (bool allowMapping : {false, true}) {
+		int64_t frames;
+		bool mapped;
+		double seconds = timeFileRead(th, path, allowMapping, frames, mapped);
+		if (allowMapping && !mapped) {
+			post("  mapped : not available for this file.\n");
+			break;
+		}
+		post("  %s : %lld frames  %f seconds  %g MB/s\n", mapped ? "mapped " : "sndfile",
+			(long long)frames, seconds, seconds > 0. ? megabytes / seconds : 0.);
+	}
+}
+#endif // SAPF_AUDIOTOOLBOX
+
 #ifdef SAPF_AUDIOTOOLBOX
 std::unique_ptr<SoundFile> sfcreate(Thread& th, const char* path, int numChannels, double fileSampleRate, bool interleaved)
 {
@@ -240,7 +292,7 @@ void makeRecordingPath(Arg filename, char* path, int len)
 	}
 }
 
-void sfwrite(Thread& th, V& v, Arg filename, bool openIt)
+void sfwrite(Thread& th, V& v, Arg filename, bool openIt, int numThreads)
 {
 	std::vector<ZIn> in;
 	
@@ -293,18 +345,58 @@ void sfwrite(Thread& th, V& v, Arg filename, bool openIt)
 	bufs.setData(0, &buf[0]);
 	bufs.setSize(0, kBufSize * sizeof(float));
 		
+	// for parallel rendering each channel is filled into its own planar buffer by a worker,
+	// so workers never share cache lines, then interleaved here once all channels are done.
+	std::unique_ptr<ChannelWorkers> workers;
+	std::vector<float> planar;
+	std::vector<int> channelFrames;
+	std::vector<char> channelDone;
+	if (numThreads <= 0) numThreads = ChannelWorkers::threadsFor(numChannels);
+	numThreads = std::min(numThreads, numChannels);
+	if (numThreads > 1) {
+		workers = std::make_unique<ChannelWorkers>(th, numThreads - 1);
+		planar.resize(numChannels * kBufSize);
+		channelFrames.resize(numChannels);
+		channelDone.resize(numChannels);
+	}
+	// scheduling forces every generator on this thread, so it is only used without workers.
+	std::unique_ptr<BlockSchedule> schedule;
+	if (!workers && blockScheduling()) {
+		schedule = std::make_unique<BlockSchedule>(in.data(), numChannels);
+	}
+	ChannelWorkers::ChannelFunc fillChannel = [&](Thread& wth, int i) {
+		int n = kBufSize;
+		channelDone[i] = in[i].fill(wth, n, &planar[i * kBufSize], 1);
+		channelFrames[i] = n;
+	};
+
 	int64_t framesPulled = 0;
 	int64_t framesWritten = 0;
 	bool done = false;
 	while (!done) {
 		int minn = kBufSize;
 		memset(&buf[0], 0, kBufSize * numChannels);
-		for (int i = 0; i < numChannels; ++i) {
-			int n = kBufSize;
-			bool imdone = in[i].fill(th, n, &buf[0]+i, numChannels);
-			framesPulled += n;
-			if (imdone) done = true;
-			minn = std::min(n, minn);
+		if (workers) {
+			workers->run(th, numChannels, fillChannel);
+			for (int i = 0; i < numChannels; ++i) {
+				int n = channelFrames[i];
+				float* out = &buf[0] + i;
+				float* chan = &planar[i * kBufSize];
+				for (int j = 0; j < n; ++j, out += numChannels)
+					*out = chan[j];
+				framesPulled += n;
+				if (channelDone[i]) done = true;
+				minn = std::min(n, minn);
+			}
+		} else {
+			if (schedule) schedule->prepare(th, kBufSize);
+			for (int i = 0; i < numChannels; ++i) {
+				int n = kBufSize;
+				bool imdone = in[i].fill(th, n, &buf[0]+i, numChannels);
+				framesPulled += n;
+				if (imdone) done = true;
+				minn = std::min(n, minn);
+			}
 		}
 
 		bufs.setSize(0, numChannels * minn * sizeof(float));
@@ -321,6 +413,9 @@ void sfwrite(Thread& th, V& v, Arg filename, bool openIt)
 		framesWritten += minn;
 	}
 	
+	workers = nullptr;
+	schedule = nullptr;
+
 	post("wrote file '%s'  %d channels  %g secs\n", path, numChannels, framesWritten * th.rate.invSampleRate);
 
 	soundFile = nullptr;
@@ -18,10 +18,16 @@
 #include "makeImage.hpp"
 #ifdef SAPF_ACCELERATE
 #include <Accelerate/Accelerate.h>
+#else
+#include "dsp.hpp"
+#include <algorithm>
+#include <thread>
+#include <vector>
 #endif // SAPF_ACCELERATE
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 
 static void makeColorTable(unsigned char* table);
 
@@ -96,7 +102,7 @@ static void calcKaiserWindowD(size_t size, double* window, double stopBandAttenu
 
 const int border = 8;
 
-void spectrogram(int size, double* data, int width, int log2bins, const char* path, double dBfloor)
+void spectrogram(int size, Z* data, int width, int log2bins, const char* path, double dBfloor)
 {
 #ifdef SAPF_ACCELERATE
 	int numRealFreqs = 1 << log2bins;
@@ -223,7 +229,90 @@ void spectrogram(int size, double* data, int width, int log2bins, const char* pa
 	free(interleavedData);
 	free(resultData);
 #else
-        // TODO cross platform spectrogram
+	int numRealFreqs = 1 << log2bins;
+
+	int log2n = log2bins + 1;
+	int n = 1 << log2n;
+	int nOver2 = n / 2;
+
+	double hopSize = size <= n ? 0 : (double)(size - n) / (double)(width - 1);
+
+	std::vector<double> window(n, 1.);
+	calcKaiserWindowD(n, window.data(), -180.);
+
+	unsigned char table[1028];
+	makeColorTable(table);
+
+	int heightOfAmplitudeView = 128;
+	int heightOfFFT = numRealFreqs+1;
+	int totalHeight = heightOfAmplitudeView+heightOfFFT+3*border;
+	int topOfSpectrum = heightOfAmplitudeView + 2*border;
+	int totalWidth = width+2*border;
+	Bitmap* b = createBitmap(totalWidth, totalHeight);
+	fillRect(b, 0, 0, totalWidth, totalHeight, 160, 160, 160, 255);
+	fillRect(b, border, border, width, heightOfAmplitudeView, 0, 0, 0, 255);
+
+	// each column of the image is independent, so the columns are split into contiguous runs, one per
+	// thread. Each frame reads its window straight out of data, zero padding past the end, rather than
+	// from a padded copy of the whole signal.
+	auto renderColumns = [&](int begin, int end) {
+		std::vector<Z> windowedData(n);
+		std::vector<Z> re(nOver2);
+		std::vector<Z> im(nOver2);
+		for (int i = begin; i < end; ++i) {
+			int64_t start = (int64_t)(nOver2 + i * hopSize) - nOver2;
+			int64_t available = std::max((int64_t)0, std::min((int64_t)n, (int64_t)size - start));
+
+			// find peak
+			double peak = 1e-20;
+			for (int64_t w = 0; w < available; ++w) {
+				double x = data[start + w];
+				windowedData[w] = window[w] * x;
+				x = fabs(x);
+				if (x > peak) peak = x;
+			}
+			for (int64_t w = available; w < n; ++w) windowedData[w] = 0.;
+
+			// rfft scales by 2/n, as the Accelerate version does.
+			rfft(n, windowedData.data(), re.data(), im.data());
+
+			// set pixels
+			{
+				double peakdB =  20.*log10(peak);
+				int peakColorIndex = 256. - peakdB * (256. / dBfloor);
+				int peakIndex = heightOfAmplitudeView - peakdB * (heightOfAmplitudeView / dBfloor);
+				if (peakIndex < 0) peakIndex = 0;
+				if (peakIndex > heightOfAmplitudeView) peakIndex = heightOfAmplitudeView;
+				if (peakColorIndex < 0) peakColorIndex = 0;
+				if (peakColorIndex > 255) peakColorIndex = 255;
+
+				unsigned char* t = table + 4*peakColorIndex;
+				fillRect(b, i+border, border+128-peakIndex, 1, peakIndex, t[0], t[1], t[2], t[3]);
+			}
+
+			for (int j = 0; j < numRealFreqs; ++j) {
+				double dBMag = 20.*log10(std::max<double>(hypot(re[j], im[j]), 1e-300));
+				int colorIndex = 256. - dBMag * (256. / dBfloor);
+				if (colorIndex < 0) colorIndex = 0;
+				if (colorIndex > 255) colorIndex = 255;
+
+				unsigned char* t = table + 4*colorIndex;
+
+				setPixel(b, i+border, numRealFreqs-j+topOfSpectrum, t[0], t[1], t[2], t[3]);
+			}
+		}
+	};
+
+	int numThreads = std::max(1, std::min((int)std::thread::hardware_concurrency(), width));
+	std::vector<std::thread> threads;
+	for (int t = 1; t < numThreads; ++t) {
+		threads.emplace_back(renderColumns, (int)((int64_t)width * t / numThreads), (int)((int64_t)width * (t+1) / numThreads));
+	}
+	renderColumns(0, width / numThreads);
+	for (auto& thread : threads) thread.join();
+
+	writeBitmap(b, path);
+	freeBitmap(b);
 #endif // SAPF_ACCELERATE
 }
 
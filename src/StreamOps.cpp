@@ -24,11 +24,13 @@
 #include <vector>
 #include <algorithm>
 #include <ZArr.hpp>
+#include "SimdKernels.hpp"
 
 #include "MultichannelExpansion.hpp"
 #include "UGen.hpp"
 #include "dsp.hpp"
 #include "SoundFiles.hpp"
+#include "ChannelWorkers.hpp"
 
 const Z kOneThird = 1. / 3.;
 
@@ -135,7 +137,11 @@ static void untupleN_(Thread& th, Prim* prim)
 	}
 }
 
+#ifdef TEST_BUILD
+void reverse_(Thread& th, Prim* prim)
+#else
 static void reverse_(Thread& th, Prim* prim)
+#endif
 {
 	P<List> s = th.popList("reverse : s");
 	
@@ -149,6 +155,13 @@ static void reverse_(Thread& th, Prim* prim)
 	}
 
 	P<Array> const& a = s->mArray;
+	if (s->isUnshared()) {
+		if (a->isV()) std::reverse(a->v(), a->v() + a->size());
+		else std::reverse(a->z(), a->z() + a->size());
+		th.push(s);
+		return;
+	}
+
 	P<List> s2 = new List(a->elemType, a->size());
 	P<Array> const& a2 = s2->mArray;
 	int64_t n = a->size();
@@ -282,6 +295,14 @@ static void rot_(Thread& th, Prim* prim)
 	int64_t n = a->size();
 	int type = a->elemType;
 	
+	if (s->isUnshared()) {
+		int64_t middle = sc_imod(-r, n);
+		if (type == itemTypeV) std::rotate(a->v(), a->v() + middle, a->v() + n);
+		else std::rotate(a->z(), a->z() + middle, a->z() + n);
+		th.push(s);
+		return;
+	}
+
 	P<List> s2 = new List(type, n);
 	P<Array> const& b = s2->mArray;
 	if (type == itemTypeV) {
@@ -3884,6 +3905,10 @@ static void take_(Thread& th, Prim* prim)
 
     Gen* g;
 	if (n > 0) {
+		if (s->isPacked() && n <= s->mArray->size()) {
+			th.push(new List(new Array(s->mArray, 0, n)));
+			return;
+		}
 		if (s->isVList()) 
 			g = new Take(th, n, s);
 		else
@@ -3897,30 +3922,27 @@ static void take_(Thread& th, Prim* prim)
 		int64_t size = s->length(th);
 		n = -n;
 		
+		if (size >= n) {
+			th.push(new List(new Array(s->mArray, size - n, n)));
+			return;
+		}
+		
 		List* s2 = new List(s->elemType, n);
 		th.push(s2);
 		s2->mArray->setSize(n);
+		// the list is shorter than n, so pad the front with zeroes.
+		int64_t offset = n - size;
 		if (s->isVList()) {
 			V* p = s2->mArray->v();
 			V* q = s->mArray->v();
-			if (size < n) {
-				int64_t offset = n - size;
-				for (int64_t i = 0; i < offset; ++i) p[i] = 0.;
-				for (int64_t i = 0, j = offset; i < size; ++i, ++j) p[j] = q[i];
-			} else {
-				for (int64_t i = 0, j = size - n; i < n; ++i, ++j) p[i] = q[j];
-			}
+			for (int64_t i = 0; i < offset; ++i) p[i] = 0.;
+			for (int64_t i = 0, j = offset; i < size; ++i, ++j) p[j] = q[i];
 		} else {
 			Z* p = s2->mArray->z();
 			Z* q = s->mArray->z();
 			size_t elemSize = s2->mArray->elemSize();
-			if (size < n) {
-				int64_t offset = n - size;
-				memset(p, 0, offset * elemSize);
-				memcpy(p + offset, q, size * elemSize);
-			} else {
-				memcpy(p, q + size - n, n * elemSize);
-			}
+			memset(p, 0, offset * elemSize);
+			memcpy(p + offset, q, size * elemSize);
 		}
 		return;
 		
@@ -3950,16 +3972,7 @@ static void skip_positive_(Thread& th, P<List>& list, int64_t n)
 		int64_t asize = a->size();
 		if (asize > n) {
 			int64_t remain = asize - n;
-			Array* a2 = new Array(list->elemType, remain);
-			a2->setSize(remain);
-			if (list->isVList()) {
-				for (int64_t i = 0, j = n; i < remain; ++i, ++j) {
-					a2->v()[i] = a->v()[j];
-				}
-			} else {
-				memcpy(a2->z(), a->z() + n, remain * a->elemSize());
-			}
-			list = new List(a2, list->next());
+			list = new List(new Array(list->mArray, n, remain), list->next());
 			return;
 		}
 		n -= asize;
@@ -4080,7 +4093,11 @@ static void hopTs_(Thread& th, Prim* prim)
 
 
 
+#ifdef TEST_BUILD
+void drop_(Thread& th, Prim* prim)
+#else
 static void drop_(Thread& th, Prim* prim)
+#endif
 {
 	int64_t n = th.popInt("drop : n");
 	P<List> s = th.popList("drop : s");
@@ -4104,19 +4121,7 @@ static void drop_(Thread& th, Prim* prim)
 			return;
 		}
 		
-		P<List> s2 = new List(s->elemType, remain);
-		th.push(s2);
-		s2->mArray->setSize(remain);
-		size_t elemSize = s2->mArray->elemSize();
-		if (s->isVList()) {
-			V* y =  s->mArray->v();
-			V* x = s2->mArray->v();
-			for (int64_t i = 0; i < remain; ++i) {
-				x[i] = y[i];
-			}
-		} else {
-			memcpy(s2->mArray->z(), s->mArray->z(), remain * elemSize);
-		}
+		th.push(new List(new Array(s->mArray, 0, remain)));
 	}
 }
 
@@ -4641,13 +4646,13 @@ static void histo_(Thread& th, Prim* prim)
 		Z* in = a->mArray->z();
 		
 		for (int64_t i = 0; i < size; ++i) {
-			int64_t j = (int64_t)std::clamp(in[i], 0., n1);
+			int64_t j = (int64_t)std::clamp<Z>(in[i], 0., n1);
 			out[j] += 1.;
 		}
 	} else {
 		V* in = a->mArray->v();
 		for (int64_t i = 0; i < size; ++i) {
-			int64_t j = (int64_t)std::clamp(in[i].asFloat(), 0., n1);
+			int64_t j = (int64_t)std::clamp<Z>(in[i].asFloat(), 0., n1);
 			out[j] += 1.;
 		}
 	}
@@ -5480,6 +5485,7 @@ static void longas0_(Thread& th, Prim* prim)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "Play.hpp"
+#include "BlockSchedule.hpp"
 
 static void play_(Thread& th, Prim* prim)
 {
@@ -5504,13 +5510,77 @@ static void stopDone_(Thread& th, Prim* prim)
 	stopPlayingIfDone();
 }
 
-static void interleave(int stride, int numFrames, double* in, float* out)
+static void setPlayAhead_(Thread& th, Prim* prim)
+{
+	int64_t n = th.popInt("setPlayAhead : numBlocks");
+	setPlayAhead((int)std::clamp(n, (int64_t)0, (int64_t)INT_MAX));
+}
+
+static void playAhead_(Thread& th, Prim* prim)
+{
+	th.push(playAhead());
+}
+
+static void setBlockSchedule_(Thread& th, Prim* prim)
+{
+	setBlockScheduling(th.pop().isTrue());
+}
+
+static void playStats_(Thread& th, Prim* prim)
+{
+	postPlayStats();
+}
+
+static void audioDevices_(Thread& th, Prim* prim)
+{
+	postAudioDevices();
+}
+
+static void setAudioDevice_(Thread& th, Prim* prim)
+{
+	V device = th.pop();
+	PlayConfig config = playConfig();
+	if (device.isString()) {
+		config.device = ((String*)device.o())->s;
+	} else if (device.isReal()) {
+		config.device = std::to_string((int64_t)device.f);
+	} else {
+		wrongType("setAudioDevice : device", "String or Real", device);
+	}
+	setPlayConfig(config);
+}
+
+static void setAudioBufferFrames_(Thread& th, Prim* prim)
+{
+	int64_t n = th.popInt("setAudioBufferFrames : frames");
+	PlayConfig config = playConfig();
+	config.bufferFrames = (int)std::clamp(n, (int64_t)16, (int64_t)8192);
+	setPlayConfig(config);
+}
+
+static void setAudioPriority_(Thread& th, Prim* prim)
+{
+	int64_t priority = th.popInt("setAudioPriority : priority");
+	PlayConfig config = playConfig();
+	config.priority = (int)std::clamp(priority, (int64_t)0, (int64_t)99);
+	setPlayConfig(config);
+}
+
+static void setAudioCPU_(Thread& th, Prim* prim)
+{
+	int64_t cpu = th.popInt("setAudioCPU : cpu");
+	PlayConfig config = playConfig();
+	config.cpu = (int)std::clamp(cpu, (int64_t)-1, (int64_t)1023);
+	setPlayConfig(config);
+}
+
+static void interleave(int stride, int numFrames, Z* in, float* out)
 {
 	for (int f = 0, k = 0; f < numFrames; ++f, k += stride)
 		out[k] = in[f];
 }
 
-static void deinterleave(int numChans, int numFrames, float* in, double** out)
+static void deinterleave(int numChans, int numFrames, float* in, Z** out)
 {
 	switch (numChans) {
 		case 1 : 
@@ -5604,6 +5674,17 @@ static void sfwriteopen_(Thread& th, Prim* prim)
 }
 
 
+static void sfwritepar_(Thread& th, Prim* prim)
+{
+	
+	V filename = th.pop();
+	
+	V v = th.popList(">sfp : channels");
+	
+	sfwrite(th, v, filename, false, 0);
+}
+
+
 static void sfread_(Thread& th, Prim* prim)
 {
 	
@@ -5612,15 +5693,24 @@ static void sfread_(Thread& th, Prim* prim)
 	sfread(th, filename, 0, -1);
 }
 
+#ifndef SAPF_AUDIOTOOLBOX
+static void sfbench_(Thread& th, Prim* prim)
+{
+	V filename = th.popString("sfbench : filename");
+
+	sfreadbench(th, filename);
+}
+#endif
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-static void bench_(Thread& th, Prim* prim)
+static void benchChannels(Thread& th, const char* name, bool inParallel)
 {
 	ZIn in[kMaxSFChannels];
 		
 	int numChannels = 0;
 	
-	V v = th.popList("bench : channels");
+	V v = th.popList(name);
 		
 	if (v.isZList()) {
 		if (!v.isFinite()) indefiniteOp(">sf : s - indefinite number of frames", "");
@@ -5650,15 +5740,32 @@ static void bench_(Thread& th, Prim* prim)
 	}
 	v.o = nullptr;
 
+	int numThreads = inParallel ? ChannelWorkers::threadsFor(numChannels) : 1;
+	std::unique_ptr<ChannelWorkers> workers;
+	if (numThreads > 1)
+		workers = std::make_unique<ChannelWorkers>(th, numThreads - 1);
+
+	int channelFrames[kMaxSFChannels];
+	bool channelDone[kMaxSFChannels];
+	ChannelWorkers::ChannelFunc benchChannel = [&](Thread& wth, int i) {
+		int n = kBufSize;
+		channelDone[i] = in[i].bench(wth, n);
+		channelFrames[i] = n;
+	};
+
 	double t0 = elapsedTime();
 	bool done = false;
 	int64_t framesFilled = 0;
 	while (!done) {
+		if (workers) {
+			workers->run(th, numChannels, benchChannel);
+		} else {
+			for (int i = 0; i < numChannels; ++i)
+				benchChannel(th, i);
+		}
 		for (int i = 0; i < numChannels; ++i) {
-			int n = kBufSize;
-			bool imdone = in[i].bench(th, n);
-			if (imdone) done = true;
-			framesFilled += n;
+			if (channelDone[i]) done = true;
+			framesFilled += channelFrames[i];
 		}
 	}
 	double t1 = elapsedTime();
@@ -5669,19 +5776,37 @@ static void bench_(Thread& th, Prim* prim)
 	
 	post("bench:\n");
 	post("  %f seconds of audio.\n", secondsOfAudio);
+	if (numThreads > 1)
+		post("  %d threads.\n", numThreads);
 	post("  %f seconds of CPU.\n", secondsOfCPU);
 	post("  %f %% of real time.\n", percentOfRealtime);
 	
 }
 
+static void bench_(Thread& th, Prim* prim)
+{
+	benchChannels(th, "bench : channels", false);
+}
+
+static void benchp_(Thread& th, Prim* prim)
+{
+	benchChannels(th, "benchp : channels", true);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
-#ifdef SAPF_AUDIOTOOLBOX
 #include "Spectrogram.hpp"
 
 std::atomic<int32_t> gSpectrogramFileCount = 0;
 
+// the Cocoa image writer makes jpegs, the portable one pngs.
+#ifdef SAPF_COCOA
+const char* kSpectrogramFileExtension = "jpg";
+#else
+const char* kSpectrogramFileExtension = "png";
+#endif // SAPF_COCOA
+
 static void sgram_(Thread& th, Prim* prim)
 {
 	V filename = th.pop();
@@ -5696,29 +5821,30 @@ static void sgram_(Thread& th, Prim* prim)
 	if (filename.isString()) {
 		const char* sgramDir = getenv("SAPF_SPECTROGRAMS");
 		if (!sgramDir || strlen(sgramDir)==0) sgramDir = "/tmp";
-		snprintf(path, 1024, "%s/%s-%d.jpg", sgramDir, ((String*)filename.o())->s, (int)floor(dBfloor + .5));
+		snprintf(path, 1024, "%s/%s-%d.%s", sgramDir, ((String*)filename.o())->s, (int)floor(dBfloor + .5), kSpectrogramFileExtension);
 	} else {
 		int32_t count = ++gSpectrogramFileCount;
-		snprintf(path, 1024, "/tmp/sapf-%s-%04d.jpg", gSessionTime, count);
+		snprintf(path, 1024, "/tmp/sapf-%s-%04d.%s", gSessionTime, count, kSpectrogramFileExtension);
 	}
 
 
 	list = list->pack(th);
 	P<Array> array = list->mArray;
 	int64_t n = array->size();
-	double* z = array->z();
+	Z* z = array->z();
 	spectrogram((int)n, z, 3200, 11, path, -dBfloor);
 	
 	{
 		char cmd[1100];
-		snprintf(cmd, 1100, "open \"%s\"", path);
+		#ifdef _WIN32
+			snprintf(cmd, 1100, "start \"\" \"%s\"", path);
+		#else
+			snprintf(cmd, 1100, "open \"%s\"", path);
+		#endif
 		system(cmd);
 	}
 	
 }
-#else
-// TODO
-#endif // SAPF_AUDIOTOOLBOX
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -5758,7 +5884,7 @@ static double kaiser_alpha(double atten)
 	return alpha;
 }
 
-static void kaiser(size_t m, double *s, double alpha)
+static void kaiser(size_t m, Z *s, double alpha)
 {
 	if (m == 0) return;
 	if (m == 1) {
@@ -5807,7 +5933,7 @@ static void hanning_(Thread& th, Prim* prim)
 #else
 	Eigen::ArrayXd arr = Eigen::ArrayXd::LinSpaced(n, 0, n - 1);
 	ZArr outzarr = zarr(out->mArray->z(), n, 1);
-	outzarr = 0.5 * (1.0 - (2.0 * M_PI * arr / n).cos());
+	outzarr = (0.5 * (1.0 - (2.0 * M_PI * arr / n).cos())).cast<Z>();
 #endif // SAPF_ACCELERATE
 	
 	th.push(out);
@@ -5829,7 +5955,7 @@ static void hamming_(Thread& th, Prim* prim)
 #else
 	Eigen::ArrayXd arr = Eigen::ArrayXd::LinSpaced(n, 0, n - 1);
 	ZArr outzarr = zarr(out->mArray->z(), n, 1);
-	outzarr = 0.54 - .46 * (2.0 * M_PI * arr / n).cos();
+	outzarr = (0.54 - .46 * (2.0 * M_PI * arr / n).cos()).cast<Z>();
 #endif // SAPF_ACCELERATE
 	
 	th.push(out);
@@ -5851,9 +5977,9 @@ static void blackman_(Thread& th, Prim* prim)
 #else
 	Eigen::ArrayXd arr = Eigen::ArrayXd::LinSpaced(n, 0, n-1);
 	ZArr outzarr = zarr(out->mArray->z(), n, 1);
-	outzarr = 0.42
+	outzarr = (0.42
 		- .5 * (2.0 * M_PI * arr / n).cos()
-		+ .08 * (4.0 * M_PI * arr / n).cos();
+		+ .08 * (4.0 * M_PI * arr / n).cos()).cast<Z>();
 #endif // SAPF_ACCELERATE
 	
 	th.push(out);
@@ -5892,10 +6018,15 @@ struct Segment : public Gen
 			}
 			
 			int length = (int)floor(sr_ * zlength + .5);
-			P<List> segment = new List(itemTypeZ, length);
-			segment->mArray->setSize(length);
-			bool nomore = in_.fillSegment(th, length, segment->mArray->z());
-			out[i] = segment;
+			bool nomore = false;
+			if (P<Array> view = in_.segmentView(th, length)) {
+				out[i] = new List(view);
+			} else {
+				P<List> segment = new List(itemTypeZ, length);
+				segment->mArray->setSize(length);
+				nomore = in_.fillSegment(th, length, segment->mArray->z());
+				out[i] = segment;
+			}
 			++framesFilled;
 			if (nomore) {
 				setDone();
@@ -5941,12 +6072,11 @@ static void seg_(Thread& th, Prim* prim)
     }
 #else
 	#ifdef TEST_BUILD
-	    void wseg_apply_window(Z* segbuf, ZArr window, int n) {
+	    void wseg_apply_window(Z* segbuf, Z* window, int n) {
 	#else
-	    inline void wseg_apply_window(Z* segbuf, ZArr window, int n) {
+	    inline void wseg_apply_window(Z* segbuf, Z* window, int n) {
 	#endif
-        ZArr segbufarr = zarr(segbuf, 1, n);
-		segbufarr = segbufarr * window;
+        simdKernels().mul(n, segbuf, 1, window, 1, segbuf);
     }
 #endif
 
@@ -5955,9 +6085,6 @@ struct WinSegment : public Gen
 	ZIn in_;
 	BothIn hop_;
 	P<Array> window_;
-#ifndef SAPF_ACCELERATE
-	ZArr windowzarr_;
-#endif
     int length_;
 	int offset;
     Z fracsamp_;
@@ -5965,9 +6092,6 @@ struct WinSegment : public Gen
 	
 	WinSegment(Thread& th, Arg in, Arg hop, P<Array> const& window)
         : Gen(th, itemTypeV, mostFinite(in, hop)), in_(in), hop_(hop), window_(window),
-#ifndef SAPF_ACCELERATE
-			windowzarr_(zarr(window_->z(), 1, (int)window_->size())),
-#endif
             length_((int)window_->size()),
         fracsamp_(0.), sr_(th.rate.sampleRate)
 	{
@@ -5987,11 +6111,7 @@ struct WinSegment : public Gen
 			segment->mArray->setSize(length_);
             Z* segbuf = segment->mArray->z();
 			bool nomore = in_.fillSegment(th, (int)length_, segbuf);
-#ifdef SAPF_ACCELERATE
             wseg_apply_window(segbuf, window_->z(), length_);
-#else
-            wseg_apply_window(segbuf, windowzarr_, length_);
-#endif // SAPF_ACCELERATE
 			out[i] = segment;
 			++framesFilled;
 			if (nomore) {
@@ -6029,6 +6149,241 @@ static void wseg_(Thread& th, Prim* prim)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// frames are emitted as packed spectra (see rfft_packed). A frame's storage is reused once every
+// reference the consumer took to it has been dropped, so a steady state stft allocates nothing.
+struct Stft : public Gen
+{
+	ZIn in_;
+	BothIn hop_;
+	P<Array> window_;
+	int length_;
+	Z fracsamp_;
+	Z sr_;
+	std::vector<P<List>> frames_;
+	size_t nextFrame_;
+
+	Stft(Thread& th, Arg in, Arg hop, P<Array> const& window)
+		: Gen(th, itemTypeV, mostFinite(in, hop)), in_(in), hop_(hop), window_(window),
+			length_((int)window_->size()),
+		fracsamp_(0.), sr_(th.rate.sampleRate),
+		// a frame can be referenced from the block holding it and from the block before.
+		frames_(2 * mBlockSize), nextFrame_(0)
+	{
+	}
+
+	virtual const char* TypeName() const override { return "Stft"; }
+
+	P<List> const& nextFrame()
+	{
+		P<List>& frame = frames_[nextFrame_];
+		nextFrame_ = (nextFrame_ + 1) % frames_.size();
+		if (!frame || frame->getRefcount() != 1 || frame->mArray->getRefcount() != 1) {
+			frame = new List(itemTypeZ, length_);
+			frame->mArray->setSize(length_);
+		}
+		return frame;
+	}
+
+	virtual void pull(Thread& th) override
+	{
+		int framesToFill = mBlockSize;
+		int framesFilled = 0;
+		V* out = mOut->fulfill(framesToFill);
+		for (int i = 0; i < framesToFill; ++i) {
+			Z zhop;
+
+			P<List> const& frame = nextFrame();
+			Z* framebuf = frame->mArray->z();
+			bool nomore = in_.fillSegment(th, length_, framebuf);
+			wseg_apply_window(framebuf, window_->z(), length_);
+			rfft_packed(length_, framebuf);
+			out[i] = frame;
+			++framesFilled;
+			if (nomore) {
+				setDone();
+				goto leave;
+			}
+
+			if (hop_.onez(th, zhop)) {
+				setDone();
+				goto leave;
+			}
+
+			Z fhop = sr_ * zhop + fracsamp_;
+			Z ihop = floor(fhop);
+			fracsamp_ = fhop - ihop;
+
+			in_.hop(th, (int)ihop);
+		}
+	leave:
+		produce(framesToFill - framesFilled);
+	}
+
+};
+
+// inverse transforms each packed frame in a preallocated buffer, applies the synthesis window and
+// overlap-adds it into an accumulator that output blocks are copied from as each hop completes.
+struct Istft : public Gen
+{
+	VIn frames_;
+	BothIn hop_;
+	P<Array> window_;
+	int length_;
+	Z fracsamp_;
+	Z sr_;
+	std::vector<Z> frame_;
+	std::vector<Z> acc_;
+	int readPos_ = 0;
+	int ready_ = 0;		// samples at readPos_ in acc_ that no later frame will add to.
+	int64_t zeros_ = 0;	// silence to output before them, when the hop is longer than a frame.
+	int64_t gap_ = 0;	// the silence owed once the next frame arrives. dropped at the end.
+	int lastReady_;		// the samples of acc_ the last hop output. the rest are flushed at the end.
+	bool ended_ = false;
+
+	Istft(Thread& th, Arg frames, Arg hop, P<Array> const& window)
+		: Gen(th, itemTypeZ, mostFinite(frames, hop)), frames_(frames), hop_(hop), window_(window),
+			length_((int)window_->size()),
+		fracsamp_(0.), sr_(th.rate.sampleRate),
+		frame_(length_), acc_(length_, 0.), lastReady_(length_)
+	{
+	}
+
+	virtual const char* TypeName() const override { return "Istft"; }
+
+	void addFrame(Thread& th, Arg v)
+	{
+		if (!v.isZList())
+			wrongType("istft : frames", "stream of signals", v);
+		P<List> frame = (List*)v.o();
+		if (!frame->isPacked())
+			frame = frame->pack(th);
+		if (!frame || frame->mArray->size() != length_) {
+			post("istft : frame size is different than the window size.\n");
+			throw errFailed;
+		}
+
+		Z* framebuf = frame_.data();
+		memcpy(framebuf, frame->mArray->z(), length_ * sizeof(Z));
+		rifft_packed(length_, framebuf);
+
+		Z* window = window_->z();
+		Z* acc = acc_.data();
+		for (int i = 0; i < length_; ++i) {
+			acc[i] += framebuf[i] * window[i];
+		}
+	}
+
+	// called when the first ready_ samples of the accumulator have been output.
+	void shift()
+	{
+		Z* acc = acc_.data();
+		int remaining = length_ - readPos_;
+		memmove(acc, acc + readPos_, remaining * sizeof(Z));
+		memset(acc + remaining, 0, readPos_ * sizeof(Z));
+		readPos_ = 0;
+	}
+
+	virtual void pull(Thread& th) override
+	{
+		int framesToFill = mBlockSize;
+		int framesFilled = 0;
+		Z* out = mOut->fulfillz(framesToFill);
+		while (framesFilled < framesToFill) {
+			int n = framesToFill - framesFilled;
+			if (zeros_) {
+				n = (int)std::min((int64_t)n, zeros_);
+				memset(out + framesFilled, 0, n * sizeof(Z));
+				zeros_ -= n;
+				framesFilled += n;
+			} else if (ready_) {
+				n = std::min(n, ready_);
+				memcpy(out + framesFilled, acc_.data() + readPos_, n * sizeof(Z));
+				readPos_ += n;
+				ready_ -= n;
+				framesFilled += n;
+				if (!ready_) shift();
+			} else if (ended_) {
+				setDone();
+				break;
+			} else {
+				V v;
+				Z zhop;
+				if (frames_.one(th, v)) {
+					// flush the overlapping tail of the last frame, which its hop has already
+					// output the start of.
+					ended_ = true;
+					ready_ = length_ - lastReady_;
+					continue;
+				}
+				addFrame(th, v);
+				zeros_ = gap_;
+				if (hop_.onez(th, zhop)) {
+					ended_ = true;
+					ready_ = length_;
+					continue;
+				}
+
+				Z fhop = sr_ * zhop + fracsamp_;
+				Z ihop = floor(fhop);
+				fracsamp_ = fhop - ihop;
+
+				int64_t hop = std::max((int64_t)0, (int64_t)ihop);
+				ready_ = (int)std::min(hop, (int64_t)length_);
+				lastReady_ = ready_;
+				gap_ = hop - ready_;
+			}
+		}
+		produce(framesToFill - framesFilled);
+	}
+
+};
+
+static P<Array> spectralWindow(Thread& th, const char* msg)
+{
+	P<List> window = th.popZList(msg);
+	if (!window->isFinite())
+		indefiniteOp(msg, "");
+	window = window->pack(th);
+	int64_t n = window->mArray->size();
+	if (!ISPOWEROFTWO64(n) || n < (1 << kMinFFTLogSize)) {
+		post("%s size is not a power of two.\n", msg);
+		throw errFailed;
+	}
+	if (n > (1 << kMaxFFTLogSize)) {
+		post("%s size is larger than %d.\n", msg, 1 << kMaxFFTLogSize);
+		throw errOutOfRange;
+	}
+	return window->mArray;
+}
+
+#ifdef TEST_BUILD
+void stft_(Thread& th, Prim* prim)
+#else
+static void stft_(Thread& th, Prim* prim)
+#endif
+{
+	P<Array> window = spectralWindow(th, "stft : window");
+	V hop = th.pop();
+	V in = th.popZIn("stft : in");
+
+	th.push(new List(new Stft(th, in, hop, window)));
+}
+
+#ifdef TEST_BUILD
+void istft_(Thread& th, Prim* prim)
+#else
+static void istft_(Thread& th, Prim* prim)
+#endif
+{
+	P<Array> window = spectralWindow(th, "istft : window");
+	V hop = th.pop();
+	V frames = th.pop();
+
+	th.push(new List(new Istft(th, frames, hop, window)));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
@@ -6054,6 +6409,10 @@ static void fft_(Thread& th, Prim* prim)
 		post("fft : size is not a power of two.\n");
 		throw errFailed;
 	}
+	if (n > (1 << kMaxFFTLogSize)) {
+		post("fft : size is larger than %d.\n", 1 << kMaxFFTLogSize);
+		throw errOutOfRange;
+	}
 	
 	inReal = inReal->pack(th);
 	inImag = inImag->pack(th);
@@ -6092,6 +6451,10 @@ static void ifft_(Thread& th, Prim* prim)
 		post("ifft : size is not a power of two.\n");
 		throw errFailed;
 	}
+	if (n > (1 << kMaxFFTLogSize)) {
+		post("ifft : size is larger than %d.\n", 1 << kMaxFFTLogSize);
+		throw errOutOfRange;
+	}
 	
 	inReal = inReal->pack(th);
 	inImag = inImag->pack(th);
@@ -7381,6 +7744,8 @@ static void sort_(Thread& th, Prim* prim)
 		indefiniteOp("sort : a", "");
 	
 	P<List> list = ((List*)a.o())->pack(th);
+	a.o = nullptr; // so that list may be the only reference, and can be sorted in place.
+	bool inPlace = list->isUnshared();
 		
 	P<Array> array = list->mArray; 
 	int64_t n = array->size();
@@ -7388,6 +7753,11 @@ static void sort_(Thread& th, Prim* prim)
 	if (list->isVList()) {
 		V* v = array->v();
 		VLess cmp;
+		if (inPlace) {
+			sort(th, n, v, v, &cmp);
+			th.push(list);
+			return;
+		}
 		
 		P<List> out = new List(itemTypeV, n);
 		out->mArray->setSize(n);
@@ -7398,6 +7768,11 @@ static void sort_(Thread& th, Prim* prim)
 	} else {
 		Z* z = array->z();
 		ZLess cmp;
+		if (inPlace) {
+			sort(th, n, z, z, &cmp);
+			th.push(list);
+			return;
+		}
 		P<List> out = new List(itemTypeZ, n);
 		out->mArray->setSize(n);
 		Z* zout = out->mArray->z();
@@ -7417,6 +7792,8 @@ static void sortf_(Thread& th, Prim* prim)
 		indefiniteOp("sort : a", "");
 	
 	P<List> list = ((List*)a.o())->pack(th);
+	a.o = nullptr; // so that list may be the only reference, and can be sorted in place.
+	bool inPlace = list->isUnshared();
 		
 	P<Array> array = list->mArray; 
 	int64_t n = array->size();
@@ -7424,6 +7801,11 @@ static void sortf_(Thread& th, Prim* prim)
 	if (list->isVList()) {
 		V* v = array->v();
 		VCompareF cmp(fun);
+		if (inPlace) {
+			sort(th, n, v, v, &cmp);
+			th.push(list);
+			return;
+		}
 		
 		P<List> out = new List(list->ItemType(), n);
 		out->mArray->setSize(n);
@@ -7434,6 +7816,11 @@ static void sortf_(Thread& th, Prim* prim)
 	} else {
 		Z* z = array->z();
 		ZCompareF cmp(fun);
+		if (inPlace) {
+			sort(th, n, z, z, &cmp);
+			th.push(list);
+			return;
+		}
 		P<List> out = new List(itemTypeZ, n);
 		out->mArray->setSize(n);
 		Z* zout = out->mArray->z();
@@ -7451,6 +7838,8 @@ static void sort_gt_(Thread& th, Prim* prim)
 		indefiniteOp("sort> : a", "");
 	
 	P<List> list = ((List*)a.o())->pack(th);
+	a.o = nullptr; // so that list may be the only reference, and can be sorted in place.
+	bool inPlace = list->isUnshared();
 		
 	P<Array> array = list->mArray; 
 	int64_t n = array->size();
@@ -7458,6 +7847,11 @@ static void sort_gt_(Thread& th, Prim* prim)
 	if (list->isVList()) {
 		V* v = array->v();
 		VGreater cmp;
+		if (inPlace) {
+			sort(th, n, v, v, &cmp);
+			th.push(list);
+			return;
+		}
 		
 		P<List> out = new List(itemTypeV, n);
 		out->mArray->setSize(n);
@@ -7468,6 +7862,11 @@ static void sort_gt_(Thread& th, Prim* prim)
 	} else {
 		Z* z = array->z();
 		ZGreater cmp;
+		if (inPlace) {
+			sort(th, n, z, z, &cmp);
+			th.push(list);
+			return;
+		}
 		P<List> out = new List(itemTypeZ, n);
 		out->mArray->setSize(n);
 		Z* zout = out->mArray->z();
@@ -7838,19 +8237,33 @@ void AddStreamOps()
 
 	DEFAM(seg, zaa, "(in hops durs --> out) divide input signal in to a stream of signal segments of given duration stepping by hop time.")
 	DEFAM(wseg, zaz, "(in hops window --> out) divide input signal in to a stream of windowed signal segments of lengths equal to the window length, stepping by hop time.")
+	DEFAM(stft, zaz, "(in hops window --> frames) short time Fourier transform. returns a stream of packed spectra of windowed segments of the input, stepping by hop time. a packed spectrum holds the real parts of bins 0 to n/2-1 then their imaginary parts, with the real part of the nyquist bin in place of the imaginary part of bin 0. the window length must be a power of two.")
+	DEFAM(istft, aaz, "(frames hops window --> out) inverse of stft. overlap-adds the inverse transforms of a stream of packed spectra, multiplied by the window, stepping by hop time.")
 
 	vm.addBifHelp("\n*** audio I/O operations ***");
 	DEF(play, 1, 0, "(channels -->) plays the audio to the hardware.")
 	DEF(record, 2, 0, "(channels filename -->) plays the audio to the hardware and records it to a file.")
 	DEFnoeach(stop, 0, 0, "(-->) stops any audio playing.")
+	DEFnoeach(setPlayAhead, 1, 0, "(numBlocks -->) sets how many blocks are rendered ahead of the audio hardware by a separate thread for players started afterwards. 0 renders in the audio callback.")
+	DEFnoeach(playAhead, 0, 1, "(--> numBlocks) returns the number of blocks rendered ahead of the audio hardware.")
+	DEFnoeach(setBlockSchedule, 1, 0, "(bool -->) if true, players and single threaded file writes started afterwards compute their signal generators block by block in a precomputed order, instead of pulling each one from the generators that read it. generators created while playing are still pulled as needed.")
+	DEFnoeach(playStats, 0, 0, "(-->) prints play ahead, underrun and audio callback timing statistics for each player.")
+	DEFnoeach(audioDevices, 0, 0, "(-->) prints the audio output devices.")
+	DEFnoeach(setAudioDevice, 1, 0, "(device -->) sets the audio output device for players started afterwards, by id or by a name or part of one. an empty string selects the default output device.")
+	DEFnoeach(setAudioBufferFrames, 1, 0, "(frames -->) sets the number of frames per audio callback requested for players started afterwards.")
+	DEFnoeach(setAudioPriority, 1, 0, "(priority -->) sets the realtime scheduling priority of the audio callback thread for players started afterwards. 0 leaves scheduling to the audio driver.")
+	DEFnoeach(setAudioCPU, 1, 0, "(cpu -->) pins the audio callback thread of players started afterwards to a cpu, where supported. -1 doesn't pin it.")
 	vm.def("sf>", 1, 0, sfread_, "(filename -->) read channels from an audio file. not real time.");
+#ifndef SAPF_AUDIOTOOLBOX
+	vm.def("sfbench", 1, 0, sfbench_, "(filename -->) reads an audio file through each available reader and prints the throughput in MB/s.");
+#endif
 	vm.def(">sf", 2, 0, sfwrite_, "(channels filename -->) writes the audio to a file.");
+	vm.def(">sfp", 2, 0, sfwritepar_, "(channels filename -->) writes the audio to a file, computing the channels in parallel on a pool of threads. channels must not depend on each other's side effects.");
 	vm.def(">sfo", 2, 0, sfwriteopen_, "(channels filename -->) writes the audio to a file and opens it in the default application.");
 	//vm.def("sf>", 2, sfread_);
 	DEF(bench, 1, 0, "(channels -->) prints the amount of CPU required to compute a segment of audio. audio must be of finite duration.")
-#ifdef SAPF_AUDIOTOOLBOX
+	DEF(benchp, 1, 0, "(channels -->) like bench, but computes the channels in parallel on a pool of threads and prints the elapsed time.")
 	vm.def("sgram", 3, 0, sgram_, "(signal dBfloor filename -->) writes a spectrogram to a file and opens it.");
-#endif // SAPF_AUDIOTOOLBOX
 
 	setSessionTime();
 
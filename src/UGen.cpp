@@ -713,7 +713,7 @@ struct Curves : public Gen
 								goto leave;
 							}
 						} while (dur_ <= 0.);
-						dur_ = std::max(dur_, 1e-4);
+						dur_ = std::max<Z>(dur_, 1e-4);
 						invdur_ = 1. / dur_;
 						Z a1 = (newval_ - oldval_) / (1. - exp(curve_));
 						a2_ = oldval_ + a1;
@@ -1031,7 +1031,7 @@ struct ADSR : public Gen
 			step_ = 1.;
 		} else {
 
-			dur_ = std::max(dur_, 1e-5);
+			dur_ = std::max<Z>(dur_, 1e-5);
 			Z invdur = 1. / dur_;
 			Z a1 = (newval_ - oldval_) / (1. - exp(curve_));
 			a2_ = oldval_ + a1;
@@ -1163,7 +1163,7 @@ struct GatedADSR : public Gen
 			step_ = 1.;
 		} else {
 
-			dur_ = std::max(dur_, 1e-5);
+			dur_ = std::max<Z>(dur_, 1e-5);
 			Z invdur = 1. / dur_;
 			Z a1 = (newval_ - oldval_) / (1. - exp(curve_));
 			a2_ = oldval_ + a1;
@@ -3101,7 +3101,7 @@ struct ITD : public Gen
 			} else {
 				for (int i = 0; i < n; ++i) {
 					{
-						Z fpos = std::max(2., *pan * half + half);
+						Z fpos = std::max<Z>(2., *pan * half + half);
 						Z ipos = floor(fpos);
 						Z frac = fpos - ipos;
 						int32_t offset = bufPos-(int32_t)ipos;
@@ -3113,7 +3113,7 @@ struct ITD : public Gen
 						Lout += Loutstride;
 					}
 					{
-						Z fpos = std::max(2., -*pan * half + half);
+						Z fpos = std::max<Z>(2., -*pan * half + half);
 						Z ipos = floor(fpos);
 						Z frac = fpos - ipos;
 						int32_t offset = bufPos-(int32_t)ipos;
@@ -3284,7 +3284,7 @@ void Pan2::pull(Thread& th)
 		}
 		
 		if (bStride == 0) {
-			Z x = std::clamp(*b, -1., 1.);
+			Z x = std::clamp<Z>(*b, -1., 1.);
 			Z Lpan = fast_pan(-x);
 			Z Rpan = fast_pan(x);
 			for (int i = 0; i < n; ++i) {
@@ -3297,7 +3297,7 @@ void Pan2::pull(Thread& th)
 			}
 		} else {
 			for (int i = 0; i < n; ++i) {
-				Z x = std::clamp(*b, -1., 1.);
+				Z x = std::clamp<Z>(*b, -1., 1.);
 				Z z = *a;
 				*Lout = z * fast_pan(-x);
 				*Rout = z * fast_pan(x);
@@ -3429,7 +3429,7 @@ void Balance2::pull(Thread& th)
 		}
 		
 		if (cStride == 0) {
-			Z x = std::clamp(*c, -1., 1.);
+			Z x = std::clamp<Z>(*c, -1., 1.);
 			Z Lpan = fast_pan(-x);
 			Z Rpan = fast_pan(x);
 			for (int i = 0; i < n; ++i) {
@@ -3442,7 +3442,7 @@ void Balance2::pull(Thread& th)
 			}
 		} else {
 			for (int i = 0; i < n; ++i) {
-				Z x = std::clamp(*c, -1., 1.);
+				Z x = std::clamp<Z>(*c, -1., 1.);
 				*Lout = *a * fast_pan(-x);
 				*Rout = *b * fast_pan(x);
 				a += aStride;
@@ -3705,7 +3705,7 @@ struct Fade2 : public Gen
 			}
 			
 			if (cStride == 0) {
-				Z x = std::clamp(*c, -1., 1.);
+				Z x = std::clamp<Z>(*c, -1., 1.);
 				Z Lpan = fast_pan(-x);
 				Z Rpan = fast_pan(x);
 				for (int i = 0; i < n; ++i) {
@@ -3715,7 +3715,7 @@ struct Fade2 : public Gen
 				}
 			} else {
 				for (int i = 0; i < n; ++i) {
-					Z x = std::clamp(*c, -1., 1.);
+					Z x = std::clamp<Z>(*c, -1., 1.);
 					out[i] = *a * fast_pan(-x) + *b * fast_pan(x);
 					a += aStride;
 					b += bStride;
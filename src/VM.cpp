@@ -173,7 +173,9 @@ VM::VM()
 	totalObjectsAllocated(0),
 	totalObjectsFreed(0),
 	totalSignalGenerators(0),
-	totalStreamGenerators(0)
+	totalStreamGenerators(0),
+	totalPoolHits(0),
+	totalPoolMisses(0)
 #endif
 {
 	initElapsedTime();
@@ -17,57 +17,139 @@
 #include "dsp.hpp"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <cmath>
+#include <mutex>
+#include <vector>
+
+// planning is not thread safe in fftw, nor is creating an Accelerate setup, so both happen under this lock.
+static std::mutex gFFTPlanMutex;
+
+#ifndef SAPF_ACCELERATE
+
+static const char* gWisdomPath = nullptr;
+static unsigned gPlanRigor = FFTW_ESTIMATE;
+
+static bool isAligned(Z* p)
+{
+	return SAPF_FFTW(alignment_of)(p) == 0;
+}
+
+// scratch for the real transforms. fftw's r2c output and c2r input hold n/2+1 bins, one more than
+// the callers' buffers, and c2r also overwrites its input.
+struct FFTWorkspace
+{
+	Z* real = nullptr;
+	Z* imag = nullptr;
+	size_t size = 0;
+
+	~FFTWorkspace()
+	{
+		SAPF_FFTW(free)(real);
+		SAPF_FFTW(free)(imag);
+	}
+
+	void reserve(size_t inSize)
+	{
+		if (inSize <= size) return;
+		SAPF_FFTW(free)(real);
+		SAPF_FFTW(free)(imag);
+		real = SAPF_FFTW(alloc_real)(inSize);
+		imag = SAPF_FFTW(alloc_real)(inSize);
+		size = inSize;
+	}
+};
+
+static thread_local FFTWorkspace tFFTWorkspace;
+
+#endif // SAPF_ACCELERATE
 
 void FFT::init(size_t log2n) {
-	this->n = pow(2, log2n);
+	this->n = (size_t)1 << log2n;
 	this->log2n = log2n;
-    
+}
+
 #ifdef SAPF_ACCELERATE
+
+void FFT::makeSetup() {
+	std::lock_guard<std::mutex> lock(gFFTPlanMutex);
+	if (this->ready.load(std::memory_order_relaxed)) return;
 	this->setup = vDSP_create_fftsetupD(this->log2n, kFFTRadix2);
-#else
-	this->in = (fftw_complex *) fftw_malloc(this->n * sizeof(fftw_complex));
-	this->out = (fftw_complex *) fftw_malloc(this->n * sizeof(fftw_complex));
-	// "Here, n is the “logical” size of the DFT, not necessarily the
-	// physical size of the array. In particular, the real (double) array
-	// has n elements, while the complex (fftw_complex) array has n/2+1
-	// elements (where the division is rounded down). For an in-place
-	// transform, in and out are aliased to the same array, which must be
-	// big enough to hold both; so, the real array would actually have
-	// 2*(n/2+1) elements, where the elements beyond the first n are unused
-	// padding."
-	// - https://fftw.org/fftw3_doc/One_002dDimensional-DFTs-of-Real-Data.html
-	this->in_out_real = (double *) fftw_malloc(2 * (this->n / 2 + 1) * sizeof(double));
-	
-	this->forward_out_of_place_plan = fftw_plan_dft_1d(this->n, this->in, this->out, FFTW_FORWARD, FFTW_ESTIMATE);
-	this->backward_out_of_place_plan = fftw_plan_dft_1d(this->n, this->in, this->out, FFTW_BACKWARD, FFTW_ESTIMATE);
-	this->forward_in_place_plan = fftw_plan_dft_1d(this->n, this->in, this->in, FFTW_FORWARD, FFTW_ESTIMATE);
-	this->backward_in_place_plan = fftw_plan_dft_1d(this->n, this->in, this->in, FFTW_BACKWARD, FFTW_ESTIMATE);
-	this->forward_real_plan = fftw_plan_dft_r2c_1d(this->n, this->in_out_real, (fftw_complex *) this->in_out_real, FFTW_ESTIMATE);
-	this->backward_real_plan = fftw_plan_dft_c2r_1d(this->n, (fftw_complex *) this->in_out_real, this->in_out_real, FFTW_ESTIMATE);
-#endif // SAPF_ACCELERATE
+	this->ready.store(true, std::memory_order_release);
 }
 
 FFT::~FFT() {
-#ifdef SAPF_ACCELERATE
-	vDSP_destroy_fftsetupD(this->setup);
+	if (this->ready)
+		vDSP_destroy_fftsetupD(this->setup);
+}
+
 #else
-	fftw_destroy_plan(forward_out_of_place_plan);
-	fftw_destroy_plan(backward_out_of_place_plan);
-	fftw_destroy_plan(forward_in_place_plan);
-	fftw_destroy_plan(backward_in_place_plan);
-	fftw_destroy_plan(forward_real_plan);
-	fftw_destroy_plan(backward_real_plan);
-	
-	fftw_free(this->in);
-	fftw_free(this->out);
-	fftw_free(this->in_out_real);
-#endif // SAPF_ACCELERATE
+
+void FFT::makePlans(Plans& plans, bool aligned) {
+	std::lock_guard<std::mutex> lock(gFFTPlanMutex);
+	if (plans.ready.load(std::memory_order_relaxed)) return;
+
+	// planning with FFTW_MEASURE overwrites the arrays, so plan on scratch arrays. The plans are
+	// then executed on other arrays, which fftw allows when the alignment matches, or always
+	// for FFTW_UNALIGNED plans.
+	unsigned flags = gPlanRigor | (aligned ? 0 : FFTW_UNALIGNED);
+	int n = (int)this->n;
+	Z* ri = SAPF_FFTW(alloc_real)(n);
+	Z* ii = SAPF_FFTW(alloc_real)(n);
+	Z* ro = SAPF_FFTW(alloc_real)(n);
+	Z* io = SAPF_FFTW(alloc_real)(n);
+
+	SAPF_FFTW(iodim) dim;
+	dim.n = n;
+	dim.is = 1;
+	dim.os = 1;
+	plans.out_of_place = SAPF_FFTW(plan_guru_split_dft)(1, &dim, 0, nullptr, ri, ii, ro, io, flags);
+	plans.in_place = SAPF_FFTW(plan_guru_split_dft)(1, &dim, 0, nullptr, ri, ii, ri, ii, flags);
+	plans.forward_real = SAPF_FFTW(plan_guru_split_dft_r2c)(1, &dim, 0, nullptr, ri, ro, io, flags);
+	plans.backward_real = SAPF_FFTW(plan_guru_split_dft_c2r)(1, &dim, 0, nullptr, ri, ii, ro, flags);
+	plans.forward_halfcomplex = SAPF_FFTW(plan_r2r_1d)(n, ri, ri, FFTW_R2HC, flags);
+	plans.backward_halfcomplex = SAPF_FFTW(plan_r2r_1d)(n, ri, ri, FFTW_HC2R, flags);
+
+	SAPF_FFTW(free)(ri);
+	SAPF_FFTW(free)(ii);
+	SAPF_FFTW(free)(ro);
+	SAPF_FFTW(free)(io);
+
+	if (gWisdomPath && !SAPF_FFTW(export_wisdom_to_filename)(gWisdomPath))
+		fprintf(stderr, "could not write fftw wisdom to '%s'\n", gWisdomPath);
+
+	plans.ready.store(true, std::memory_order_release);
 }
 
-void FFT::forward(double *inReal, double *inImag, double *outReal, double *outImag) {
+const FFT::Plans& FFT::plans(bool aligned) {
+	Plans& plans = aligned ? this->aligned_plans : this->unaligned_plans;
+	if (!plans.ready.load(std::memory_order_acquire))
+		makePlans(plans, aligned);
+	return plans;
+}
+
+void FFT::destroyPlans(Plans& plans) {
+	if (!plans.ready) return;
+	SAPF_FFTW(destroy_plan)(plans.out_of_place);
+	SAPF_FFTW(destroy_plan)(plans.in_place);
+	SAPF_FFTW(destroy_plan)(plans.forward_real);
+	SAPF_FFTW(destroy_plan)(plans.backward_real);
+	SAPF_FFTW(destroy_plan)(plans.forward_halfcomplex);
+	SAPF_FFTW(destroy_plan)(plans.backward_halfcomplex);
+	plans.ready = false;
+}
+
+FFT::~FFT() {
+	destroyPlans(this->aligned_plans);
+	destroyPlans(this->unaligned_plans);
+}
+
+#endif // SAPF_ACCELERATE
+
+void FFT::forward(Z *inReal, Z *inImag, Z *outReal, Z *outImag) {
 	double scale = 2. / this->n;
 #ifdef SAPF_ACCELERATE
+	if (!this->ready.load(std::memory_order_acquire)) makeSetup();
 	DSPDoubleSplitComplex in;
 	DSPDoubleSplitComplex out;
 	
@@ -81,21 +163,19 @@ void FFT::forward(double *inReal, double *inImag, double *outReal, double *outIm
 	vDSP_vsmulD(outReal, 1, &scale, outReal, 1, this->n);
 	vDSP_vsmulD(outImag, 1, &scale, outImag, 1, this->n);
 #else
+	bool aligned = isAligned(inReal) && isAligned(inImag) && isAligned(outReal) && isAligned(outImag);
+	SAPF_FFTW(execute_split_dft)(plans(aligned).out_of_place, inReal, inImag, outReal, outImag);
 	for(size_t i = 0; i < this->n; i++) {
-		this->in[i][0] = inReal[i];
-		this->in[i][1] = inImag[i];
-	}
-	fftw_execute(this->forward_out_of_place_plan);
-	for(size_t i = 0; i < this->n; i++) {
-		outReal[i] = this->out[i][0] * scale;
-		outImag[i] = this->out[i][1] * scale;
+		outReal[i] *= scale;
+		outImag[i] *= scale;
 	}
 #endif // SAPF_ACCELERATE
 }
 
-void FFT::backward(double *inReal, double *inImag, double *outReal, double *outImag) {
+void FFT::backward(Z *inReal, Z *inImag, Z *outReal, Z *outImag) {
 	double scale = .5;
 #ifdef SAPF_ACCELERATE
+	if (!this->ready.load(std::memory_order_acquire)) makeSetup();
 	DSPDoubleSplitComplex in;
 	DSPDoubleSplitComplex out;
 	
@@ -109,21 +189,19 @@ void FFT::backward(double *inReal, double *inImag, double *outReal, double *outI
 	vDSP_vsmulD(outReal, 1, &scale, outReal, 1, this->n);
 	vDSP_vsmulD(outImag, 1, &scale, outImag, 1, this->n);
 #else
+	bool aligned = isAligned(inReal) && isAligned(inImag) && isAligned(outReal) && isAligned(outImag);
+	SAPF_FFTW(execute_split_dft)(plans(aligned).out_of_place, inImag, inReal, outImag, outReal);
 	for(size_t i = 0; i < this->n; i++) {
-		this->in[i][0] = inReal[i];
-		this->in[i][1] = inImag[i];
-	}
-	fftw_execute(this->backward_out_of_place_plan);
-	for(size_t i = 0; i < this->n; i++) {
-		outReal[i] = this->out[i][0] * scale;
-		outImag[i] = this->out[i][1] * scale;
+		outReal[i] *= scale;
+		outImag[i] *= scale;
 	}
 #endif // SAPF_ACCELERATE
 }
 
-void FFT::forward_in_place(double *ioReal, double *ioImag) {
+void FFT::forward_in_place(Z *ioReal, Z *ioImag) {
 	double scale = 2. / this->n;
 #ifdef SAPF_ACCELERATE
+	if (!this->ready.load(std::memory_order_acquire)) makeSetup();
 	DSPDoubleSplitComplex io;
 	
 	io.realp = ioReal;
@@ -134,21 +212,19 @@ void FFT::forward_in_place(double *ioReal, double *ioImag) {
 	vDSP_vsmulD(ioReal, 1, &scale, ioReal, 1, this->n);
 	vDSP_vsmulD(ioImag, 1, &scale, ioImag, 1, this->n);
 #else
+	bool aligned = isAligned(ioReal) && isAligned(ioImag);
+	SAPF_FFTW(execute_split_dft)(plans(aligned).in_place, ioReal, ioImag, ioReal, ioImag);
 	for(size_t i = 0; i < this->n; i++) {
-		this->in[i][0] = ioReal[i];
-		this->in[i][1] = ioImag[i];
-	}
-	fftw_execute(this->forward_in_place_plan);
-	for(size_t i = 0; i < this->n; i++) {
-		ioReal[i] = this->in[i][0] * scale;
-		ioImag[i] = this->in[i][1] * scale;
+		ioReal[i] *= scale;
+		ioImag[i] *= scale;
 	}
 #endif // SAPF_ACCELERATE
 }
 
-void FFT::backward_in_place(double *ioReal, double *ioImag) {
+void FFT::backward_in_place(Z *ioReal, Z *ioImag) {
 	double scale = .5;
 #ifdef SAPF_ACCELERATE
+	if (!this->ready.load(std::memory_order_acquire)) makeSetup();
 	DSPDoubleSplitComplex io;
 	
 	io.realp = ioReal;
@@ -159,22 +235,20 @@ void FFT::backward_in_place(double *ioReal, double *ioImag) {
 	vDSP_vsmulD(ioReal, 1, &scale, ioReal, 1, this->n);
 	vDSP_vsmulD(ioImag, 1, &scale, ioImag, 1, this->n);
 #else
+	bool aligned = isAligned(ioReal) && isAligned(ioImag);
+	SAPF_FFTW(execute_split_dft)(plans(aligned).in_place, ioImag, ioReal, ioImag, ioReal);
 	for(size_t i = 0; i < this->n; i++) {
-		this->in[i][0] = ioReal[i];
-		this->in[i][1] = ioImag[i];
-	}
-	fftw_execute(this->backward_in_place_plan);
-	for(size_t i = 0; i < this->n; i++) {
-		ioReal[i] = this->in[i][0] * scale;
-		ioImag[i] = this->in[i][1] * scale;
+		ioReal[i] *= scale;
+		ioImag[i] *= scale;
 	}
 #endif // SAPF_ACCELERATE
 }
 
-void FFT::forward_real(double *inReal, double *outReal, double *outImag) {
+void FFT::forward_real(Z *inReal, Z *outReal, Z *outImag) {
 	double scale = 2. / n;
 	int n2 = this->n/2;
 #ifdef SAPF_ACCELERATE
+	if (!this->ready.load(std::memory_order_acquire)) makeSetup();
 	DSPDoubleSplitComplex in;
 	DSPDoubleSplitComplex out;
 
@@ -192,21 +266,21 @@ void FFT::forward_real(double *inReal, double *outReal, double *outImag) {
 	out.imagp[0] = 0.;
 	out.imagp[n2] = 0.;
 #else
-	for(size_t i = 0; i < this->n; i++) {
-		this->in_out_real[i] = inReal[i];
-	}
-	fftw_execute(this->forward_real_plan);
+	FFTWorkspace& ws = tFFTWorkspace;
+	ws.reserve(n2 + 1);
+	SAPF_FFTW(execute_split_dft_r2c)(plans(isAligned(inReal)).forward_real, inReal, ws.real, ws.imag);
 	for(size_t i = 0; i < n2; i++) {
-		outReal[i] = this->in_out_real[2*i] * scale;
-		outImag[i] = this->in_out_real[2*i+1] * scale;
+		outReal[i] = ws.real[i] * scale;
+		outImag[i] = ws.imag[i] * scale;
 	}
 #endif // SAPF_ACCELERATE
 }
 
-void FFT::backward_real(double *inReal, double *inImag, double *outReal) {
+void FFT::backward_real(Z *inReal, Z *inImag, Z *outReal) {
 	double scale = .5;
 	int n2 = this->n/2;
 #ifdef SAPF_ACCELERATE
+	if (!this->ready.load(std::memory_order_acquire)) makeSetup();
 	DSPDoubleSplitComplex in;
 	
 	in.realp = inReal;
@@ -221,13 +295,82 @@ void FFT::backward_real(double *inReal, double *inImag, double *outReal) {
 
 	vDSP_vsmulD(outReal, 1, &scale, outReal, 1, n);    
 #else
-	for(size_t i = 0; i < n2; i++) {
-		this->in_out_real[2*i] = inReal[i];
-		this->in_out_real[2*i+1] = inImag[i];
+	FFTWorkspace& ws = tFFTWorkspace;
+	ws.reserve(n2 + 1);
+	memcpy(ws.real, inReal, n2 * sizeof(Z));
+	memcpy(ws.imag, inImag, n2 * sizeof(Z));
+	// the callers have no nyquist bin.
+	ws.real[n2] = 0.;
+	ws.imag[n2] = 0.;
+	SAPF_FFTW(execute_split_dft_c2r)(plans(isAligned(outReal)).backward_real, ws.real, ws.imag, outReal);
+	for(size_t i = 0; i < this->n; i++) {
+		outReal[i] *= scale;
+	}
+#endif // SAPF_ACCELERATE
+}
+
+// fftw's halfcomplex order is r0, r1 ... r(n/2), i(n/2-1) ... i1. That is already the packed order
+// except that the imaginary parts are reversed.
+#ifndef SAPF_ACCELERATE
+static void reverseImaginary(Z* io, size_t n)
+{
+	Z* a = io + n/2 + 1;
+	Z* b = io + n - 1;
+	while (a < b) {
+		Z t = *a;
+		*a++ = *b;
+		*b-- = t;
 	}
-	fftw_execute(this->backward_real_plan);
+}
+#else
+// vDSP's real transforms take even and odd samples split, so they go through this scratch.
+static thread_local std::vector<double> tPackedScratch;
+#endif // SAPF_ACCELERATE
+
+void FFT::forward_real_packed(Z *io) {
+	double scale = 2. / this->n;
+#ifdef SAPF_ACCELERATE
+	int n2 = this->n/2;
+	if (!this->ready.load(std::memory_order_acquire)) makeSetup();
+	tPackedScratch.resize(this->n);
+	DSPDoubleSplitComplex split;
+	split.realp = tPackedScratch.data();
+	split.imagp = tPackedScratch.data() + n2;
+
+	vDSP_ctozD((DSPDoubleComplex*)io, 2, &split, 1, n2);
+	vDSP_fft_zripD(this->setup, &split, 1, this->log2n, FFT_FORWARD);
+
+	// vDSP's forward real transform is scaled by an extra factor of 2.
+	scale *= .5;
+	vDSP_vsmulD(tPackedScratch.data(), 1, &scale, io, 1, this->n);
+#else
+	SAPF_FFTW(execute_r2r)(plans(isAligned(io)).forward_halfcomplex, io, io);
+	reverseImaginary(io, this->n);
 	for(size_t i = 0; i < this->n; i++) {
-		outReal[i] = this->in_out_real[i] * scale;
+		io[i] *= scale;
+	}
+#endif // SAPF_ACCELERATE
+}
+
+void FFT::backward_real_packed(Z *io) {
+	double scale = .5;
+#ifdef SAPF_ACCELERATE
+	int n2 = this->n/2;
+	if (!this->ready.load(std::memory_order_acquire)) makeSetup();
+	tPackedScratch.assign(io, io + this->n);
+	DSPDoubleSplitComplex split;
+	split.realp = tPackedScratch.data();
+	split.imagp = tPackedScratch.data() + n2;
+
+	vDSP_fft_zripD(this->setup, &split, 1, this->log2n, FFT_INVERSE);
+	vDSP_ztocD(&split, 1, (DSPDoubleComplex*)io, 2, n2);
+
+	vDSP_vsmulD(io, 1, &scale, io, 1, this->n);
+#else
+	reverseImaginary(io, this->n);
+	SAPF_FFTW(execute_r2r)(plans(isAligned(io)).backward_halfcomplex, io, io);
+	for(size_t i = 0; i < this->n; i++) {
+		io[i] *= scale;
 	}
 #endif // SAPF_ACCELERATE
 }
@@ -238,49 +381,79 @@ FFT ffts[kMaxFFTLogSize+1];
 
 void initFFT()
 {
+#ifndef SAPF_ACCELERATE
+	{
+		std::lock_guard<std::mutex> lock(gFFTPlanMutex);
+		static bool wisdomLoaded = false;
+		if (!wisdomLoaded) {
+			wisdomLoaded = true;
+			const char* wisdomPath = getenv("SAPF_FFTW_WISDOM");
+			if (wisdomPath && strlen(wisdomPath)) {
+				gWisdomPath = wisdomPath;
+				const char* rigor = getenv("SAPF_FFTW_PLANNING");
+				gPlanRigor = rigor && !strcmp(rigor, "patient") ? FFTW_PATIENT : FFTW_MEASURE;
+				// a missing file just means there is no wisdom yet.
+				SAPF_FFTW(import_wisdom_from_filename)(gWisdomPath);
+			}
+		}
+	}
+#endif // SAPF_ACCELERATE
 	for (int i = kMinFFTLogSize; i <= kMaxFFTLogSize; ++i) {
                 ffts[i].init(i);
 	}
 }
 
-void fft(int n, double* inReal, double* inImag, double* outReal, double* outImag)
+void fft(int n, Z* inReal, Z* inImag, Z* outReal, Z* outImag)
 {
 	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
         ffts[log2n].forward(inReal, inImag, outReal, outImag);
 }
 
-void ifft(int n, double* inReal, double* inImag, double* outReal, double* outImag)
+void ifft(int n, Z* inReal, Z* inImag, Z* outReal, Z* outImag)
 {
 	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
         ffts[log2n].backward(inReal, inImag, outReal, outImag);
 }
 
-void fft(int n, double* ioReal, double* ioImag)
+void fft(int n, Z* ioReal, Z* ioImag)
 {
 	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
         ffts[log2n].forward_in_place(ioReal, ioImag);
 }
 
-void ifft(int n, double* ioReal, double* ioImag)
+void ifft(int n, Z* ioReal, Z* ioImag)
 {
 	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
         ffts[log2n].backward_in_place(ioReal, ioImag);
 }
 
 
-void rfft(int n, double* inReal, double* outReal, double* outImag)
+void rfft(int n, Z* inReal, Z* outReal, Z* outImag)
 {
 	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
         ffts[log2n].forward_real(inReal, outReal, outImag);
 }
 
 
-void rifft(int n, double* inReal, double* inImag, double* outReal)
+void rifft(int n, Z* inReal, Z* inImag, Z* outReal)
 {
 	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
         ffts[log2n].backward_real(inReal, inImag, outReal);
 }
 
+void rfft_packed(int n, Z* io)
+{
+	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
+        ffts[log2n].forward_real_packed(io);
+}
+
+
+void rifft_packed(int n, Z* io)
+{
+	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
+        ffts[log2n].backward_real_packed(io);
+}
+
 
 #define USE_VFORCE 1
 
@@ -44,7 +44,7 @@ double elapsedTime()
 #else
         return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
             std::chrono::steady_clock::now().time_since_epoch()
-        ).count() / 10e9;
+        ).count() * 1e-9;
 #endif // SAPF_MACH_TIME
 }
 
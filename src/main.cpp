@@ -23,6 +23,8 @@
 #include <algorithm>
 #include <sys/stat.h>
 #include "primes.hpp"
+#include "Play.hpp"
+#include "SimdKernels.hpp"
 #include <complex>
 #ifdef SAPF_DISPATCH
 #include <dispatch/dispatch.h>
@@ -123,7 +125,11 @@ const char* gVersionString = "0.1.21";
 
 static void usage()
 {
-	fprintf(stdout, "sapf [-r sample-rate][-p prelude-file]\n");
+	fprintf(stdout, "sapf [-r sample-rate][-p prelude-file][-d audio-device][-b buffer-frames][-R priority][-c cpu]\n");
+	fprintf(stdout, "    -d  audio output device, by id or by a name or part of one\n");
+	fprintf(stdout, "    -b  frames per audio callback\n");
+	fprintf(stdout, "    -R  realtime scheduling priority of the audio thread\n");
+	fprintf(stdout, "    -c  cpu to pin the audio thread to\n");
 	fprintf(stdout, "\n");
 	fprintf(stdout, "sapf [-h]\n");
 	fprintf(stdout, "    print this help\n");
@@ -141,6 +147,9 @@ int main (int argc, const char * argv[])
 	post("A tool for the expression of sound as pure form.\n");	
 	post("------------------------------------------------\n");	
 	post("--- version %s\n", gVersionString);
+#ifndef SAPF_ACCELERATE
+	post("--- simd %s\n", simdKernels().name);
+#endif
 	
 	for (int i = 1; i < argc;) {
 		int c = argv[i][0];
@@ -161,6 +170,38 @@ int main (int argc, const char * argv[])
 					vm.prelude_file = argv[i+1];
 					i += 2;
 				} break;
+				case 'd' : {
+					if (argc <= i+1) { post("expected audio device after -d\n"); return 1; }
+					PlayConfig config = playConfig();
+					config.device = argv[i+1];
+					setPlayConfig(config);
+					i += 2;
+				} break;
+				case 'b' : {
+					if (argc <= i+1) { post("expected buffer frames after -b\n"); return 1; }
+					int frames = atoi(argv[i+1]);
+					if (frames < 16 || frames > 8192) { post("buffer frames out of range.\n"); return 1; }
+					PlayConfig config = playConfig();
+					config.bufferFrames = frames;
+					setPlayConfig(config);
+					i += 2;
+				} break;
+				case 'R' : {
+					if (argc <= i+1) { post("expected priority after -R\n"); return 1; }
+					int priority = atoi(argv[i+1]);
+					if (priority < 0 || priority > 99) { post("priority out of range.\n"); return 1; }
+					PlayConfig config = playConfig();
+					config.priority = priority;
+					setPlayConfig(config);
+					i += 2;
+				} break;
+				case 'c' : {
+					if (argc <= i+1) { post("expected cpu after -c\n"); return 1; }
+					PlayConfig config = playConfig();
+					config.cpu = atoi(argv[i+1]);
+					setPlayConfig(config);
+					i += 2;
+				} break;
 				case 'h' : {
 					usage();
 					exit(0);
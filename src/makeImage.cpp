@@ -16,21 +16,121 @@
 
 #include "makeImage.hpp"
 #include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <zlib.h>
+
+// An RGBA bitmap written out as a PNG.
 
 struct Bitmap {
-	// TODO
+	int width;
+	int height;
+	int bytesPerRow;
+	unsigned char* data;
 };
 
 Bitmap* createBitmap(int width, int height) {
-	// TODO
 	Bitmap *bitmap = (Bitmap *) calloc(1, sizeof(Bitmap));
+	bitmap->width = width;
+	bitmap->height = height;
+	bitmap->bytesPerRow = 4 * width;
+	bitmap->data = (unsigned char *) calloc((size_t)bitmap->bytesPerRow * height, 1);
 	return bitmap;
 }
 
+void setPixel(Bitmap* bitmap, int x, int y, int r, int g, int b, int a)
+{
+	size_t index = (size_t)bitmap->bytesPerRow * y + 4 * x;
+	unsigned char* data = bitmap->data;
+	
+	data[index+0] = r;
+	data[index+1] = g;
+	data[index+2] = b;
+	data[index+3] = a;
+}
+
+void fillRect(Bitmap* bitmap, int x, int y, int width, int height, int r, int g, int b, int a)
+{
+	unsigned char* data = bitmap->data;
+	for (int j = y; j < y + height; ++j) {
+		size_t index = (size_t)bitmap->bytesPerRow * j + 4 * x;
+		for (int i = x; i < x + width; ++i) {
+			data[index+0] = r;
+			data[index+1] = g;
+			data[index+2] = b;
+			data[index+3] = a;
+			index += 4;
+		}
+	}
+}
+
+static void putBigEndian32(std::vector<unsigned char>& out, uint32_t x)
+{
+	out.push_back(x >> 24);
+	out.push_back(x >> 16);
+	out.push_back(x >> 8);
+	out.push_back(x);
+}
+
+static bool writeChunk(FILE* file, const char* type, const unsigned char* data, size_t size)
+{
+	std::vector<unsigned char> header;
+	putBigEndian32(header, (uint32_t)size);
+	header.insert(header.end(), type, type + 4);
+
+	uLong crc = crc32(0, (const Bytef*)type, 4);
+	if (size) crc = crc32(crc, data, (uInt)size);
+	std::vector<unsigned char> trailer;
+	putBigEndian32(trailer, (uint32_t)crc);
+
+	return fwrite(header.data(), 1, header.size(), file) == header.size()
+		&& (!size || fwrite(data, 1, size, file) == size)
+		&& fwrite(trailer.data(), 1, trailer.size(), file) == trailer.size();
+}
+
 void writeBitmap(Bitmap* bitmap, const char *path) {
-	// TODO
+	// each row is preceded by its filter type, 0 for none.
+	size_t rowSize = (size_t)bitmap->bytesPerRow + 1;
+	std::vector<unsigned char> raw(rowSize * bitmap->height);
+	for (int j = 0; j < bitmap->height; ++j) {
+		unsigned char* row = raw.data() + rowSize * j;
+		row[0] = 0;
+		memcpy(row + 1, bitmap->data + (size_t)bitmap->bytesPerRow * j, bitmap->bytesPerRow);
+	}
+
+	uLongf compressedSize = compressBound((uLong)raw.size());
+	std::vector<unsigned char> compressed(compressedSize);
+	if (compress2(compressed.data(), &compressedSize, raw.data(), (uLong)raw.size(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+		fprintf(stderr, "could not compress image '%s'\n", path);
+		return;
+	}
+
+	std::vector<unsigned char> header;
+	putBigEndian32(header, bitmap->width);
+	putBigEndian32(header, bitmap->height);
+	header.push_back(8); // bits per sample
+	header.push_back(6); // RGBA
+	header.push_back(0); // deflate
+	header.push_back(0); // adaptive filtering
+	header.push_back(0); // not interlaced
+
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		fprintf(stderr, "could not open '%s' for writing\n", path);
+		return;
+	}
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	bool ok = fwrite(signature, 1, sizeof(signature), file) == sizeof(signature)
+		&& writeChunk(file, "IHDR", header.data(), header.size())
+		&& writeChunk(file, "IDAT", compressed.data(), compressedSize)
+		&& writeChunk(file, "IEND", nullptr, 0);
+	if (fclose(file) != 0 || !ok)
+		fprintf(stderr, "could not write image '%s'\n", path);
 }
 
 void freeBitmap(Bitmap* bitmap) {
-	// TODO
+	free(bitmap->data);
+	free(bitmap);
 }
@@ -0,0 +1,7 @@
+// built with the flags for avx2 only. See SimdKernelsImpl.hpp.
+#include "SimdKernelsImpl.hpp"
+
+const SimdKernels* simdKernelsAvx2() {
+    static const SimdKernels kernels = makeSimdKernels<xsimd::avx2>("avx2");
+    return &kernels;
+}
@@ -0,0 +1,7 @@
+// built with the flags for avx512f only. See SimdKernelsImpl.hpp.
+#include "SimdKernelsImpl.hpp"
+
+const SimdKernels* simdKernelsAvx512() {
+    static const SimdKernels kernels = makeSimdKernels<xsimd::avx512f>("avx512f");
+    return &kernels;
+}
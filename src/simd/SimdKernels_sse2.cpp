@@ -0,0 +1,7 @@
+// built with the flags for sse2 only. See SimdKernelsImpl.hpp.
+#include "SimdKernelsImpl.hpp"
+
+const SimdKernels* simdKernelsSse2() {
+    static const SimdKernels kernels = makeSimdKernels<xsimd::sse2>("sse2");
+    return &kernels;
+}
@@ -0,0 +1,7 @@
+// built with the flags for sse4_2 only. See SimdKernelsImpl.hpp.
+#include "SimdKernelsImpl.hpp"
+
+const SimdKernels* simdKernelsSse4_2() {
+    static const SimdKernels kernels = makeSimdKernels<xsimd::sse4_2>("sse4_2");
+    return &kernels;
+}
@@ -17,9 +17,18 @@
 #ifndef __ArrHelpers_h__
 #define __ArrHelpers_h__
 
+#include "Sample.hpp"
+
+// the relative error allowed between computed samples. float samples only carry about 7 digits.
+#if SAMPLE_IS_DOUBLE
+const double kSampleEpsilon = 1e-9;
+#else
+const double kSampleEpsilon = 1e-5;
+#endif
+
 #define CHECK_ARR(expected, actual, n) \
 	do { \
-		LOOP(i,n) { CHECK(actual[i] == doctest::Approx(expected[i]).epsilon(1e-9)); } \
+		LOOP(i,n) { CHECK(actual[i] == doctest::Approx(expected[i]).epsilon(kSampleEpsilon)); } \
 	} while (0)
 
 #endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "doctest.h"
+#include "BlockSchedule.hpp"
+#include "MathOps.hpp"
+#include <vector>
+
+extern BinaryOp* gBinaryOpPtr_plus;
+extern BinaryOp* gBinaryOpPtr_mul;
+extern UnaryOp* gUnaryOpPtr_neg;
+
+namespace {
+// a finite signal of consecutive numbers, one block per pull. it doesn't report its inputs.
+struct CountGen : public Gen {
+    Z mValue{0.};
+    int64_t mRemaining;
+
+    CountGen(Thread& th, const int64_t inLength) : Gen(th, itemTypeZ, true), mRemaining{inLength} {}
+
+    const char* TypeName() const override { return "CountGen"; }
+
+    void pull(Thread& th) override {
+        if (mRemaining <= 0) {
+            end();
+            return;
+        }
+        const int n = static_cast<int>(std::min(static_cast<int64_t>(mBlockSize), mRemaining));
+        Z* out = mOut->fulfillz(n);
+        for (int i = 0; i < n; ++i) {
+            out[i] = mValue;
+            mValue += 1.;
+        }
+        mRemaining -= n;
+        mOut = mOut->nextp();
+    }
+};
+}
+
+TEST_CASE("BlockSchedule computes the same signals as lazy pulling") {
+    Thread th;
+    constexpr int64_t length{5000};
+    constexpr int readFrames{300};
+
+    ZIn in[2];
+    {
+        // shared is read by both channels, so it stays a generator of its own.
+        V count = new List(new CountGen(th, length));
+        V shared = count.binaryOp(th, gBinaryOpPtr_mul, .5);
+        count = V();
+        in[0].set(shared.binaryOp(th, gBinaryOpPtr_plus, 1.));
+        in[1].set(shared.unaryOp(th, gUnaryOpPtr_neg));
+    }
+
+    BlockSchedule schedule{in, 2};
+    // the two channels, shared and the count.
+    CHECK(schedule.numNodes() == 4);
+    CHECK(schedule.numOpaqueNodes() == 1);
+
+    std::vector<Z> out0(readFrames), out1(readFrames);
+    int64_t frame = 0;
+    bool done = false;
+    while (!done) {
+        schedule.prepare(th, readFrames);
+        if (frame + readFrames <= length) {
+            // everything the reads need has been computed ahead of them.
+            CHECK(!in[0].mList->isThunk());
+            CHECK(!in[1].mList->isThunk());
+        }
+
+        int n0 = readFrames, n1 = readFrames;
+        done = in[0].fill(th, n0, out0.data(), 1);
+        done = in[1].fill(th, n1, out1.data(), 1) || done;
+        REQUIRE(n0 == n1);
+        for (int i = 0; i < n0; ++i) {
+            const Z x = static_cast<Z>(frame + i);
+            REQUIRE(out0[i] == doctest::Approx(x * .5 + 1.));
+            REQUIRE(out1[i] == doctest::Approx(-x * .5));
+        }
+        frame += n0;
+    }
+    CHECK(frame == length);
+}
+
+TEST_CASE("BlockSchedule leaves generators it doesn't know to be pulled lazily") {
+    Thread th;
+    ZIn in[1];
+    BlockSchedule schedule{in, 1};
+    CHECK(schedule.numNodes() == 0);
+
+    // a signal set after the schedule was built is not in it, but still plays.
+    in[0].set(V(new List(new CountGen(th, 100))));
+    schedule.prepare(th, 64);
+    CHECK(in[0].mList->isThunk());
+    Z out[64];
+    int n = 64;
+    in[0].fill(th, n, out, 1);
+    CHECK(n == 64);
+    CHECK(out[63] == 63.);
+}
@@ -0,0 +1,55 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "doctest.h"
+#include "ChannelWorkers.hpp"
+#include "ErrorCodes.hpp"
+#include <vector>
+
+TEST_CASE("ChannelWorkers runs every channel once per block") {
+    Thread th;
+    ChannelWorkers workers{th, 3};
+    constexpr int numChannels{16};
+    constexpr int numBlocks{100};
+    std::vector<int> counts(numChannels, 0);
+    const ChannelWorkers::ChannelFunc func = [&](Thread&, const int channel) { ++counts[channel]; };
+
+    for (int block = 0; block < numBlocks; ++block) {
+        workers.run(th, numChannels, func);
+        // the join means every channel has been filled before the next block starts.
+        for (int i = 0; i < numChannels; ++i) {
+            REQUIRE(counts[i] == block + 1);
+        }
+    }
+}
+
+TEST_CASE("ChannelWorkers rethrows an error from a worker") {
+    Thread th;
+    ChannelWorkers workers{th, 2};
+    std::vector<int> counts(8, 0);
+    const ChannelWorkers::ChannelFunc func = [&](Thread&, const int channel) {
+        ++counts[channel];
+        if (channel == 5) throw errOutOfRange;
+    };
+
+    CHECK_THROWS_AS(workers.run(th, 8, func), int);
+    // the other channels still ran, and the pool is usable afterwards.
+    for (int i = 0; i < 8; ++i) {
+        CHECK(counts[i] == 1);
+    }
+    workers.run(th, 4, [&](Thread&, const int channel) { ++counts[channel]; });
+    CHECK(counts[0] == 2);
+}
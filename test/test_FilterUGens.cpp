@@ -0,0 +1,60 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Object.hpp"
+#include "VM.hpp"
+#include "doctest.h"
+#include "ArrHelpers.hpp"
+#include "Testability.hpp"
+#include "dsp.hpp"
+#include <vector>
+
+static P<List> zlist(std::vector<Z> const& values)
+{
+	P<List> list = new List(itemTypeZ, values.size());
+	list->mArray->setSize(values.size());
+	LOOP(i, (int)values.size()) { list->mArray->z()[i] = values[i]; }
+	return list;
+}
+
+TEST_CASE("conv matches direct convolution") {
+	Thread th;
+	initFFT();
+
+	int inLength = 1000;
+	int irLength = 0;
+	SUBCASE("impulse response shorter than a block") { irLength = 5; }
+	SUBCASE("impulse response of several blocks") { irLength = 700; }
+
+	std::vector<Z> in(inLength), ir(irLength);
+	LOOP(i,inLength) { in[i] = sin(i * .21) + .5 * cos(i * .05); }
+	LOOP(i,irLength) { ir[i] = exp(-i * .01) * cos(i * .7); }
+
+	int outLength = inLength + irLength - 1;
+	std::vector<Z> expected(outLength, 0.);
+	LOOP(i,inLength) {
+		for (int j = 0; j < irLength; ++j) expected[i + j] += in[i] * ir[j];
+	}
+
+	th.push(zlist(in));
+	th.push(zlist(ir));
+	conv_(th, nullptr);
+	P<List> out = th.popZList("conv");
+	out = out->pack(th);
+
+	REQUIRE(out->mArray->size() == outLength);
+	CHECK_ARR(expected, out->mArray->z(), outLength);
+}
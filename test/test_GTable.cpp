@@ -0,0 +1,126 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Object.hpp"
+#include "VM.hpp"
+#include "doctest.h"
+#include "symbol.hpp"
+
+// a key with a chosen hash, to make keys collide.
+class HashKey : public Object
+{
+	int mHash;
+public:
+	HashKey(int inHash) : mHash(inHash) {}
+	virtual const char* TypeName() const override { return "HashKey"; }
+	virtual int Hash() const override { return mHash; }
+};
+
+TEST_CASE("GTable") {
+	SUBCASE("keys with the same hash are kept apart") {
+		V a = new HashKey(7);
+		V b = new HashKey(7);
+		P<GTable> table = new GTable();
+		CHECK(table->putImpure(a, 1.));
+		CHECK(table->putImpure(b, 2.));
+		CHECK(!table->putImpure(a, 3.));
+		V value;
+		CHECK(table->getInner(a, value));
+		CHECK(value.f == 1.);
+		CHECK(table->getInner(b, value));
+		CHECK(value.f == 2.);
+		CHECK(!table->getInner(new HashKey(7), value));
+	}
+
+	SUBCASE("keys sharing leading hash bits") {
+		P<GTable> table = new GTable();
+		std::vector<V> keys;
+		for (int i = 0; i < 100; ++i) {
+			keys.push_back(new HashKey(i << 25));
+			CHECK(table->putImpure(keys.back(), (double)i));
+		}
+		for (int i = 0; i < 100; ++i) {
+			V value;
+			CHECK(table->getInner(keys[i], value));
+			CHECK(value.f == i);
+		}
+	}
+
+	SUBCASE("pure puts leave the old table alone") {
+		V x = getsym("x");
+		V y = getsym("y");
+		P<GTable> t1 = new GTable();
+		P<GTable> t2 = t1->putPure(x, x.Hash(), 1.);
+		P<GTable> t3 = t2->putPure(y, y.Hash(), 2.);
+		P<GTable> t4 = t3->putPure(x, x.Hash(), 3.);
+		V value;
+		CHECK(!t1->getInner(x, value));
+		CHECK(!t2->getInner(y, value));
+		CHECK(t3->getInner(x, value));
+		CHECK(value.f == 1.);
+		CHECK(t4->getInner(x, value));
+		CHECK(value.f == 3.);
+	}
+
+	SUBCASE("impure puts are seen by tables sharing the tree") {
+		// a and b differ in the second five bits of the hash, so the root's slot 0 is a branch.
+		V a = new HashKey(0);
+		V b = new HashKey(1 << 5);
+		P<GTable> t1 = new GTable();
+		t1->putImpure(a, 1.);
+		t1->putImpure(b, 2.);
+		// t2 gets a copy of the root, but shares the branch in slot 0 with t1.
+		V c = new HashKey(1);
+		P<GTable> t2 = t1->putPure(c, c.Hash(), 3.);
+		V value;
+		CHECK(!t1->getInner(c, value));
+
+		// lands in the shared branch.
+		V d = new HashKey(2 << 5);
+		CHECK(t1->putImpure(d, 4.));
+		CHECK(t1->getInner(d, value));
+		CHECK(value.f == 4.);
+		CHECK(t2->getInner(d, value));
+		CHECK(value.f == 4.);
+
+		// lands in t1's root, which the pure put copied.
+		V e = new HashKey(3);
+		CHECK(t1->putImpure(e, 5.));
+		CHECK(t1->getInner(e, value));
+		CHECK(value.f == 5.);
+		CHECK(!t2->getInner(e, value));
+		CHECK(t2->getInner(c, value));
+		CHECK(value.f == 3.);
+	}
+
+	SUBCASE("sorted is in definition order") {
+		P<GTable> table = new GTable();
+		char name[32];
+		for (int i = 0; i < 1000; ++i) {
+			snprintf(name, sizeof(name), "gtable_def%d", i);
+			table->putImpure(getsym(name), (double)i);
+		}
+		// rebinding keeps the original position.
+		V first = getsym("gtable_def0");
+		table = table->putPure(first, first.Hash(), -1.);
+		std::vector<P<TreeEntry> > entries = table->sorted();
+		REQUIRE(entries.size() == 1000);
+		CHECK(entries[0]->mValue.f == -1.);
+		for (int i = 1; i < 1000; ++i) {
+			CHECK(entries[i]->mValue.f == i);
+		}
+	}
+}
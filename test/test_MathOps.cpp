@@ -15,23 +15,27 @@
 //    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "Object.hpp"
+#include "MathOps.hpp"
 #include "doctest.h"
+#include "ArrHelpers.hpp"
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
 #include <ZArr.hpp>
 
 using std::array;
 
-#define CHECK_ARR(expected, actual, n) \
-	do { \
-		LOOP(i,n) { CHECK(out[i] == doctest::Approx(expected[i]).epsilon(1e-9)); } \
-	} while (0)
-
 // ensure it's long enough to exceed the max possible vector batch size (16 with an AVX512 int32)
 const int test_n = 18;
 void check_unop_loopz(UnaryOp& op, const array<Z, 3> inarr) {
-	double out[test_n];
-	double expected[test_n];
-	double in[test_n];
+	Z out[test_n];
+	Z expected[test_n];
+	Z in[test_n];
 	LOOP(i,test_n) { in[i] = inarr[i % 3]; expected[i] = op.op(in[i]); }
 	op.loopz(test_n, in, 1, out);
 	CHECK_ARR(expected, out, test_n);
@@ -173,10 +177,10 @@ extern BinaryOp* gBinaryOpPtr_max;
 extern BinaryOp* gBinaryOpPtr_hypot;
 
 void check_binop_loopz(BinaryOp& op, const array<Z, 3> aarr, int astride, const array<Z, 3> barr, int bstride) {
-	double out[test_n];
-	double expected[test_n];
-	double a[test_n];
-	double b[test_n];
+	Z out[test_n];
+	Z expected[test_n];
+	Z a[test_n];
+	Z b[test_n];
 	LOOP(i,test_n) { a[i] = aarr[i % 3]; b[i] = barr[i % 3]; expected[i] = op.op(a[i], b[i]); }
 	op.loopz(3, a, 1, b, 1, out);
 	CHECK_ARR(expected, out, 3);
@@ -260,4 +264,268 @@ TEST_CASE("atan2") {
 	SUBCASE("poz / neg") {
 		check_binop_loopz(*gBinaryOpPtr_atan2, {1, 2, 3}, 1, {-4, -5, -6}, 0);
 	}
-}
\ No newline at end of file
+}
+
+static V zlist(std::vector<Z> const& values)
+{
+	P<List> list = new List(itemTypeZ, values.size());
+	list->mArray->setSize(values.size());
+	LOOP(i, (int)values.size()) { list->mArray->z()[i] = values[i]; }
+	return V(list());
+}
+
+TEST_CASE("fused signal math") {
+	Thread th;
+	const int n = 1000;
+	std::vector<Z> a(n), b(n), c(n);
+	LOOP(i,n) { a[i] = sin(i * .1); b[i] = i * .01; c[i] = cos(i * .03); }
+
+	SUBCASE("a chain of operators becomes one generator") {
+		// (a + b) * c + .5, with the intermediate lists dropped before anything is computed.
+		V r = zlist(a).binaryOp(th, gBinaryOpPtr_plus, zlist(b))
+			.binaryOp(th, gBinaryOpPtr_mul, zlist(c))
+			.binaryOp(th, gBinaryOpPtr_plus, .5)
+			.unaryOp(th, gUnaryOpPtr_neg);
+		List* list = (List*)r.o();
+		REQUIRE(list->isThunk());
+		P<Gen> gen = list->mGen;
+		P<List> outList = list->pack(th);
+
+		FusedZGen* fused = dynamic_cast<FusedZGen*>(gen());
+		REQUIRE(fused);
+		CHECK(fused->numSteps() == 4);
+		CHECK(fused->numInputs() == 4);
+
+		REQUIRE(outList->mArray->size() == n);
+		std::vector<Z> expected(n);
+		LOOP(i,n) { expected[i] = -((a[i] + b[i]) * c[i] + .5); }
+		Z* out = outList->mArray->z();
+		CHECK_ARR(expected, out, n);
+	}
+
+	SUBCASE("a shared intermediate is not absorbed") {
+		V sum = zlist(a).binaryOp(th, gBinaryOpPtr_plus, zlist(b));
+		V r = sum.binaryOp(th, gBinaryOpPtr_mul, sum);
+		List* list = (List*)r.o();
+		P<Gen> gen = list->mGen;
+		P<List> outList = list->pack(th);
+
+		FusedZGen* fused = dynamic_cast<FusedZGen*>(gen());
+		REQUIRE(fused);
+		CHECK(fused->numSteps() == 1);
+
+		REQUIRE(outList->mArray->size() == n);
+		std::vector<Z> expected(n);
+		LOOP(i,n) { expected[i] = (a[i] + b[i]) * (a[i] + b[i]); }
+		Z* out = outList->mArray->z();
+		CHECK_ARR(expected, out, n);
+	}
+
+	SUBCASE("the result ends with the shortest input") {
+		std::vector<Z> shortB(b.begin(), b.begin() + 700);
+		V r = zlist(a).binaryOp(th, gBinaryOpPtr_minus, zlist(shortB))
+			.binaryOp(th, gBinaryOpPtr_mul, zlist(c));
+		List* list = (List*)r.o();
+		P<List> outList = list->pack(th);
+
+		REQUIRE(outList->mArray->size() == 700);
+		std::vector<Z> expected(700);
+		LOOP(i,700) { expected[i] = (a[i] - shortB[i]) * c[i]; }
+		Z* out = outList->mArray->z();
+		CHECK_ARR(expected, out, 700);
+	}
+}
+
+TEST_CASE("math on unshared packed signals in place") {
+	Thread th;
+	const int n = 10000;
+	std::vector<Z> a(n), b(n);
+	LOOP(i,n) { a[i] = i * .25; b[i] = 1. - i; }
+
+	SUBCASE("unary op reuses the array") {
+		V x = zlist(a);
+		Z* array = ((List*)x.o())->mArray->z();
+		REQUIRE(unaryOpInPlace(th, gUnaryOpPtr_neg, x));
+		CHECK(((List*)x.o())->mArray->z() == array);
+		std::vector<Z> expected(n);
+		LOOP(i,n) { expected[i] = -a[i]; }
+		Z* out = array;
+		CHECK_ARR(expected, out, n);
+	}
+
+	SUBCASE("binary op reuses the unshared operand") {
+		V x = zlist(a);
+		V y = zlist(b);
+		V keep = x; // x is shared, so the result goes into y.
+		V r;
+		REQUIRE(binaryOpInPlace(th, gBinaryOpPtr_minus, x, y, r));
+		CHECK(r.o() == y.o());
+		std::vector<Z> expected(n);
+		LOOP(i,n) { expected[i] = a[i] - b[i]; }
+		Z* out = ((List*)r.o())->mArray->z();
+		CHECK_ARR(expected, out, n);
+		CHECK(((List*)x.o())->mArray->z()[3] == a[3]);
+	}
+
+	SUBCASE("binary op with a real") {
+		V x = zlist(a);
+		V r;
+		REQUIRE(binaryOpInPlace(th, gBinaryOpPtr_div, 1., x, r));
+		CHECK(r.o() == x.o());
+		std::vector<Z> expected(n);
+		LOOP(i,n) { expected[i] = 1. / a[i]; }
+		Z* out = ((List*)r.o())->mArray->z();
+		CHECK_ARR(expected, out, n);
+	}
+
+	SUBCASE("shared or mismatched signals are left alone") {
+		V x = zlist(a);
+		V keep = x;
+		V r;
+		CHECK(!unaryOpInPlace(th, gUnaryOpPtr_neg, x));
+		CHECK(!binaryOpInPlace(th, gBinaryOpPtr_plus, x, 1., r));
+		std::vector<Z> shorter(b.begin(), b.begin() + 100);
+		CHECK(!binaryOpInPlace(th, gBinaryOpPtr_plus, zlist(a), zlist(shorter), r));
+		CHECK(((List*)x.o())->mArray->z()[5] == a[5]);
+	}
+}
+
+TEST_CASE("Z arrays are aligned and padded for SIMD") {
+	for (int cap : {1, 7, 8, 100, 1024}) {
+		P<Array> array = new Array(itemTypeZ, cap);
+		CHECK(isPoolAligned(array->z()));
+		CHECK(isPoolAligned(array->z() + array->capacity()));
+	}
+}
+
+TEST_CASE("ops give the same results on aligned and unaligned buffers") {
+	// not a multiple of any batch size, so the tails are covered too.
+	const int n = 67;
+	P<Array> aligned = new Array(itemTypeZ, n);
+	P<Array> unaligned = new Array(itemTypeZ, n + 1);
+	P<Array> alignedB = new Array(itemTypeZ, n);
+	P<Array> unalignedB = new Array(itemTypeZ, n + 1);
+	LOOP(i,n) {
+		aligned->z()[i] = unaligned->z()[i + 1] = .5 + .4 * sin(i * .3);
+		alignedB->z()[i] = unalignedB->z()[i + 1] = .5 + .4 * cos(i * .7);
+	}
+	P<Array> alignedOut = new Array(itemTypeZ, n);
+	P<Array> unalignedOut = new Array(itemTypeZ, n + 1);
+	Z* out = unalignedOut->z() + 1;
+	Z* expected = alignedOut->z();
+
+	auto check = [&](const char* name) {
+		CAPTURE(std::string(name));
+		LOOP(i,n) {
+			if (std::isnan(expected[i])) CHECK(std::isnan(out[i]));
+			else CHECK(out[i] == doctest::Approx(expected[i]).epsilon(kSampleEpsilon));
+		}
+	};
+
+	for (UnaryOp* op : mathUnaryOps()) {
+		op->loopz(n, aligned->z(), 1, alignedOut->z());
+		op->loopz(n, unaligned->z() + 1, 1, out);
+		check(op->Name());
+	}
+	for (BinaryOp* op : mathBinaryOps()) {
+		op->loopz(n, aligned->z(), 1, alignedB->z(), 1, alignedOut->z());
+		op->loopz(n, unaligned->z() + 1, 1, unalignedB->z() + 1, 1, out);
+		check(op->Name());
+	}
+}
+
+// the difference between what loopz gives and what op gives, relative to the size of the
+// result once it is above 1. NaN and infinities have to match exactly.
+static Z opError(Z expected, Z actual)
+{
+	if (std::isnan(expected)) return std::isnan(actual) ? 0. : INFINITY;
+	if (std::isinf(expected)) return actual == expected ? 0. : INFINITY;
+	return std::fabs(actual - expected) / std::max<Z>(1., std::fabs(expected));
+}
+
+static double nanosPerFrame(std::function<void()> const& run, int n)
+{
+	const int reps = 200;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < reps; ++i) run();
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / ((double)reps * n);
+}
+
+// every op, through loopz with contiguous, strided and constant inputs, against its scalar op.
+// the vector kernels must stay within kOpTolerance of libm. With SAPF_MATHOPS_REPORT set, the
+// worst error and the speed of each op are printed too.
+TEST_CASE("every op matches its scalar code for any stride") {
+	const int n = 1027;
+	const int stride = 3;
+	const Z kOpTolerance = kSampleEpsilon;
+	const bool report = getenv("SAPF_MATHOPS_REPORT") != nullptr;
+
+	std::vector<Z> a(n), b(n), spreadA(n * stride), spreadB(n * stride), out(n);
+	LOOP(i,n) {
+		a[i] = spreadA[i * stride] = 4. * sin(i * .37 + .1);
+		b[i] = spreadB[i * stride] = 3. * cos(i * .53) + .1;
+	}
+	const int constantIndex = 5;
+
+	for (UnaryOp* op : mathUnaryOps()) {
+		CAPTURE(std::string(op->Name()));
+		Z worst = 0.;
+		op->loopz(n, a.data(), 1, out.data());
+		LOOP(i,n) { worst = std::max(worst, opError(op->op(a[i]), out[i])); }
+		op->loopz(n, spreadA.data(), stride, out.data());
+		LOOP(i,n) { worst = std::max(worst, opError(op->op(a[i]), out[i])); }
+		op->loopz(n, &a[constantIndex], 0, out.data());
+		LOOP(i,n) { worst = std::max(worst, opError(op->op(a[constantIndex]), out[i])); }
+		CHECK(worst <= kOpTolerance);
+
+		if (report) {
+			double contiguous = nanosPerFrame([&] { op->loopz(n, a.data(), 1, out.data()); }, n);
+			double strided = nanosPerFrame([&] { op->loopz(n, spreadA.data(), stride, out.data()); }, n);
+			MESSAGE(op->Name() << ": error " << worst << ", " << contiguous << " ns/frame, strided " << strided);
+		}
+	}
+
+	for (BinaryOp* op : mathBinaryOps()) {
+		CAPTURE(std::string(op->Name()));
+		Z worst = 0.;
+		op->loopz(n, a.data(), 1, b.data(), 1, out.data());
+		LOOP(i,n) { worst = std::max(worst, opError(op->op(a[i], b[i]), out[i])); }
+		op->loopz(n, spreadA.data(), stride, b.data(), 1, out.data());
+		LOOP(i,n) { worst = std::max(worst, opError(op->op(a[i], b[i]), out[i])); }
+		op->loopz(n, a.data(), 1, spreadB.data(), stride, out.data());
+		LOOP(i,n) { worst = std::max(worst, opError(op->op(a[i], b[i]), out[i])); }
+		op->loopz(n, &a[constantIndex], 0, b.data(), 1, out.data());
+		LOOP(i,n) { worst = std::max(worst, opError(op->op(a[constantIndex], b[i]), out[i])); }
+		op->loopz(n, a.data(), 1, &b[constantIndex], 0, out.data());
+		LOOP(i,n) { worst = std::max(worst, opError(op->op(a[i], b[constantIndex]), out[i])); }
+		CHECK(worst <= kOpTolerance);
+
+		if (report) {
+			double contiguous = nanosPerFrame([&] { op->loopz(n, a.data(), 1, b.data(), 1, out.data()); }, n);
+			double strided = nanosPerFrame([&] { op->loopz(n, spreadA.data(), stride, spreadB.data(), stride, out.data()); }, n);
+			MESSAGE(op->Name() << ": error " << worst << ", " << contiguous << " ns/frame, strided " << strided);
+		}
+	}
+}
+
+TEST_CASE("constant operand kernels match loopz") {
+	const int n = 67;
+	std::vector<Z> a(n), expected(n), out(n);
+	LOOP(i,n) { a[i] = 2. * sin(i * .41) + .3; }
+
+	// the identities that the basic operators special case, and an ordinary number.
+	for (Z constant : {0., 1., -1., .7}) {
+		CAPTURE(constant);
+		for (BinaryOp* op : mathBinaryOps()) {
+			CAPTURE(std::string(op->Name()));
+			op->loopz(n, a.data(), 1, &constant, 0, expected.data());
+			op->loopzs(n, a.data(), 1, constant, out.data());
+			LOOP(i,n) { CHECK(opError(expected[i], out[i]) <= 1e-12); }
+
+			op->loopz(n, &constant, 0, a.data(), 1, expected.data());
+			op->loopsz(n, constant, a.data(), 1, out.data());
+			LOOP(i,n) { CHECK(opError(expected[i], out[i]) <= 1e-12); }
+		}
+	}
+}
@@ -0,0 +1,152 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Object.hpp"
+#include "Opcode.hpp"
+#include "VM.hpp"
+#include "doctest.h"
+#include "symbol.hpp"
+
+extern void AddCoreOps();
+extern void AddMathOps();
+
+static void addOps()
+{
+	static bool added = false;
+	if (added) return;
+	AddCoreOps();
+	AddMathOps();
+	added = true;
+}
+
+static P<Fun> compile(Thread& th, const char* source, bool inTopLevel = true)
+{
+	addOps();
+	P<Fun> fun;
+	REQUIRE(th.compile(source, fun, inTopLevel));
+	return fun;
+}
+
+static void eval(Thread& th, const char* source)
+{
+	compile(th, source)->run(th);
+}
+
+TEST_CASE("inline caches") {
+	setInlineCaching(true);
+	Thread th;
+	V x = getsym("opcode_x");
+
+	SUBCASE("a workspace var rebound after a cached lookup") {
+		P<GForm> workspace = new GForm();
+		th.mWorkspace = workspace->putImpure(x, 1.);
+		P<Fun> fun = compile(th, "opcode_x");
+		for (int i = 0; i < 2; ++i) {
+			fun->run(th);
+			CHECK(th.pop().f == 1.);
+		}
+		// x is already bound, so this makes a new form.
+		fun->Workspace() = fun->Workspace()->putImpure(x, 2.);
+		fun->run(th);
+		CHECK(th.pop().f == 2.);
+	}
+
+	SUBCASE("an impure put in a nearer table shadows a cached outer binding") {
+		P<GForm> outer = new GForm();
+		outer = outer->putImpure(x, 1.);
+		P<GForm> inner = new GForm(outer);
+		th.mWorkspace = inner;
+		P<Fun> fun = compile(th, "opcode_x");
+		for (int i = 0; i < 2; ++i) {
+			fun->run(th);
+			CHECK(th.pop().f == 1.);
+		}
+		// adds to inner's own table, so the workspace form is unchanged.
+		CHECK(inner->putImpure(x, 2.) == inner());
+		fun->run(th);
+		CHECK(th.pop().f == 2.);
+	}
+
+	SUBCASE("one dot site sees forms with different maps") {
+		eval(th, "\\f [f.k] = getk");
+		eval(th, "{:k 1} = a  {:j 2 :k 3} = b  {a :j 4} = c  {b :i 5} = d");
+		// a and b have k at different indices. c and d inherit it.
+		eval(th, "a getk a getk b getk c getk a getk d getk b getk b getk c getk");
+		const double expected[] = { 1., 1., 3., 1., 1., 3., 3., 3., 1. };
+		const int n = sizeof(expected) / sizeof(expected[0]);
+		REQUIRE(th.stackDepth() == (size_t)n);
+		for (int i = n - 1; i >= 0; --i) {
+			CHECK(th.pop().f == expected[i]);
+		}
+	}
+}
+
+static int countInstrs(Code* code, int op)
+{
+	int count = 0;
+	for (Instr const& in : code->instrs) {
+		if (in.op == op) ++count;
+	}
+	return count;
+}
+
+// runs fun with the compact interpreter, or with the reference one over the readable opcodes.
+static V runOnce(Thread& th, P<Fun> const& fun, bool inTraced)
+{
+	vm.traceon = inTraced;
+	try {
+		fun->run(th);
+	} catch (...) {
+		vm.traceon = false;
+		throw;
+	}
+	vm.traceon = false;
+	return th.pop();
+}
+
+TEST_CASE("superinstructions") {
+	struct Case
+	{
+		const char* source;
+		int fused;
+		int count;
+		double result;
+	};
+	// compiled below the top level, so = binds a local and ` pushes one.
+	const Case cases[] = {
+		{ "2 3 +", opPushImmCallImm, 1, 5. },
+		{ "3 = a `a neg", opPushLocalCallImm, 1, -3. },
+		{ "3 = a 4 = b `a `b -", opPushLocalPushLocal, 1, -1. },
+		{ "1 2 = b = a a b -", opBindLocalBindLocal, 1, -1. },
+		// a push of an immediate between the two local pushes keeps them apart.
+		{ "3 = a 4 = b `a 10 `b + *", opPushLocalPushLocal, 0, 42. },
+		// so does one between the first two binds.
+		{ "1 2 3 = c 0 = b = a a b c + + +", opBindLocalBindLocal, 1, 6. },
+	};
+	for (Case const& c : cases) {
+		INFO(c.source);
+		Thread th;
+		P<Fun> fun = compile(th, c.source, false);
+		CHECK(countInstrs(fun->mDef->mCode(), c.fused) == c.count);
+		V direct = runOnce(th, fun, false);
+		V traced = runOnce(th, fun, true);
+		CHECK(th.stackDepth() == 0);
+		REQUIRE(direct.isReal());
+		REQUIRE(traced.isReal());
+		CHECK(direct.f == c.result);
+		CHECK(traced.f == direct.f);
+	}
+}
@@ -0,0 +1,129 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef SAPF_ACCELERATE
+#include "doctest.h"
+#include "Object.hpp"
+#include "SimdKernels.hpp"
+#include "ArrHelpers.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+// not a multiple of any batch size, so every kernel also runs its scalar tail.
+constexpr int kNumFrames{103};
+
+static void fillInputs(Z* a, Z* b) {
+    LOOP(i, kNumFrames) {
+        a[i] = (i - 50) * .173 + .01;
+        b[i] = std::cos(i * .61) * 3.;
+    }
+}
+
+TEST_CASE("every set of SIMD kernels matches the scalar code") {
+    Z a[kNumFrames];
+    Z b[kNumFrames];
+    fillInputs(a, b);
+
+    for (const SimdKernels* kernels : availableSimdKernels()) {
+        CAPTURE(std::string(kernels->name));
+        Z expected[kNumFrames];
+        Z actual[kNumFrames];
+
+        LOOP(i, kNumFrames) { expected[i] = std::sin(a[i]); }
+        kernels->sin(kNumFrames, a, 1, actual);
+        CHECK_ARR(expected, actual, kNumFrames);
+
+        LOOP(i, kNumFrames) { expected[i] = std::atan2(a[i], b[i]); }
+        kernels->atan2(kNumFrames, a, 1, b, 1, actual);
+        CHECK_ARR(expected, actual, kNumFrames);
+
+        LOOP(i, kNumFrames) { expected[i] = std::logb(a[i]); }
+        kernels->logb(kNumFrames, a, 1, actual);
+        CHECK_ARR(expected, actual, kNumFrames);
+
+        LOOP(i, kNumFrames) { expected[i] = std::nextafter(a[i], b[i]); }
+        kernels->nextafter(kNumFrames, a, 1, b, 1, actual);
+        LOOP(i, kNumFrames) { CHECK(actual[i] == expected[i]); }
+
+        const Z signedZeros[] = {0., -0., 0., -0.};
+        const Z towards[] = {1., 1., -1., -1.};
+        Z stepped[4];
+        kernels->nextafter(4, signedZeros, 1, towards, 1, stepped);
+        LOOP(i, 4) { CHECK(stepped[i] == std::nextafter(signedZeros[i], towards[i])); }
+
+        LOOP(i, kNumFrames) { expected[i] = a[i] * b[i]; }
+        kernels->mul(kNumFrames, a, 1, b, 1, actual);
+        CHECK_ARR(expected, actual, kNumFrames);
+
+        float expectedFloat[kNumFrames];
+        float actualFloat[kNumFrames];
+        LOOP(i, kNumFrames) { expectedFloat[i] = static_cast<float>(a[i]); }
+        kernels->toFloat(kNumFrames, a, actualFloat);
+        LOOP(i, kNumFrames) { CHECK(actualFloat[i] == expectedFloat[i]); }
+    }
+}
+
+TEST_CASE("SIMD kernels can write over their input") {
+    Z a[kNumFrames];
+    Z b[kNumFrames];
+    fillInputs(a, b);
+    Z expected[kNumFrames];
+    LOOP(i, kNumFrames) { expected[i] = std::sin(a[i]) * b[i]; }
+
+    simdKernels().sin(kNumFrames, a, 1, a);
+    simdKernels().mul(kNumFrames, a, 1, b, 1, a);
+    CHECK_ARR(expected, a, kNumFrames);
+}
+
+TEST_CASE("SIMD kernels gather strided inputs and broadcast constant ones") {
+    constexpr int kStride{3};
+    Z a[kNumFrames];
+    Z b[kNumFrames];
+    fillInputs(a, b);
+    Z spread[kNumFrames * kStride];
+    LOOP(i, kNumFrames) { spread[i * kStride] = a[i]; }
+
+    for (const SimdKernels* kernels : availableSimdKernels()) {
+        CAPTURE(std::string(kernels->name));
+        Z expected[kNumFrames];
+        Z actual[kNumFrames];
+
+        kernels->sin(kNumFrames, a, 1, expected);
+        kernels->sin(kNumFrames, spread, kStride, actual);
+        CHECK_ARR(expected, actual, kNumFrames);
+
+        kernels->atan2(kNumFrames, a, 1, b, 1, expected);
+        kernels->atan2(kNumFrames, spread, kStride, b, 1, actual);
+        CHECK_ARR(expected, actual, kNumFrames);
+
+        Z constant[kNumFrames];
+        LOOP(i, kNumFrames) { constant[i] = b[7]; }
+        kernels->atan2(kNumFrames, a, 1, constant, 1, expected);
+        kernels->atan2(kNumFrames, a, 1, b + 7, 0, actual);
+        CHECK_ARR(expected, actual, kNumFrames);
+
+        LOOP(i, kNumFrames) { expected[i] = std::sin(b[7]); }
+        kernels->sin(kNumFrames, b + 7, 0, actual);
+        CHECK_ARR(expected, actual, kNumFrames);
+    }
+}
+
+TEST_CASE("the chosen SIMD kernels are the best available") {
+    if (getenv("SAPF_SIMD")) return;
+    CHECK(&simdKernels() == availableSimdKernels().front());
+}
+#endif // SAPF_ACCELERATE
@@ -18,12 +18,12 @@
 
 #include "doctest.h"
 #include "SndfileSoundFile.hpp"
+#include "dsp.hpp"
 #include <filesystem>
 #include <fstream>
 #include <valarray>
 #include <array>
 #include <sndfile.h>
-#include <fftw3.h>
 #include <complex>
 
 using std::string, std::filesystem::exists, std::filesystem::remove, std::filesystem::file_size,
@@ -136,7 +136,7 @@ TEST_CASE("SndfileSoundFile file writing") {
     }
 }
 
-double find_dominant_frequency(const vector<std::complex<double>>& spectrum, const int bufferSize, const double sampleRate) {
+double find_dominant_frequency(const vector<std::complex<Z>>& spectrum, const int bufferSize, const double sampleRate) {
     auto peakBin{0};
     auto maxMag{0.0};
 
@@ -203,13 +203,13 @@ void writeTestSignal(const string &fileName, const int numChannels, const int nu
 // return the buffers with their actual backing vector.
 // because portablebuffers do not carry their own backing vector with them for RAII,
 // the caller must ensure these pair elements share the same lifetime.
-pair<unique_ptr<PortableBuffers>, vector<vector<double>>> createPortableBuffers(const int numChannels, const int bufferSize) {
+pair<unique_ptr<PortableBuffers>, vector<vector<Z>>> createPortableBuffers(const int numChannels, const int bufferSize) {
     auto portableBufs = std::make_unique<PortableBuffers>(numChannels);
-    vector<vector<double>> bufData(numChannels);
+    vector<vector<Z>> bufData(numChannels);
     for (int channel = 0; channel < numChannels; ++channel) {
         bufData[channel].resize(bufferSize);
         portableBufs->setData(channel, bufData[channel].data());
-        portableBufs->setSize(channel, bufferSize * sizeof(double));
+        portableBufs->setSize(channel, bufferSize * sizeof(Z));
     }
         
     return {move(portableBufs), move(bufData)};
@@ -231,13 +231,13 @@ pair<SNDFILE*,vector<double>> openResampleOutputFile(
     return {resampledFile, move(outbuf)};
 }
 
-pair<vector<fftw_plan>,vector<std::complex<double>>> createFFTs(const int numChannels,
+pair<vector<SAPF_FFTW(plan)>,vector<std::complex<Z>>> createFFTs(const int numChannels,
     const int bufferSize, const PortableBuffers& portableBufs) {
-    vector<fftw_plan> fftPlans;
-    vector<std::complex<double>> fftOutputBuf(bufferSize/2 + 1);
+    vector<SAPF_FFTW(plan)> fftPlans;
+    vector<std::complex<Z>> fftOutputBuf(bufferSize/2 + 1);
     for (int channel = 0; channel < numChannels; channel++) {
-        fftPlans.emplace_back(fftw_plan_dft_r2c_1d(bufferSize, static_cast<double *>(portableBufs.buffers[channel].data),
-            reinterpret_cast<fftw_complex*>(fftOutputBuf.data()), FFTW_ESTIMATE|FFTW_PRESERVE_INPUT));
+        fftPlans.emplace_back(SAPF_FFTW(plan_dft_r2c_1d)(bufferSize, static_cast<Z *>(portableBufs.buffers[channel].data),
+            reinterpret_cast<SAPF_FFTW(complex)*>(fftOutputBuf.data()), FFTW_ESTIMATE|FFTW_PRESERVE_INPUT));
     }
     return {move(fftPlans), move(fftOutputBuf)};
 }
@@ -365,7 +365,7 @@ TEST_CASE("SndfileSoundFile file reading with resampling") {
             for (int channel = 0; channel < numChannels; channel++) {
                 // only bother checking once we have a sufficient amount of frames pulled for a good fft
                 if (framesPulled == bufferSize) {
-                    fftw_execute(fftPlans[channel]);
+                    SAPF_FFTW(execute)(fftPlans[channel]);
                     auto dominantFreq{find_dominant_frequency(fftOutputBuf, bufferSize, dstSampleRate)};
                     constexpr auto tolerance{10};
                     const auto expectedFreq{440. + 100 * channel};
@@ -375,7 +375,7 @@ TEST_CASE("SndfileSoundFile file reading with resampling") {
 
                 if (outputResampled) {
                     for (int frame = 0; frame < framesPulled; frame++) {
-                        const double actualSample{static_cast<double *>(portableBufs->buffers[channel].data)[frame]};
+                        const double actualSample{static_cast<Z *>(portableBufs->buffers[channel].data)[frame]};
                         resampledFileInputBuf[frame * numChannels + channel] = actualSample;
                     }
                 }
@@ -389,7 +389,7 @@ TEST_CASE("SndfileSoundFile file reading with resampling") {
             sf_close(resampledFile);
         }
         for (int channel = 0; channel < numChannels; channel++) {
-            fftw_destroy_plan(fftPlans[channel]);
+            SAPF_FFTW(destroy_plan)(fftPlans[channel]);
         }
         CHECK(totalFramesPulled == expectedOutputFrames);
     }
@@ -405,4 +405,75 @@ TEST_CASE("SndfileSoundFile file reading with resampling") {
     }
 }
 
+TEST_CASE("SndfileSoundFile mapped reading matches libsndfile") {
+    const string testFileName{"test_read_mapped.wav"};
+    constexpr double sampleRate{44100};
+    constexpr int bufferSize{1024};
+    constexpr int framesToPull{777};
+    constexpr int numInputFrames{1024*3+5};
+    int format{0};
+    int numChannels{2};
+
+    SUBCASE("pcm 16") { format = SF_FORMAT_PCM_16; }
+    SUBCASE("pcm 24") { format = SF_FORMAT_PCM_24; }
+    SUBCASE("pcm 32") { format = SF_FORMAT_PCM_32; }
+    SUBCASE("pcm u8") { format = SF_FORMAT_PCM_U8; }
+    SUBCASE("float") { format = SF_FORMAT_FLOAT; }
+    SUBCASE("double 8 channel") { format = SF_FORMAT_DOUBLE; numChannels = 8; }
+
+    CAPTURE(format);
+    CAPTURE(numChannels);
+
+    {
+        SF_INFO sfinfo{
+            .samplerate = static_cast<int>(sampleRate),
+            .channels = numChannels,
+            .format = SF_FORMAT_WAV | format};
+        SNDFILE *outfile = sf_open(testFileName.c_str(), SFM_WRITE, &sfinfo);
+        REQUIRE(outfile != nullptr);
+        vector<double> buf(numChannels * numInputFrames);
+        for (int frame = 0; frame < numInputFrames; ++frame) {
+            for (int channel = 0; channel < numChannels; ++channel) {
+                buf[frame * numChannels + channel] = 0.9 * sin(2.0 * M_PI * (440.0 + 100 * channel) * frame / sampleRate);
+            }
+        }
+        sf_writef_double(outfile, buf.data(), numInputFrames);
+        sf_close(outfile);
+    }
+
+    auto mappedFile = SndfileSoundFile::open(testFileName.c_str(), sampleRate, bufferSize);
+    auto sndfileFile = SndfileSoundFile::open(testFileName.c_str(), sampleRate, bufferSize, false);
+    REQUIRE(mappedFile != nullptr);
+    REQUIRE(sndfileFile != nullptr);
+    CHECK(mappedFile->isMapped());
+    CHECK_FALSE(sndfileFile->isMapped());
+
+    auto [mappedBufs, mappedData] = createPortableBuffers(numChannels, bufferSize);
+    auto [sndfileBufs, sndfileData] = createPortableBuffers(numChannels, bufferSize);
+
+    int totalFramesPulled{0};
+    int iteration{0};
+    while (iteration++ < 10000) {
+        uint32_t mappedFrames{framesToPull};
+        uint32_t sndfileFrames{framesToPull};
+        CHECK(mappedFile->pull(&mappedFrames, *mappedBufs) == 0);
+        CHECK(sndfileFile->pull(&sndfileFrames, *sndfileBufs) == 0);
+        REQUIRE(mappedFrames == sndfileFrames);
+        if (mappedFrames == 0) break;
+        for (int channel = 0; channel < numChannels; ++channel) {
+            for (uint32_t frame = 0; frame < mappedFrames; ++frame) {
+                REQUIRE(mappedData[channel][frame] == sndfileData[channel][frame]);
+            }
+        }
+        totalFramesPulled += static_cast<int>(mappedFrames);
+    }
+    CHECK(totalFramesPulled == numInputFrames);
+
+    mappedFile = nullptr;
+    sndfileFile = nullptr;
+    if (exists(testFileName)) {
+        remove(testFileName);
+    }
+}
+
 #endif
@@ -20,6 +20,7 @@
 #include "ArrHelpers.hpp"
 #include "ZArr.hpp"
 #include "Testability.hpp"
+#include "dsp.hpp"
 
 // non-vectorized version for comparison
 void hann_calc(Z* out, int n) {
@@ -94,15 +95,172 @@ TEST_CASE("WinSegment apply window simd") {
 	blackman_calc(blackman, n);
 	Z segbuf_expected[n];
 	Z segbuf_actual[n];
-	LOOP(i, n) { segbuf_expected[i] = sin(i / n); }
-	LOOP(i, n) { segbuf_actual[i] = sin(i / n); }
+	LOOP(i, n) { segbuf_expected[i] = sin((Z)i / n); }
+	LOOP(i, n) { segbuf_actual[i] = sin((Z)i / n); }
 
 	calc_winseg_apply_window(segbuf_expected, blackman, n);
-	#ifdef SAPF_ACCELERATE
-		wseg_apply_window(segbuf_actual, blackman, n);
-	#else
-		wseg_apply_window(segbuf_actual, zarr(blackman, 1, n), n);
-	#endif
+	wseg_apply_window(segbuf_actual, blackman, n);
 
 	CHECK_ARR(segbuf_expected, segbuf_actual, n);
 }
+
+TEST_CASE("stft istft round trip") {
+	const int n = 64;
+	const int numFrames = 4;
+	const int length = n * numFrames;
+	Thread th;
+	// one second hops are exactly n samples.
+	th.rate.set(n, th.rate.blockSize, 1);
+	initFFT();
+
+	P<List> signal = new List(itemTypeZ, length);
+	signal->mArray->setSize(length);
+	Z* x = signal->mArray->z();
+	LOOP(i,length) { x[i] = sin(i * .37) + .2 * cos(i * 1.3); }
+
+	P<List> window = new List(itemTypeZ, n);
+	window->mArray->setSize(n);
+	LOOP(i,n) { window->mArray->z()[i] = 1.; }
+
+	th.push(signal);
+	th.push(1.);
+	th.push(window);
+	stft_(th, nullptr);
+	V frames = th.pop();
+
+	SUBCASE("frames are packed spectra") {
+		Z expected[n];
+		LOOP(i,n) { expected[i] = x[i]; }
+		rfft_packed(n, expected);
+
+		VIn in(frames);
+		V frame;
+		REQUIRE_FALSE(in.one(th, frame));
+		REQUIRE(frame.isZList());
+		P<List> frameList = ((List*)frame.o())->pack(th);
+		REQUIRE(frameList->mArray->size() == n);
+		CHECK_ARR(expected, frameList->mArray->z(), n);
+	}
+
+	SUBCASE("istft reconstructs the input") {
+		th.push(frames);
+		th.push(1.);
+		th.push(window);
+		istft_(th, nullptr);
+		V out = th.pop();
+
+		Z actual[length];
+		ZIn in(out);
+		int num = length;
+		in.fill(th, num, actual, 1);
+		REQUIRE(num == length);
+		CHECK_ARR(x, actual, length);
+	}
+}
+
+// the last frame's tail is flushed once, so k frames a hop apart last (k - 1) hops plus a frame.
+TEST_CASE("istft output length") {
+	const int n = 64;
+	const int numFrames = 5;
+	Thread th;
+	// one second hops are exactly n samples.
+	th.rate.set(n, th.rate.blockSize, 1);
+	initFFT();
+
+	P<List> frames = new List(itemTypeV, numFrames);
+	LOOP(i,numFrames) {
+		P<List> frame = new List(itemTypeZ, n);
+		frame->mArray->setSize(n);
+		LOOP(j,n) { frame->mArray->z()[j] = j == 0 ? 1. : 0.; }
+		frames->add(frame);
+	}
+
+	P<List> window = new List(itemTypeZ, n);
+	window->mArray->setSize(n);
+	LOOP(i,n) { window->mArray->z()[i] = 1.; }
+
+	Z hop = 0.;
+	SUBCASE("overlapping") { hop = .25; }
+	SUBCASE("adjacent") { hop = 1.; }
+	SUBCASE("gaps between frames") { hop = 2.5; }
+	CAPTURE(hop);
+
+	th.push(frames);
+	th.push(hop);
+	th.push(window);
+	istft_(th, nullptr);
+	P<List> out = th.popZList("istft");
+
+	const int64_t hopSamples = (int64_t)(hop * n);
+	CHECK(out->length(th) == (numFrames - 1) * hopSamples + n);
+}
+
+TEST_CASE("reverse reuses an unshared list") {
+	Thread th;
+	const int n = 100;
+	P<List> list = new List(itemTypeZ, n);
+	list->mArray->setSize(n);
+	LOOP(i,n) { list->mArray->z()[i] = i; }
+
+	SUBCASE("unshared") {
+		List* original = list();
+		th.push(list);
+		list = nullptr;
+		reverse_(th, nullptr);
+		P<List> out = th.popZList("reverse");
+		CHECK(out() == original);
+		LOOP(i,n) { CHECK(out->mArray->z()[i] == n - 1 - i); }
+	}
+
+	SUBCASE("shared") {
+		th.push(list);
+		reverse_(th, nullptr);
+		P<List> out = th.popZList("reverse");
+		CHECK(out() != list());
+		LOOP(i,n) { CHECK(out->mArray->z()[i] == n - 1 - i); }
+		CHECK(list->mArray->z()[0] == 0.);
+	}
+}
+
+TEST_CASE("drop shares the storage of a packed list") {
+	Thread th;
+	const int n = 100;
+	P<List> list = new List(itemTypeZ, n);
+	list->mArray->setSize(n);
+	LOOP(i,n) { list->mArray->z()[i] = i; }
+
+	SUBCASE("from the front") {
+		th.push(list);
+		th.push(10.);
+		drop_(th, nullptr);
+		P<List> out = th.popZList("drop");
+		CHECK(out->mArray->isView());
+		CHECK(out->mArray->size() == n - 10);
+		CHECK(out->mArray->z() == list->mArray->z() + 10);
+		CHECK(!out->isUnshared());
+	}
+
+	SUBCASE("from the back") {
+		th.push(list);
+		th.push(-10.);
+		drop_(th, nullptr);
+		P<List> out = th.popZList("drop");
+		CHECK(out->mArray->isView());
+		CHECK(out->mArray->size() == n - 10);
+		CHECK(out->mArray->z() == list->mArray->z());
+	}
+
+	SUBCASE("a view outlives its parent and copies when it grows") {
+		th.push(list);
+		th.push(90.);
+		drop_(th, nullptr);
+		P<List> out = th.popZList("drop");
+		list = nullptr;
+		LOOP(i,10) { CHECK(out->mArray->z()[i] == 90 + i); }
+		out->mArray->addz(100.);
+		CHECK(!out->mArray->isView());
+		CHECK(out->mArray->size() == 11);
+		LOOP(i,10) { CHECK(out->mArray->z()[i] == 90 + i); }
+		CHECK(out->mArray->z()[10] == 100.);
+	}
+}
@@ -0,0 +1,69 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Object.hpp"
+#include "VM.hpp"
+#include "doctest.h"
+#include "symbol.hpp"
+#include <cmath>
+
+// these hold for both layouts of V.
+TEST_CASE("V") {
+	SUBCASE("numbers") {
+		V a = 1.5;
+		CHECK(a.isReal());
+		CHECK(!a.o);
+		CHECK(a.f == 1.5);
+		V b = -0.;
+		CHECK(b.isReal());
+		CHECK(std::signbit((double)b.f));
+		V c = NAN;
+		CHECK(c.isReal());
+		CHECK(std::isnan((double)c.f));
+		V d = -INFINITY;
+		CHECK(d.isReal());
+		CHECK(d.f == -INFINITY);
+	}
+
+	SUBCASE("objects") {
+		P<String> s = getsym("test_value");
+		int32_t refs = s->getRefcount();
+		{
+			V a = s;
+			CHECK(a.isObject());
+			CHECK(a.o() == s());
+			CHECK(a.asObj() == s());
+			V b = a;
+			CHECK(s->getRefcount() == refs + 2);
+			b = 2.;
+			CHECK(b.isReal());
+			CHECK(b.f == 2.);
+			CHECK(s->getRefcount() == refs + 1);
+			b.o = s;
+			CHECK(b.isObject());
+			b.o = nullptr;
+			CHECK(b.isReal());
+		}
+		CHECK(s->getRefcount() == refs);
+	}
+
+	SUBCASE("integer operands") {
+		V a;
+		a.i = 12345;
+		CHECK(a.isReal());
+		CHECK(a.i == 12345);
+	}
+}
@@ -0,0 +1,145 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "VM.hpp"
+#include "dsp.hpp"
+#include "doctest.h"
+#include "ArrHelpers.hpp"
+#include <cmath>
+#include <thread>
+#include <vector>
+
+// direct dft, scaled like fft.
+static void dft_calc(int n, Z* inReal, Z* inImag, Z* outReal, Z* outImag)
+{
+	for (int k = 0; k < n; ++k) {
+		Z re = 0., im = 0.;
+		for (int j = 0; j < n; ++j) {
+			Z w = -2. * M_PI * j * k / n;
+			re += inReal[j] * cos(w) - inImag[j] * sin(w);
+			im += inReal[j] * sin(w) + inImag[j] * cos(w);
+		}
+		outReal[k] = re * 2. / n;
+		outImag[k] = im * 2. / n;
+	}
+}
+
+TEST_CASE("fft matches dft") {
+	const int n = 64;
+	Z inReal[n], inImag[n], outReal[n], outImag[n], expectedReal[n], expectedImag[n];
+	LOOP(i,n) { inReal[i] = sin(i * .3) + .25; inImag[i] = cos(i * .7); }
+
+	initFFT();
+	dft_calc(n, inReal, inImag, expectedReal, expectedImag);
+
+	SUBCASE("out of place") {
+		fft(n, inReal, inImag, outReal, outImag);
+	}
+	SUBCASE("in place") {
+		LOOP(i,n) { outReal[i] = inReal[i]; outImag[i] = inImag[i]; }
+		fft(n, outReal, outImag);
+	}
+	SUBCASE("unaligned") {
+		std::vector<Z> re(n + 1), im(n + 1), ore(n + 1), oim(n + 1);
+		LOOP(i,n) { re[i+1] = inReal[i]; im[i+1] = inImag[i]; }
+		fft(n, &re[1], &im[1], &ore[1], &oim[1]);
+		LOOP(i,n) { outReal[i] = ore[i+1]; outImag[i] = oim[i+1]; }
+	}
+
+	CHECK_ARR(expectedReal, outReal, n);
+	CHECK_ARR(expectedImag, outImag, n);
+}
+
+TEST_CASE("ifft inverts fft") {
+	const int n = 256;
+	Z inReal[n], inImag[n], specReal[n], specImag[n], outReal[n], outImag[n];
+	LOOP(i,n) { inReal[i] = sin(i * .1); inImag[i] = 0.; }
+
+	initFFT();
+	fft(n, inReal, inImag, specReal, specImag);
+	ifft(n, specReal, specImag, outReal, outImag);
+
+	CHECK_ARR(inReal, outReal, n);
+	CHECK_ARR(inImag, outImag, n);
+}
+
+TEST_CASE("rifft inverts rfft") {
+	const int n = 128;
+	Z in[n], specReal[n/2], specImag[n/2], out[n];
+	// no energy at nyquist, which the half spectrum doesn't hold.
+	LOOP(i,n) { in[i] = .5 + cos(2. * M_PI * 3. * i / n) + .25 * sin(2. * M_PI * 10. * i / n); }
+
+	initFFT();
+	rfft(n, in, specReal, specImag);
+	CHECK(specReal[3] == doctest::Approx(1.));
+	CHECK(specImag[10] == doctest::Approx(-.25));
+
+	Z specRealCopy[n/2];
+	LOOP(i,n/2) { specRealCopy[i] = specReal[i]; }
+	rifft(n, specReal, specImag, out);
+
+	// rifft must not clobber its input.
+	CHECK_ARR(specRealCopy, specReal, n/2);
+	CHECK_ARR(in, out, n);
+}
+
+TEST_CASE("packed real fft") {
+	const int n = 64;
+	Z in[n], packed[n], specReal[n/2], specImag[n/2], out[n];
+	LOOP(i,n) { in[i] = sin(i * .4) + ((i & 1) ? -.3 : .3); packed[i] = in[i]; }
+	Z nyquist = 0.;
+	LOOP(i,n) { nyquist += ((i & 1) ? -in[i] : in[i]) * 2. / n; }
+
+	initFFT();
+	rfft(n, in, specReal, specImag);
+	rfft_packed(n, packed);
+
+	CHECK_ARR(specReal, packed, n/2);
+	// the nyquist bin is in place of bin 0's imaginary part.
+	CHECK(packed[n/2] == doctest::Approx(nyquist));
+	for (int k = 1; k < n/2; ++k) {
+		CHECK(packed[n/2 + k] == doctest::Approx(specImag[k]).epsilon(kSampleEpsilon));
+	}
+
+	LOOP(i,n) { out[i] = packed[i]; }
+	rifft_packed(n, out);
+	CHECK_ARR(in, out, n);
+}
+
+TEST_CASE("fft from several threads") {
+	const int n = 1024;
+	const int numThreads = 4;
+	std::vector<Z> inReal(n), inImag(n, 0.), expectedReal(n), expectedImag(n);
+	LOOP(i,n) { inReal[i] = sin(i * .05) * cos(i * .003); }
+
+	initFFT();
+	fft(n, inReal.data(), inImag.data(), expectedReal.data(), expectedImag.data());
+
+	std::vector<std::vector<Z>> outReal(numThreads, std::vector<Z>(n)), outImag(numThreads, std::vector<Z>(n));
+	std::vector<std::thread> threads;
+	for (int t = 0; t < numThreads; ++t) {
+		threads.emplace_back([&, t] {
+			for (int rep = 0; rep < 50; ++rep)
+				fft(n, inReal.data(), inImag.data(), outReal[t].data(), outImag[t].data());
+		});
+	}
+	for (auto& thread : threads) thread.join();
+
+	for (int t = 0; t < numThreads; ++t) {
+		CHECK_ARR(expectedReal, outReal[t], n);
+		CHECK_ARR(expectedImag, outImag[t], n);
+	}
+}